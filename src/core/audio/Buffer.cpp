@@ -35,6 +35,7 @@
 #include "pch.hpp"
 
 #include <core/audio/Buffer.h>
+#include <algorithm>
 
 #define DEBUG 0
 
@@ -110,6 +111,10 @@ void Buffer::CopyFormat(Buffer* fromBuffer) {
     this->sampleRate = fromBuffer->SampleRate();
 }
 
+long Buffer::Capacity() const {
+    return this->internalBufferSize;
+}
+
 void Buffer::ResizeBuffer() {
     if (this->samples > this->internalBufferSize) {
         if (flags & ImmutableSize && this->internalBufferSize > 0) {
@@ -138,6 +143,10 @@ void Buffer::SetPosition(double position) {
 void Buffer::Copy(float* buffer, long samples, long offset) {
     long length = offset + samples;
     if (length > this->internalBufferSize) {
+        if (flags & ImmutableSize && this->internalBufferSize > 0) {
+            throw std::runtime_error("buffer cannot be resized");
+        }
+
         float *newBuffer = new float[length];
         CopyFloat(newBuffer, this->buffer, this->internalBufferSize);
         CopyFloat(newBuffer + offset, buffer, samples);
@@ -150,4 +159,108 @@ void Buffer::Copy(float* buffer, long samples, long offset) {
     }
 
     this->samples = std::max(this->samples, length);
-}
\ No newline at end of file
+}
+/* ------------------------------------------------------------------------ */
+
+BufferPool& BufferPool::Instance() {
+    /* intentionally never destroyed: Players are detached and may still be
+    returning buffers while static destructors run at shutdown. */
+    static BufferPool* instance = new BufferPool();
+    return *instance;
+}
+
+BufferPool::BufferPool()
+: maxBytes(DefaultMaxMegabytes * 1024 * 1024)
+, allocatedBytes(0) {
+}
+
+size_t BufferPool::Acquire(
+    long samples,
+    size_t count,
+    size_t minimum,
+    std::vector<Buffer*>& target)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    const size_t bytes = samples * sizeof(float);
+    size_t added = 0;
+
+    /* re-use what we already have first... */
+    auto& cached = this->cache[samples];
+    while (added < count && cached.size()) {
+        target.push_back(cached.back());
+        cached.pop_back();
+        ++added;
+    }
+
+    /* ... then allocate the rest, making room by dropping cached buffers
+    of other sizes if we need to. */
+    if (added < count) {
+        this->Trim(samples, (count - added) * bytes);
+
+        while (added < count) {
+            if (added >= minimum && this->allocatedBytes + bytes > this->maxBytes) {
+                break;
+            }
+
+            Buffer* buffer = new Buffer(Buffer::ImmutableSize);
+            buffer->SetSamples(samples);
+            this->allocatedBytes += bytes;
+            target.push_back(buffer);
+            ++added;
+        }
+    }
+
+    return added;
+}
+
+void BufferPool::Release(std::vector<Buffer*>& buffers) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    for (Buffer* buffer : buffers) {
+        const long samples = buffer->Capacity();
+
+        /* we may have handed out more than we wanted to, if we were asked
+        for a minimum, or the ceiling was lowered. don't cache those. */
+        if (this->allocatedBytes > this->maxBytes) {
+            this->allocatedBytes -= samples * sizeof(float);
+            delete buffer;
+        }
+        else {
+            this->cache[samples].push_back(buffer);
+        }
+    }
+
+    buffers.clear();
+}
+
+void BufferPool::Trim(long keep, size_t required) {
+    auto it = this->cache.begin();
+    while (it != this->cache.end() && this->allocatedBytes + required > this->maxBytes) {
+        if (it->first != keep) {
+            auto& cached = it->second;
+            while (cached.size() && this->allocatedBytes + required > this->maxBytes) {
+                this->allocatedBytes -= it->first * sizeof(float);
+                delete cached.back();
+                cached.pop_back();
+            }
+        }
+        ++it;
+    }
+}
+
+void BufferPool::SetMaxBytes(size_t maxBytes) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->maxBytes = maxBytes;
+    this->Trim(-1, 0);
+}
+
+size_t BufferPool::MaxBytes() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return this->maxBytes;
+}
+
+size_t BufferPool::AllocatedBytes() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return this->allocatedBytes;
+}
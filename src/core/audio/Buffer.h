@@ -37,6 +37,10 @@
 #include <core/config.h>
 #include <core/sdk/IBuffer.h>
 
+#include <map>
+#include <mutex>
+#include <vector>
+
 namespace musik { namespace core { namespace audio {
 
     class Buffer;
@@ -69,6 +73,7 @@ namespace musik { namespace core { namespace audio {
             void SetPosition(double position);
             void Copy(float* buffer, long samples, long offset = 0);
             void CopyFormat(Buffer* fromBuffer);
+            long Capacity() const;
 
         private:
             void ResizeBuffer();
@@ -82,4 +87,40 @@ namespace musik { namespace core { namespace audio {
             int flags;
     };
 
+    /* a process-wide cache of fixed-size Buffers, keyed by sample count. Streams
+    borrow all their buffers from here when they open, and give them back when
+    they're destroyed, so track changes don't churn the allocator. the total
+    memory held by the pool (in use and cached) is capped at MaxBytes(). */
+    class BufferPool {
+        public:
+            static const size_t DefaultMaxMegabytes = 32;
+
+            static BufferPool& Instance();
+
+            /* appends up to 'count' buffers of 'samples' floats each to 'target',
+            and returns the number added. fewer are returned if the memory ceiling
+            has been reached, but never fewer than 'minimum' */
+            size_t Acquire(
+                long samples,
+                size_t count,
+                size_t minimum,
+                std::vector<Buffer*>& target);
+
+            void Release(std::vector<Buffer*>& buffers);
+
+            void SetMaxBytes(size_t maxBytes);
+            size_t MaxBytes();
+            size_t AllocatedBytes();
+
+        private:
+            BufferPool();
+
+            void Trim(long keep, size_t required);
+
+            std::mutex mutex;
+            std::map<long, std::vector<Buffer*>> cache;
+            size_t maxBytes;
+            size_t allocatedBytes;
+    };
+
 } } }
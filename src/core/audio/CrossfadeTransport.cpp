@@ -38,17 +38,20 @@
 #include <core/audio/CrossfadeTransport.h>
 #include <core/plugin/PluginFactory.h>
 #include <core/audio/Outputs.h>
+#include <core/support/Preferences.h>
+#include <core/support/PreferenceKeys.h>
 #include <algorithm>
 
 #define CROSSFADE_DURATION_MS 1500
 #define END_OF_TRACK_MIXPOINT 1001
 
+using namespace musik::core;
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
 
 static std::string TAG = "CrossfadeTransport";
 
-CrossfadeTransport::CrossfadeTransport()
+CrossfadeTransport::CrossfadeTransport(Mode mode)
 : volume(1.0)
 , state(PlaybackStopped)
 , muted(false)
@@ -57,6 +60,14 @@ CrossfadeTransport::CrossfadeTransport()
 , next(*this, crossfader) {
     this->crossfader.Emptied.connect(
         this, &CrossfadeTransport::OnCrossfaderEmptied);
+
+    if (mode == Mode::Mixer) {
+        auto playbackPrefs = Preferences::ForComponent(prefs::components::Playback);
+
+        this->mixer = Mixer::Create();
+        this->mixer->SetCurve((Mixer::Curve) playbackPrefs->GetInt(
+            prefs::keys::CrossfadeCurve, (int) Mixer::Curve::EqualPower));
+    }
 }
 
 CrossfadeTransport::~CrossfadeTransport() {
@@ -108,6 +119,17 @@ std::string CrossfadeTransport::Uri() {
 
 void CrossfadeTransport::ReloadOutput() {
     this->Stop();
+
+    if (this->mixer) {
+        this->mixer->ReloadOutput();
+    }
+}
+
+CrossfadeTransport::Output CrossfadeTransport::CreateOutput() {
+    if (this->mixer) {
+        return this->mixer->CreateChannel();
+    }
+    return outputs::SelectedOutput();
 }
 
 void CrossfadeTransport::StopImmediately() {
@@ -427,7 +449,7 @@ void CrossfadeTransport::PlayerContext::Reset(
 
     this->startImmediate = startImmediate;
     this->canFade = this->started = false;
-    this->output = url.size() ? outputs::SelectedOutput() : nullptr;
+    this->output = url.size() ? transport.CreateOutput() : nullptr;
     this->player = url.size() ? Player::Create(url, this->output, Player::Drain, listener, gain) : nullptr;
 }
 
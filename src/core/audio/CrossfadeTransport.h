@@ -38,6 +38,7 @@
 #include <core/audio/ITransport.h>
 #include <core/audio/Player.h>
 #include <core/audio/Crossfader.h>
+#include <core/audio/Mixer.h>
 #include <core/runtime/MessageQueue.h>
 #include <core/sdk/IOutput.h>
 #include <core/sdk/constants.h>
@@ -55,7 +56,15 @@ namespace musik { namespace core { namespace audio {
         public sigslot::has_slots<>
     {
         public:
-            CrossfadeTransport();
+            /* Volume fades each Player's own output device independently,
+            Mixer sums all Players into a single device and applies the fade
+            per-sample. */
+            enum class Mode : int {
+                Volume = 0,
+                Mixer = 1
+            };
+
+            CrossfadeTransport(Mode mode = Mode::Volume);
             virtual ~CrossfadeTransport();
 
             void StopImmediately();
@@ -124,6 +133,7 @@ namespace musik { namespace core { namespace audio {
                 Crossfader& crossfader;
             };
 
+            Output CreateOutput();
             void RaiseStreamEvent(int type, Player* player);
             void SetPlaybackState(int state);
 
@@ -137,6 +147,7 @@ namespace musik { namespace core { namespace audio {
 
             musik::core::sdk::PlaybackState state;
             std::recursive_mutex stateMutex;
+            std::shared_ptr<Mixer> mixer;
             Crossfader crossfader;
             PlayerContext active;
             PlayerContext next;
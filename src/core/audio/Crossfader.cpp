@@ -36,6 +36,7 @@
 
 #include <core/audio/Crossfader.h>
 #include <core/runtime/Message.h>
+#include <core/support/ThreadPriority.h>
 
 #include <algorithm>
 #include <chrono>
@@ -90,12 +91,22 @@ void Crossfader::Fade(
     if (player && output && !this->Contains(player)) {
         std::shared_ptr<FadeContext> context = std::make_shared<FadeContext>();
         context->output = output;
+        context->channel = dynamic_cast<Mixer::Channel*>(output.get());
         context->player = player;
         context->direction = direction;
         context->ticksCounted = 0;
         context->ticksTotal = (durationMs / TICK_TIME_MILLIS);
         contextList.push_back(context);
 
+        /* mixer channels apply the fade themselves, per-sample. we still
+        tick them so we know when they're done. */
+        if (context->channel) {
+            context->channel->SetVolume(
+                this->transport.IsMuted() ? 0.0 : this->transport.Volume());
+
+            context->channel->Fade(direction == FadeIn, durationMs);
+        }
+
         player->Attach(this);
 
         /* for performance reasons we don't allow more than a couple
@@ -134,6 +145,11 @@ void Crossfader::Drain() {
 
     if (this->contextList.size()) {
         for (FadeContextPtr context : this->contextList) {
+            if (context->channel && context->direction != FadeOut) {
+                const long remaining = context->ticksTotal - context->ticksCounted;
+                context->channel->Fade(false, remaining * TICK_TIME_MILLIS);
+            }
+
             context->direction = FadeOut;
         }
 
@@ -237,6 +253,9 @@ void Crossfader::ProcessMessage(IMessage &message) {
                         if (this->transport.IsMuted()) {
                             fade->output->SetVolume(0.0);
                         }
+                        else if (fade->channel) {
+                            fade->output->SetVolume(globalVolume);
+                        }
                         else {
                             double percent =
                                 (float)fade->ticksCounted /
@@ -305,6 +324,8 @@ void Crossfader::ProcessMessage(IMessage &message) {
 }
 
 void Crossfader::ThreadLoop() {
+    musik::core::threads::Configure(musik::core::threads::Role::Audio);
+
     while (!this->quit) {
         messageQueue.WaitAndDispatch();
     }
@@ -37,6 +37,7 @@
 #include <core/config.h>
 #include <core/audio/ITransport.h>
 #include <core/audio/Player.h>
+#include <core/audio/Mixer.h>
 #include <core/runtime/MessageQueue.h>
 #include <core/sdk/IOutput.h>
 #include <core/sdk/constants.h>
@@ -84,6 +85,7 @@ namespace musik { namespace core { namespace audio {
 
             struct FadeContext {
                 std::shared_ptr<musik::core::sdk::IOutput> output;
+                Mixer::Channel* channel; /* non-null if output is a Mixer channel */
                 Player* player;
                 Direction direction;
                 long ticksCounted;
@@ -0,0 +1,275 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#include "pch.hpp"
+
+#include "DecoderPool.h"
+#include "Streams.h"
+#include <core/debug.h>
+#include <core/sdk/constants.h>
+
+#include <algorithm>
+#include <functional>
+
+#define TAG "DecoderPool"
+
+using namespace musik::core::audio;
+using namespace musik::core::io;
+using namespace musik::core::sdk;
+
+DecoderPool& DecoderPool::Instance() {
+    /* not destroyed at exit: the worker may be in the middle of opening a
+    file, and closing its decoders from a static destructor isn't safe. */
+    static DecoderPool* instance = new DecoderPool();
+    return *instance;
+}
+
+DecoderPool::DecoderPool()
+: size(DefaultSize)
+, maxFileBytes((size_t) DefaultMaxFileMegabytes * 1024 * 1024)
+, openFileBytes(0) {
+}
+
+void DecoderPool::Configure(int size, int maxFileMegabytes) {
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->size = (size_t) std::max(0, std::min((int) MaxSize, size));
+        this->maxFileBytes = (size_t) std::max(0, maxFileMegabytes) * 1024 * 1024;
+    }
+
+    if (size <= 0) {
+        this->Prepare(std::vector<std::string>());
+    }
+}
+
+size_t DecoderPool::Size() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return this->size;
+}
+
+void DecoderPool::Drop(EntryPtr entry, EntryList& released) {
+    /* called with the lock held. the worker releases anything it's still
+    opening itself; everything else is released by the caller, after the
+    lock is dropped, because closing a decoder can take a while. */
+    entry->dropped = true;
+    if (entry->state == Entry::State::Ready) {
+        this->openFileBytes -= entry->fileBytes;
+        released.push_back(entry);
+    }
+}
+
+void DecoderPool::Prepare(const std::vector<std::string>& uris) {
+    EntryList released;
+
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        EntryList wanted;
+
+        for (auto& uri : uris) {
+            if (wanted.size() >= this->size) {
+                break;
+            }
+
+            if (uri.empty()) {
+                continue;
+            }
+
+            auto it = std::find_if(
+                this->entries.begin(),
+                this->entries.end(),
+                [&uri](const EntryPtr& e) { return e->uri == uri; });
+
+            if (it != this->entries.end()) {
+                wanted.push_back(*it);
+                this->entries.erase(it);
+            }
+            else {
+                auto entry = std::make_shared<Entry>();
+                entry->uri = uri;
+                entry->state = Entry::State::Queued;
+                entry->dropped = false;
+                entry->deferred = false;
+                entry->fileBytes = 0;
+                wanted.push_back(entry);
+            }
+        }
+
+        for (auto& entry : this->entries) {
+            this->Drop(entry, released);
+        }
+
+        this->entries.swap(wanted);
+
+        for (auto& entry : this->entries) {
+            entry->deferred = false;
+        }
+
+        if (!this->entries.empty()) {
+            this->entries.front()->deferred = true;
+        }
+
+        if (!this->entries.empty() && !this->thread) {
+            this->thread.reset(new std::thread(
+                std::bind(&DecoderPool::ThreadLoop, this)));
+            this->thread->detach();
+        }
+    }
+
+    this->workAvailable.notify_all();
+}
+
+bool DecoderPool::Take(
+    const std::string& uri,
+    DataStreamPtr& dataStream,
+    DecoderPtr& decoder)
+{
+    EntryPtr entry;
+
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        auto it = std::find_if(
+            this->entries.begin(),
+            this->entries.end(),
+            [&uri](const EntryPtr& e) { return e->uri == uri; });
+
+        if (it == this->entries.end()) {
+            return false;
+        }
+
+        entry = *it;
+
+        if (entry->state == Entry::State::Queued) {
+            /* the caller is about to open it anyway; don't do it twice. if
+            it was holding up the rest, they can go ahead now. */
+            entry->dropped = true;
+            this->entries.erase(it);
+            lock.unlock();
+            this->workAvailable.notify_all();
+            return false;
+        }
+
+        while (entry->state == Entry::State::Opening && !entry->dropped) {
+            this->entryOpened.wait(lock);
+        }
+
+        if (entry->dropped) {
+            return false;
+        }
+
+        this->entries.remove(entry);
+        this->openFileBytes -= entry->fileBytes;
+    }
+
+    musik::debug::info(TAG, "using prepared decoder for " + uri);
+
+    dataStream = entry->dataStream;
+    decoder = entry->decoder;
+    return true;
+}
+
+void DecoderPool::ThreadLoop() {
+    while (true) {
+        EntryPtr entry;
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+
+            while (!entry) {
+                /* entries are in play order, so open the soonest first, and
+                stop once we're holding as much as we're allowed to, or at
+                the one the transport hasn't asked for yet. */
+                if (this->openFileBytes < this->maxFileBytes) {
+                    for (auto& e : this->entries) {
+                        if (e->deferred) {
+                            break;
+                        }
+                        if (e->state == Entry::State::Queued) {
+                            entry = e;
+                            break;
+                        }
+                    }
+                }
+
+                if (!entry) {
+                    this->workAvailable.wait(lock);
+                }
+            }
+
+            entry->state = Entry::State::Opening;
+        }
+
+        DataStreamPtr dataStream =
+            DataStreamFactory::OpenSharedDataStream(entry->uri.c_str(), OpenFlags::Read);
+
+        DecoderPtr decoder;
+        if (dataStream) {
+            decoder = streams::GetDecoderForDataStream(dataStream);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+
+            const long length = dataStream ? dataStream->Length() : 0;
+            const size_t bytes = length > 0 ? (size_t) length : 0;
+
+            if (!decoder || this->openFileBytes + bytes > this->maxFileBytes) {
+                /* couldn't open it, or it won't fit. either way, whoever
+                plays it next will open it themselves. */
+                entry->dropped = true;
+                this->entries.remove(entry);
+            }
+
+            if (entry->dropped) {
+                entry->state = Entry::State::Ready;
+            }
+            else {
+                entry->dataStream = dataStream;
+                entry->decoder = decoder;
+                entry->fileBytes = bytes;
+                entry->state = Entry::State::Ready;
+                this->openFileBytes += bytes;
+            }
+        }
+
+        this->entryOpened.notify_all();
+
+        /* anything dropped while we were opening it is released here, after
+        the lock; the decoder first, it may still reference the stream. */
+        decoder.reset();
+        dataStream.reset();
+    }
+}
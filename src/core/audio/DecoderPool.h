@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <core/config.h>
+#include <core/io/DataStreamFactory.h>
+#include <core/sdk/IDecoder.h>
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* opens data streams and decoders for the tracks we expect to play next
+    on a background thread, so starting one doesn't wait on the disk, the
+    network or the decoder's format probe. the PlaybackService says what's
+    coming up; Stream::OpenStream takes whatever is ready.
+
+    the first upcoming track is left to the transport, which opens it when
+    it decides to -- right away, or once the current track is within the
+    gapless lookahead of its end -- and the pool only opens the ones after
+    it once the transport has. entries are held open until they're taken or
+    no longer wanted, within a budget on the total size of their files. */
+    class DecoderPool {
+        public:
+            static const int DefaultSize = 2;
+            static const int MaxSize = 8;
+            static const int DefaultMaxFileMegabytes = 256;
+
+            using DataStreamPtr = musik::core::io::DataStreamFactory::DataStreamPtr;
+            using DecoderPtr = std::shared_ptr<musik::core::sdk::IDecoder>;
+
+            static DecoderPool& Instance();
+
+            /* size is the number of upcoming tracks to keep open; zero
+            disables the pool and releases everything it holds. */
+            void Configure(int size, int maxFileMegabytes);
+            size_t Size();
+
+            /* the uris expected to play next, soonest first. entries for
+            anything else are released, and the rest are opened in order,
+            starting after the first has been taken. */
+            void Prepare(const std::vector<std::string>& uris);
+
+            /* hands over the data stream and decoder opened for uri, if
+            there is one. if it's being opened right now this waits for it
+            to finish, which is never slower than opening it again. */
+            bool Take(
+                const std::string& uri,
+                DataStreamPtr& dataStream,
+                DecoderPtr& decoder);
+
+        private:
+            struct Entry {
+                enum class State { Queued, Opening, Ready };
+
+                std::string uri;
+                State state;
+                bool dropped;
+                bool deferred; /* the transport's to open; nothing after it opens yet */
+                DataStreamPtr dataStream;
+                DecoderPtr decoder;
+                size_t fileBytes;
+            };
+
+            using EntryPtr = std::shared_ptr<Entry>;
+            using EntryList = std::list<EntryPtr>;
+
+            DecoderPool();
+
+            void ThreadLoop();
+            void Drop(EntryPtr entry, EntryList& released);
+
+            std::mutex mutex;
+            std::condition_variable workAvailable;
+            std::condition_variable entryOpened;
+            std::unique_ptr<std::thread> thread;
+            EntryList entries; /* in play order */
+            size_t size;
+            size_t maxFileBytes, openFileBytes; /* data stream lengths, not memory */
+    };
+
+} } }
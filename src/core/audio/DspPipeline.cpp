@@ -0,0 +1,268 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include "DspPipeline.h"
+#include <core/debug.h>
+#include <core/support/ThreadPriority.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+using Clock = std::chrono::steady_clock;
+
+static const std::string TAG = "DspPipeline";
+
+/* buffers to measure before we consider splitting the chain */
+#define WARMUP_BUFFERS 16
+
+/* split once the chain takes more than this fraction of the time it takes
+to play the buffer it's processing */
+#define SPLIT_THRESHOLD 0.25
+
+struct Totals {
+    uint64_t processed { 0 };
+    uint64_t bypassed { 0 };
+    double totalMicros { 0.0 };
+    double maxMicros { 0.0 };
+};
+
+static std::mutex statsMutex;
+static std::map<std::string, Totals> stats;
+
+void DspPipeline::GetStats(std::vector<Stats>& target) {
+    std::unique_lock<std::mutex> lock(statsMutex);
+
+    for (auto& it : stats) {
+        const Totals& totals = it.second;
+        Stats result;
+        result.name = it.first;
+        result.processed = totals.processed;
+        result.bypassed = totals.bypassed;
+        result.averageMicros = totals.processed
+            ? totals.totalMicros / (double) totals.processed : 0.0;
+        result.maxMicros = totals.maxMicros;
+        target.push_back(result);
+    }
+}
+
+DspPipeline::DspPipeline(const std::vector<streams::NamedDsp>& dsps)
+: split(0)
+, evaluated(0)
+, inFlight(nullptr)
+, inFlightDone(false)
+, quit(false) {
+    for (auto& dsp : dsps) {
+        Stage stage;
+        stage.name = dsp.first;
+        stage.dsp = dsp.second;
+        stage.bypassable = dynamic_cast<IBypassableDSP*>(dsp.second.get());
+        stage.recentMicros = 0.0;
+        stage.processed = stage.bypassed = 0;
+        stage.totalMicros = stage.maxMicros = 0.0;
+        this->stages.push_back(stage);
+    }
+
+    this->split = this->stages.size();
+}
+
+DspPipeline::~DspPipeline() {
+    if (this->thread) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->quit = true;
+        }
+        this->condition.notify_all();
+        this->thread->join();
+    }
+
+    this->Commit(0, this->stages.size());
+}
+
+Buffer* DspPipeline::Process(Buffer* buffer) {
+    if (!this->thread) {
+        this->Run(buffer, 0, this->stages.size());
+        this->Commit(0, this->stages.size());
+        this->Evaluate(buffer);
+        return buffer;
+    }
+
+    /* first half here, while the worker does the second half of the
+    previous buffer... */
+    this->Run(buffer, 0, this->split);
+    this->Commit(0, this->split);
+
+    /* ... then swap */
+    Buffer* finished = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (this->inFlight && !this->inFlightDone) {
+            this->condition.wait(lock);
+        }
+        finished = this->inFlight;
+        this->inFlight = buffer;
+        this->inFlightDone = false;
+    }
+
+    this->condition.notify_all();
+
+    return finished;
+}
+
+Buffer* DspPipeline::Flush() {
+    if (!this->thread) {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (this->inFlight && !this->inFlightDone) {
+        this->condition.wait(lock);
+    }
+    Buffer* finished = this->inFlight;
+    this->inFlight = nullptr;
+    return finished;
+}
+
+void DspPipeline::Run(Buffer* buffer, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+        Stage& stage = this->stages[i];
+
+        if (stage.bypassable && stage.bypassable->Neutral()) {
+            ++stage.bypassed;
+            stage.recentMicros *= 0.9;
+            continue;
+        }
+
+        auto start = Clock::now();
+        stage.dsp->Process(buffer);
+        double micros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+        ++stage.processed;
+        stage.totalMicros += micros;
+        stage.maxMicros = std::max(stage.maxMicros, micros);
+        stage.recentMicros = (stage.recentMicros * 0.9) + (micros * 0.1);
+    }
+}
+
+void DspPipeline::Commit(size_t from, size_t to) {
+    std::unique_lock<std::mutex> lock(statsMutex);
+
+    for (size_t i = from; i < to; i++) {
+        Stage& stage = this->stages[i];
+        Totals& totals = stats[stage.name];
+        totals.processed += stage.processed;
+        totals.bypassed += stage.bypassed;
+        totals.totalMicros += stage.totalMicros;
+        totals.maxMicros = std::max(totals.maxMicros, stage.maxMicros);
+        stage.processed = stage.bypassed = 0;
+        stage.totalMicros = stage.maxMicros = 0.0;
+    }
+}
+
+void DspPipeline::Evaluate(Buffer* buffer) {
+    /* splitting only helps if there are at least two plugins doing real work */
+    if (this->stages.size() < 2 || ++this->evaluated < WARMUP_BUFFERS) {
+        return;
+    }
+
+    const int channels = std::max(1, buffer->Channels());
+    const double budget = buffer->SampleRate() > 0
+        ? (double) buffer->Samples() / channels / buffer->SampleRate() * 1000000.0
+        : 0.0;
+
+    double total = 0.0;
+    for (auto& stage : this->stages) {
+        total += stage.recentMicros;
+    }
+
+    if (budget <= 0.0 || total <= budget * SPLIT_THRESHOLD) {
+        return;
+    }
+
+    /* balance the two halves as evenly as we can */
+    size_t best = 0;
+    double bestCost = total;
+    double prefix = 0.0;
+    for (size_t i = 1; i < this->stages.size(); i++) {
+        prefix += this->stages[i - 1].recentMicros;
+        double cost = std::max(prefix, total - prefix);
+        if (cost < bestCost) {
+            best = i;
+            bestCost = cost;
+        }
+    }
+
+    if (best == 0) {
+        return;
+    }
+
+    musik::debug::info(TAG, "chain costs " + std::to_string((int) total) +
+        "us per " + std::to_string((int) budget) + "us buffer, splitting at " +
+        this->stages[best].name);
+
+    /* the stages are handed over exactly once; each plugin keeps running
+    on the same thread from here on. */
+    this->split = best;
+    this->thread.reset(new std::thread(std::bind(&DspPipeline::ThreadLoop, this)));
+}
+
+void DspPipeline::ThreadLoop() {
+    musik::core::threads::Configure(musik::core::threads::Role::Audio);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    while (!this->quit) {
+        if (!this->inFlight || this->inFlightDone) {
+            this->condition.wait(lock);
+            continue;
+        }
+
+        Buffer* buffer = this->inFlight;
+
+        lock.unlock();
+        this->Run(buffer, this->split, this->stages.size());
+        this->Commit(this->split, this->stages.size());
+        lock.lock();
+
+        this->inFlightDone = true;
+        this->condition.notify_all();
+    }
+}
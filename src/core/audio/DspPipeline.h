@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <core/config.h>
+#include <core/audio/Buffer.h>
+#include <core/audio/Streams.h>
+#include <core/sdk/IBypassableDSP.h>
+#include <core/sdk/IDSP.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* runs a Stream's DSP plugins over each buffer. plugins that report
+    themselves neutral are skipped, and every plugin is timed. if the chain
+    starts eating a significant part of each buffer's real-time budget, it is
+    split in two and the second half runs on a worker thread, one buffer
+    behind the first; Process() then returns the previous buffer. */
+    class DspPipeline {
+        public:
+            /* accumulated across every pipeline in the process, by plugin */
+            struct Stats {
+                std::string name;
+                uint64_t processed; /* buffers the plugin ran on */
+                uint64_t bypassed; /* buffers skipped because it was neutral */
+                double averageMicros; /* per processed buffer */
+                double maxMicros;
+            };
+
+            static void GetStats(std::vector<Stats>& target);
+
+            DspPipeline(const std::vector<streams::NamedDsp>& dsps);
+            ~DspPipeline();
+
+            bool Empty() const { return this->stages.empty(); }
+
+            /* returns the buffer that has made it all the way through the
+            chain, which is 'buffer' itself unless we're pipelined. returns
+            nullptr while the pipeline fills. */
+            Buffer* Process(Buffer* buffer);
+
+            /* waits for, and returns, the buffer still in the second half of
+            the chain, if any. call at the end of the stream, and after seeks. */
+            Buffer* Flush();
+
+        private:
+            struct Stage {
+                std::string name;
+                std::shared_ptr<musik::core::sdk::IDSP> dsp;
+                musik::core::sdk::IBypassableDSP* bypassable;
+                double recentMicros; /* smoothed, for choosing the split */
+                uint64_t processed, bypassed; /* not yet added to Stats */
+                double totalMicros, maxMicros;
+            };
+
+            void Run(Buffer* buffer, size_t from, size_t to);
+            void Commit(size_t from, size_t to);
+            void Evaluate(Buffer* buffer);
+            void ThreadLoop();
+
+            std::vector<Stage> stages;
+            size_t split; /* stages [split, end) run on the worker, if any */
+            int evaluated;
+
+            std::unique_ptr<std::thread> thread;
+            std::mutex mutex;
+            std::condition_variable condition;
+            Buffer* inFlight;
+            bool inFlightDone;
+            bool quit;
+    };
+
+} } }
@@ -0,0 +1,221 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#include "pch.hpp"
+
+#include <core/audio/FormatConverter.h>
+
+#include <algorithm>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+#define MINUS_3DB 0.70710678f
+
+/* how each input channel contributes to a stereo downmix, in WAVE order:
+FL FR FC LFE BL BR SL SR. the LFE channel is dropped. */
+struct StereoWeights {
+    float left, right;
+};
+
+static const StereoWeights FRONT_LEFT = { 1.0f, 0.0f };
+static const StereoWeights FRONT_RIGHT = { 0.0f, 1.0f };
+static const StereoWeights CENTER = { MINUS_3DB, MINUS_3DB };
+static const StereoWeights LFE = { 0.0f, 0.0f };
+static const StereoWeights SURROUND_LEFT = { MINUS_3DB, 0.0f };
+static const StereoWeights SURROUND_RIGHT = { 0.0f, MINUS_3DB };
+
+static const StereoWeights* stereoDownmix(int channels) {
+    static const StereoWeights three[] =
+        { FRONT_LEFT, FRONT_RIGHT, CENTER };
+    static const StereoWeights four[] =
+        { FRONT_LEFT, FRONT_RIGHT, SURROUND_LEFT, SURROUND_RIGHT };
+    static const StereoWeights five[] =
+        { FRONT_LEFT, FRONT_RIGHT, CENTER, SURROUND_LEFT, SURROUND_RIGHT };
+    static const StereoWeights six[] =
+        { FRONT_LEFT, FRONT_RIGHT, CENTER, LFE, SURROUND_LEFT, SURROUND_RIGHT };
+    static const StereoWeights eight[] =
+        { FRONT_LEFT, FRONT_RIGHT, CENTER, LFE, SURROUND_LEFT, SURROUND_RIGHT, SURROUND_LEFT, SURROUND_RIGHT };
+
+    switch (channels) {
+        case 3: return three;
+        case 4: return four;
+        case 5: return five;
+        case 6: return six;
+        case 8: return eight;
+        default: return nullptr;
+    }
+}
+
+FormatConverter::FormatConverter(long sampleRate, int channels)
+: sampleRate(sampleRate)
+, channels(channels)
+, outputRate(0)
+, outputChannels(0) {
+}
+
+void FormatConverter::Reset() {
+    if (this->resampler) {
+        this->resampler->Reset();
+    }
+}
+
+bool FormatConverter::Passthrough(IBuffer* input) {
+    const bool rateMatches = !this->sampleRate || this->sampleRate == input->SampleRate();
+    const bool channelsMatch = !this->channels || this->channels == input->Channels();
+
+    if (rateMatches && channelsMatch) {
+        this->resampler.reset();
+        return true;
+    }
+
+    return false;
+}
+
+void FormatConverter::Convert(IBuffer* input, IBuffer* output) {
+    const long inputRate = input->SampleRate();
+    const int inputChannels = input->Channels();
+    const long frames = input->Samples() / inputChannels;
+
+    this->outputRate = this->sampleRate ? this->sampleRate : inputRate;
+    this->outputChannels = this->channels ? this->channels : inputChannels;
+
+    const float* samples = input->BufferPointer();
+
+    if (inputChannels != this->outputChannels) {
+        this->Remix(samples, inputChannels, frames);
+        samples = this->remixed.data();
+    }
+
+    if (inputRate != this->outputRate) {
+        if (!this->resampler ||
+            this->resampler->InputRate() != inputRate ||
+            this->resampler->Channels() != this->outputChannels)
+        {
+            this->resampler.reset(new Resampler(
+                inputRate, this->outputRate, this->outputChannels));
+        }
+
+        this->resampled.clear();
+        this->resampler->Process(samples, frames, this->resampled);
+        this->Write(this->resampled.data(), (long) this->resampled.size(), output);
+    }
+    else {
+        this->resampler.reset();
+        this->Write(samples, frames * this->outputChannels, output);
+    }
+}
+
+bool FormatConverter::Drain(IBuffer* output) {
+    if (this->resampler) {
+        this->resampled.clear();
+        this->resampler->Drain(this->resampled);
+
+        if (this->resampled.size()) {
+            this->Write(this->resampled.data(), (long) this->resampled.size(), output);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void FormatConverter::Write(const float* samples, long count, IBuffer* output) {
+    output->SetSampleRate(this->outputRate);
+    output->SetChannels(this->outputChannels);
+    output->SetSamples(count);
+    std::copy(samples, samples + count, output->BufferPointer());
+}
+
+void FormatConverter::Remix(const float* input, int inputChannels, long frames) {
+    const int outputChannels = this->outputChannels;
+
+    this->remixed.resize((size_t) frames * outputChannels);
+    float* output = this->remixed.data();
+
+    const StereoWeights* weights = (outputChannels == 2)
+        ? stereoDownmix(inputChannels) : nullptr;
+
+    if (outputChannels == 1) {
+        /* everything, averaged */
+        const float scale = 1.0f / (float) inputChannels;
+        for (long i = 0; i < frames; i++) {
+            float sum = 0.0f;
+            for (int c = 0; c < inputChannels; c++) {
+                sum += input[c];
+            }
+            output[i] = sum * scale;
+            input += inputChannels;
+        }
+    }
+    else if (weights) {
+        /* normalized, so a full scale signal in every channel can't clip */
+        float leftTotal = 0.0f, rightTotal = 0.0f;
+        for (int c = 0; c < inputChannels; c++) {
+            leftTotal += weights[c].left;
+            rightTotal += weights[c].right;
+        }
+
+        for (long i = 0; i < frames; i++) {
+            float left = 0.0f, right = 0.0f;
+            for (int c = 0; c < inputChannels; c++) {
+                left += input[c] * weights[c].left;
+                right += input[c] * weights[c].right;
+            }
+            output[0] = left / leftTotal;
+            output[1] = right / rightTotal;
+            input += inputChannels;
+            output += 2;
+        }
+    }
+    else if (inputChannels == 1) {
+        /* mono goes to the front left and right speakers */
+        for (long i = 0; i < frames; i++) {
+            output[0] = output[1] = input[i];
+            std::fill(output + 2, output + outputChannels, 0.0f);
+            output += outputChannels;
+        }
+    }
+    else {
+        /* no sensible mapping; keep the channels we share, silence the rest */
+        const int shared = std::min(inputChannels, outputChannels);
+        for (long i = 0; i < frames; i++) {
+            std::copy(input, input + shared, output);
+            std::fill(output + shared, output + outputChannels, 0.0f);
+            input += inputChannels;
+            output += outputChannels;
+        }
+    }
+}
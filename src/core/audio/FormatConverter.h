@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <core/config.h>
+#include <core/audio/Resampler.h>
+#include <core/sdk/IBuffer.h>
+
+#include <memory>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* converts decoded audio to a fixed sample rate and channel count, so
+    the output can be configured once and left alone. channels are re-mapped
+    first (WAVE channel order is assumed), then resampled. a value of 0 for
+    either target means "leave it as it is". */
+    class FormatConverter {
+        public:
+            FormatConverter(long sampleRate, int channels);
+
+            FormatConverter(const FormatConverter&) = delete;
+
+            /* true if 'input' is already in the target format, in which case
+            the caller can use it as is and skip Convert() */
+            bool Passthrough(musik::core::sdk::IBuffer* input);
+
+            /* replaces the contents of 'output' with the converted version of
+            'input'. output may be empty while the resampler fills up. */
+            void Convert(musik::core::sdk::IBuffer* input, musik::core::sdk::IBuffer* output);
+
+            /* writes whatever the resampler is still holding; call at end
+            of stream. returns false if there was nothing left. */
+            bool Drain(musik::core::sdk::IBuffer* output);
+
+            /* discard buffered input, e.g. after a seek */
+            void Reset();
+
+        private:
+            void Remix(const float* input, int inputChannels, long frames);
+            void Write(const float* samples, long count, musik::core::sdk::IBuffer* output);
+
+            long sampleRate;
+            int channels;
+            long outputRate;
+            int outputChannels;
+            std::unique_ptr<Resampler> resampler;
+            std::vector<float> remixed;
+            std::vector<float> resampled;
+    };
+
+} } }
@@ -0,0 +1,363 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <core/audio/GainStage.h>
+#include <core/sdk/SampleOps.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+/* how far ahead we look for peaks, and how quickly the gain recovers once
+they've passed. shorter look-ahead means less latency, but a harder knee. */
+#define LOOKAHEAD_MS 1.5
+#define RELEASE_MS 80.0
+
+/* true peaks can sit a little above the sample peak the tags give us, so
+we start limiting a bit before the sample peak reaches the ceiling. */
+#define TRUE_PEAK_MARGIN_DB 2.0f
+
+/* the 4x oversampling interpolator from ITU-R BS.1770-4, annex 2 */
+#define TAPS 12
+#define PHASES 4
+
+static const float COEFFICIENTS[PHASES][TAPS] = {
+    {
+        0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f,
+        -0.0594482421875f, 0.1373291015625f, 0.9721679687500f, -0.1022949218750f,
+        0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f
+    },
+    {
+        -0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f,
+        -0.1665039062500f, 0.4650878906250f, 0.7797851562500f, -0.2003173828125f,
+        0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f
+    },
+    {
+        -0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f,
+        -0.2003173828125f, 0.7797851562500f, 0.4650878906250f, -0.1665039062500f,
+        0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f
+    },
+    {
+        -0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f,
+        -0.1022949218750f, 0.9721679687500f, 0.1373291015625f, -0.0594482421875f,
+        0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f
+    }
+};
+
+static inline float dbToLinear(float db) {
+    return powf(10.0f, db / 20.0f);
+}
+
+GainStage::GainStage()
+: gain(1.0f)
+, ceiling(1.0f)
+, limit(false)
+, sampleRate(0)
+, channels(0)
+, lookahead(0)
+, hold(0)
+, delay(0)
+, release(1.0f)
+, minHead(0)
+, minTail(0)
+, boxSum(0.0)
+, boxPos(0)
+, envelope(1.0f)
+, frame(0)
+, held(0)
+, skip(0) {
+}
+
+void GainStage::Configure(float gain, float peakGain, float ceilingDecibels, bool limit) {
+    this->ceiling = dbToLinear(std::min(0.0f, ceilingDecibels));
+    this->gain = gain;
+    this->limit = false;
+
+    if (!limit) {
+        /* https://wiki.hydrogenaud.io/index.php?title=ReplayGain_2.0_specification#Reduced_gain */
+        if (peakGain > 0.0f) {
+            this->gain = std::min(gain, peakGain);
+        }
+    }
+    else if (peakGain > 0.0f) {
+        this->limit = gain > peakGain * this->ceiling / dbToLinear(TRUE_PEAK_MARGIN_DB);
+    }
+    else {
+        /* no idea where the peaks are; anything louder than it was could clip */
+        this->limit = gain > 1.0f;
+    }
+
+    this->sampleRate = this->channels = 0;
+}
+
+void GainStage::Prepare(long sampleRate, int channels) {
+    this->sampleRate = sampleRate;
+    this->channels = channels;
+
+    /* the gain computer guarantees the gain is down to what a peak needs
+    'lookahead' frames after it sees it, and holds it there for as long as
+    it takes the interpolator to get past it (TAPS). the audio is delayed
+    to match, so every sample that contributed to the peak is covered. */
+    this->lookahead = std::max(1L, (long) ((double) sampleRate * LOOKAHEAD_MS / 1000.0));
+    this->hold = this->lookahead + TAPS;
+    this->delay = this->lookahead + TAPS - 1;
+    this->release = (float) (1.0 - exp(-1000.0 / (RELEASE_MS * (double) sampleRate)));
+
+    this->history.assign(channels, std::vector<float>());
+    this->planes.assign(channels, nullptr);
+    this->minIndex.assign(this->hold + 1, 0);
+    this->minValue.assign(this->hold + 1, 1.0f);
+    this->box.assign(this->lookahead, 1.0f);
+
+    /* sized by Reserve() once we know how big the buffers are */
+    this->peaks.clear();
+    this->pending.clear();
+
+    this->Reset();
+}
+
+void GainStage::Reserve(long frames) {
+    /* only allocates for the first few buffers, or if they get bigger */
+    if ((long) this->peaks.size() >= frames) {
+        return;
+    }
+
+    for (int c = 0; c < this->channels; c++) {
+        auto& samples = this->history[c];
+        samples.resize(TAPS - 1 + frames, 0.0f);
+        this->planes[c] = samples.data() + TAPS - 1;
+    }
+
+    this->phase.resize(frames);
+    this->peaks.resize(frames);
+    this->gains.resize(frames);
+    this->expanded.resize(frames * this->channels);
+    this->pending.resize((this->delay + frames) * this->channels, 0.0f);
+}
+
+void GainStage::Reset() {
+    for (auto& samples : this->history) {
+        std::fill(samples.begin(), samples.end(), 0.0f);
+    }
+
+    std::fill(this->pending.begin(), this->pending.end(), 0.0f);
+    std::fill(this->box.begin(), this->box.end(), 1.0f);
+
+    this->minHead = this->minTail = 0;
+    this->boxSum = (double) this->box.size();
+    this->boxPos = 0;
+    this->envelope = 1.0f;
+    this->frame = 0;
+    this->held = 0;
+    this->skip = this->delay;
+}
+
+void GainStage::Process(IBuffer* buffer) {
+    float* samples = buffer->BufferPointer();
+    const long count = buffer->Samples();
+
+    if (!this->limit) {
+        if (this->gain != 1.0f) {
+            sampleops::Scale(samples, count, this->gain);
+        }
+        return;
+    }
+
+    const int channels = std::max(1, buffer->Channels());
+    const long frames = count / channels;
+
+    if (buffer->SampleRate() != this->sampleRate || channels != this->channels) {
+        this->Prepare(buffer->SampleRate(), channels);
+    }
+
+    if (frames <= 0) {
+        return;
+    }
+
+    this->Reserve(frames);
+
+    sampleops::Scale(samples, frames * channels, this->gain);
+
+    this->DetectPeaks(samples, frames);
+    this->ComputeGains(frames);
+    this->ApplyDelayed(samples, frames);
+
+    this->held = std::min(this->delay, this->held + frames);
+
+    if (this->skip > 0) {
+        /* the delay line starts out full of silence; don't play it */
+        const long drop = std::min(this->skip, frames);
+        std::copy(samples + drop * channels, samples + frames * channels, samples);
+        buffer->SetSamples((frames - drop) * channels);
+        this->skip -= drop;
+    }
+}
+
+bool GainStage::Flush(IBuffer* buffer) {
+    if (!this->limit || this->held <= 0) {
+        return false;
+    }
+
+    /* pushing a delay's worth of silence through brings out everything
+    we're holding, with the gain it was due. */
+    const long count = this->delay * this->channels;
+    buffer->SetSampleRate(this->sampleRate);
+    buffer->SetChannels(this->channels);
+    buffer->SetSamples(count);
+    std::fill(buffer->BufferPointer(), buffer->BufferPointer() + count, 0.0f);
+
+    this->Process(buffer);
+    this->held = 0;
+
+    return buffer->Samples() > 0;
+}
+
+void GainStage::DetectPeaks(const float* samples, long frames) {
+    float* peaks = this->peaks.data();
+    float* phase = this->phase.data();
+
+    std::fill(peaks, peaks + frames, 0.0f);
+
+    sampleops::Deinterleave(samples, this->channels, frames, this->planes.data());
+
+    for (int c = 0; c < this->channels; c++) {
+        float* history = this->history[c].data();
+        const float* current = this->planes[c];
+
+        sampleops::MaxAbs(current, peaks, frames);
+
+        /* each phase is evaluated a tap at a time across the whole buffer,
+        so the work is done by a handful of long vector loops, rather than
+        lots of short dot products. */
+        for (int p = 0; p < PHASES; p++) {
+            std::fill(phase, phase + frames, 0.0f);
+            for (int k = 0; k < TAPS; k++) {
+                sampleops::ScaleAdd(current - k, phase, frames, COEFFICIENTS[p][k]);
+            }
+            sampleops::MaxAbs(phase, peaks, frames);
+        }
+
+        /* keep the tail around for the start of the next buffer */
+        std::copy(history + frames, history + frames + TAPS - 1, history);
+    }
+}
+
+void GainStage::ComputeGains(long frames) {
+    const float ceiling = this->ceiling;
+    const long capacity = (long) this->minValue.size();
+    const long lookahead = this->lookahead;
+    const float scale = 1.0f / (float) lookahead;
+
+    for (long i = 0; i < frames; i++, this->frame++) {
+        const float peak = this->peaks[i];
+        const float required = peak > ceiling ? ceiling / peak : 1.0f;
+
+        /* minimum of the required gain over the last 'hold' frames */
+        if (this->minHead != this->minTail &&
+            this->minIndex[this->minHead] <= this->frame - this->hold)
+        {
+            this->minHead = (this->minHead + 1) % capacity;
+        }
+
+        while (this->minTail != this->minHead) {
+            const long last = (this->minTail + capacity - 1) % capacity;
+            if (this->minValue[last] < required) {
+                break;
+            }
+            this->minTail = last;
+        }
+
+        this->minIndex[this->minTail] = this->frame;
+        this->minValue[this->minTail] = required;
+        this->minTail = (this->minTail + 1) % capacity;
+
+        const float held = this->minValue[this->minHead];
+
+        /* ... smoothed by a moving average, so it ramps down over the
+        look-ahead instead of stepping ... */
+        this->boxSum += held - this->box[this->boxPos];
+        this->box[this->boxPos] = held;
+        this->boxPos = (this->boxPos + 1) % lookahead;
+
+        const float target = std::min(1.0f, (float) this->boxSum * scale);
+
+        /* ... and allowed to recover slowly once the peak has passed */
+        if (target < this->envelope) {
+            this->envelope = target;
+        }
+        else {
+            this->envelope += (target - this->envelope) * this->release;
+        }
+
+        this->gains[i] = this->envelope;
+    }
+}
+
+void GainStage::ApplyDelayed(float* samples, long frames) {
+    const int channels = this->channels;
+    const long delayed = this->delay * channels;
+    const long count = frames * channels;
+    float* pending = this->pending.data();
+
+    /* queue this buffer behind what we held back last time, then write out
+    the oldest 'frames' worth with the gain computed for them. */
+    std::copy(samples, samples + count, pending + delayed);
+
+    float* expanded = this->expanded.data();
+    if (channels == 1) {
+        std::copy(this->gains.begin(), this->gains.begin() + frames, expanded);
+    }
+    else {
+        const float* gains = this->gains.data();
+        const float* planes[] = { gains, gains };
+        if (channels == 2) {
+            sampleops::Interleave(planes, 2, frames, expanded);
+        }
+        else {
+            for (long i = 0; i < frames; i++) {
+                std::fill(expanded, expanded + channels, gains[i]);
+                expanded += channels;
+            }
+            expanded = this->expanded.data();
+        }
+    }
+
+    sampleops::Multiply(pending, expanded, samples, count);
+
+    std::copy(pending + count, pending + count + delayed, pending);
+}
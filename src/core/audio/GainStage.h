@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <core/config.h>
+#include <core/sdk/IBuffer.h>
+
+#include <stdint.h>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* applies replay gain and preamp to each buffer the Player is about to
+    write to the output. if the gain could take the track over the ceiling,
+    a look-ahead true-peak limiter brings it back down, instead of letting
+    the output clip. everything that only depends on the track is worked
+    out once, by Configure(); the rest on the first buffer, and again if the
+    format changes. not thread safe; the Player only uses it from its own
+    thread. */
+    class GainStage {
+        public:
+            GainStage();
+
+            /* gain is linear, preamp included. peakGain is the largest gain
+            the track takes without its samples clipping (1 / peak), or zero if
+            we don't know. if limit is false we fall back to reducing the gain
+            until the peak fits, as the replay gain spec suggests. */
+            void Configure(float gain, float peakGain, float ceilingDecibels, bool limit);
+
+            /* when limiting, the output lags the input by a few milliseconds
+            of look-ahead; the first buffer after a reset comes back that much
+            shorter, so it doesn't start with silence. */
+            void Process(musik::core::sdk::IBuffer* buffer);
+
+            /* writes the audio still held back for look-ahead into 'buffer',
+            once the input has ended. returns false if there was none. */
+            bool Flush(musik::core::sdk::IBuffer* buffer);
+
+            /* forgets the audio held back for look-ahead; used when seeking */
+            void Reset();
+
+            float Gain() const { return this->gain; }
+            bool Limiting() const { return this->limit; }
+
+        private:
+            void Prepare(long sampleRate, int channels);
+            void Reserve(long frames);
+            void DetectPeaks(const float* samples, long frames);
+            void ComputeGains(long frames);
+            void ApplyDelayed(float* samples, long frames);
+
+            /* configuration */
+            float gain, ceiling;
+            bool limit;
+
+            /* derived from the format */
+            long sampleRate;
+            int channels;
+            long lookahead, hold, delay;
+            float release;
+
+            /* state */
+            std::vector<std::vector<float>> history; /* per channel */
+            std::vector<float*> planes; /* the new samples in each history */
+            std::vector<float> phase, peaks, gains, expanded, pending;
+            std::vector<int64_t> minIndex; /* sliding minimum of the required gain */
+            std::vector<float> minValue;
+            long minHead, minTail;
+            std::vector<float> box; /* moving average of the above */
+            double boxSum;
+            long boxPos;
+            float envelope;
+            int64_t frame;
+            long held; /* frames of real audio in the delay line */
+            long skip; /* frames of initial silence still to come out of it */
+    };
+
+} } }
@@ -38,8 +38,13 @@
 #include <core/audio/GaplessTransport.h>
 #include <core/plugin/PluginFactory.h>
 #include <core/audio/Outputs.h>
+#include <core/support/Preferences.h>
+#include <core/support/PreferenceKeys.h>
 #include <algorithm>
 
+#define LOOKAHEAD_MIXPOINT 1002
+
+using namespace musik::core;
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
 
@@ -50,14 +55,16 @@ static std::string TAG = "GaplessTransport";
         instance->nextPlayer->Detach(instance); \
         instance->nextPlayer->Destroy(); \
         instance->nextPlayer = nullptr; \
-    }
+    } \
+    instance->pendingUri.clear();
 
 #define RESET_ACTIVE_PLAYER(instance) \
     if (instance->activePlayer) { \
         instance->activePlayer->Detach(instance); \
         instance->activePlayer->Destroy(); \
         instance->activePlayer = nullptr; \
-    }
+    } \
+    instance->lookaheadPlayer = nullptr;
 
 GaplessTransport::GaplessTransport()
 : volume(1.0)
@@ -65,7 +72,10 @@ GaplessTransport::GaplessTransport()
 , activePlayer(nullptr)
 , nextPlayer(nullptr)
 , nextCanStart(false)
-, muted(false) {
+, muted(false)
+, lookaheadPlayer(nullptr)
+, lookaheadSeconds(0.0)
+, prebufferSeconds(0.0) {
     this->output = outputs::SelectedOutput();
 }
 
@@ -87,9 +97,22 @@ void GaplessTransport::PrepareNextTrack(const std::string& uri, Gain gain) {
 
         RESET_NEXT_PLAYER(this);
 
+        auto playbackPrefs = Preferences::ForComponent(prefs::components::Playback);
+
+        this->lookaheadSeconds = std::max(0.0,
+            playbackPrefs->GetDouble(prefs::keys::GaplessLookaheadSeconds, 0.0));
+
+        this->prebufferSeconds = std::max(0.0,
+            playbackPrefs->GetDouble(prefs::keys::GaplessPrebufferSeconds, 0.0));
+
         if (uri.size()) {
-            this->nextPlayer = Player::Create(uri, this->output, Player::NoDrain, this, gain);
-            startNext = this->nextCanStart;
+            this->pendingUri = uri;
+            this->pendingGain = gain;
+
+            if (!this->DeferNextTrack()) {
+                this->PreparePendingTrack();
+                startNext = this->nextCanStart;
+            }
         }
     }
 
@@ -98,6 +121,48 @@ void GaplessTransport::PrepareNextTrack(const std::string& uri, Gain gain) {
     }
 }
 
+bool GaplessTransport::DeferNextTrack() {
+    /* called with the state lock held. holding off means the next track
+    doesn't sit on a file handle or network connection, and a pool full of
+    buffers, for the whole of the current one. */
+    Player* player = this->activePlayer;
+
+    if (this->lookaheadSeconds <= 0.0 || !player || this->nextCanStart) {
+        return false;
+    }
+
+    const double duration = player->GetDuration();
+    const double time = duration - this->lookaheadSeconds;
+
+    /* length unknown, or we're already there */
+    if (duration <= 0.0 || player->GetPosition() >= time) {
+        return false;
+    }
+
+    if (this->lookaheadPlayer != player) {
+        player->AddMixPoint(LOOKAHEAD_MIXPOINT, time);
+        this->lookaheadPlayer = player;
+    }
+
+    return true;
+}
+
+void GaplessTransport::PreparePendingTrack() {
+    /* called with the state lock held. the player opens the stream, and
+    decodes up to prebufferSeconds, as soon as it's created. */
+    if (this->pendingUri.size() && !this->nextPlayer) {
+        this->nextPlayer = Player::Create(
+            this->pendingUri,
+            this->output,
+            Player::NoDrain,
+            this,
+            this->pendingGain,
+            this->prebufferSeconds);
+
+        this->pendingUri.clear();
+    }
+}
+
 void GaplessTransport::Start(const std::string& uri, Gain gain, StartMode mode) {
     musik::debug::info(TAG, "starting track at " + uri);
     Player* newPlayer = Player::Create(uri, this->output, Player::NoDrain, this, gain);
@@ -116,6 +181,17 @@ void GaplessTransport::StartWithPlayer(Player* newPlayer, StartMode mode) {
                 RESET_NEXT_PLAYER(this);
             }
 
+            /* whatever the outgoing player has already given the output
+            will play before we're heard. */
+            if (playingNext && this->activePlayer) {
+                this->handoff.player = newPlayer;
+                this->handoff.time = std::chrono::steady_clock::now();
+                this->handoff.queuedSeconds = this->activePlayer->GetQueuedSeconds();
+            }
+            else {
+                this->handoff.player = nullptr;
+            }
+
             RESET_ACTIVE_PLAYER(this);
 
             this->nextPlayer = nullptr;
@@ -297,6 +373,7 @@ void GaplessTransport::OnPlayerPrepared(Player* player) {
 }
 
 void GaplessTransport::OnPlayerStarted(Player* player) {
+    this->RecordTransition(player);
     this->RaiseStreamEvent(StreamPlaying, player);
     this->SetPlaybackState(PlaybackPlaying);
 }
@@ -307,6 +384,10 @@ void GaplessTransport::OnPlayerAlmostEnded(Player* player) {
     {
         LockT lock(this->stateMutex);
 
+        /* we never reached the lookahead point (maybe the user seeked past it),
+        so the next track is only now being opened. */
+        this->PreparePendingTrack();
+
         /* if another component configured a next player while we were playing,
         go ahead and get it started now. */
         if (this->nextPlayer) {
@@ -367,6 +448,58 @@ void GaplessTransport::OnPlayerDestroying(Player *player) {
     }
 }
 
+void GaplessTransport::OnPlayerMixPoint(Player* player, int id, double time) {
+    if (id == LOOKAHEAD_MIXPOINT) {
+        LockT lock(this->stateMutex);
+
+        if (player == this->activePlayer) {
+            this->PreparePendingTrack();
+        }
+    }
+}
+
+void GaplessTransport::RecordTransition(Player* player) {
+    LockT lock(this->stateMutex);
+
+    if (player != this->handoff.player) {
+        return;
+    }
+
+    this->handoff.player = nullptr;
+
+    std::chrono::steady_clock::time_point firstWrite;
+    long sampleRate = 0;
+    if (!player->GetFirstWrite(firstWrite, sampleRate) || sampleRate <= 0) {
+        return;
+    }
+
+    const double elapsed =
+        std::chrono::duration<double>(firstWrite - this->handoff.time).count();
+
+    const double gap = elapsed - this->handoff.queuedSeconds;
+    const long samples = gap > 0.0 ? (long)(gap * (double) sampleRate) : 0;
+
+    auto& stats = this->transitionStats;
+    ++stats.transitions;
+    stats.gapless += (samples == 0) ? 1 : 0;
+    stats.lastGapSamples = samples;
+    stats.maxGapSamples = std::max(stats.maxGapSamples, samples);
+    stats.totalGapSamples += samples;
+
+    auto metrics = player->Metrics();
+    ++metrics->transitions;
+    metrics->transitionGapMicros.Record(gap > 0.0 ? (uint64_t)(gap * 1000000.0) : 0);
+
+    musik::debug::info(TAG, "track transition gap: " + std::to_string(samples) +
+        " samples (" + std::to_string(stats.gapless) + " of " +
+        std::to_string(stats.transitions) + " gapless)");
+}
+
+GaplessTransport::TransitionStats GaplessTransport::GetTransitionStats() {
+    LockT lock(this->stateMutex);
+    return this->transitionStats;
+}
+
 void GaplessTransport::SetPlaybackState(int state) {
     bool changed = false;
 
@@ -40,6 +40,7 @@
 #include <core/sdk/IOutput.h>
 #include <core/sdk/constants.h>
 
+#include <chrono>
 #include <thread>
 #include <mutex>
 
@@ -77,6 +78,19 @@ namespace musik { namespace core { namespace audio {
 
             virtual musik::core::sdk::PlaybackState GetPlaybackState();
 
+            /* how much silence we've left between tracks. a gap is measured
+            from when the outgoing track ran out of audio queued in the output
+            to when the incoming track first wrote to it. */
+            struct TransitionStats {
+                long transitions { 0 };
+                long gapless { 0 }; /* transitions without a measurable gap */
+                long lastGapSamples { 0 };
+                long maxGapSamples { 0 };
+                long long totalGapSamples { 0 };
+            };
+
+            TransitionStats GetTransitionStats();
+
         private:
             using LockT = std::unique_lock<std::recursive_mutex>;
 
@@ -88,6 +102,9 @@ namespace musik { namespace core { namespace audio {
                 Player* exclude = nullptr);
 
             void SetNextCanStart(bool nextCanStart);
+            bool DeferNextTrack();
+            void PreparePendingTrack();
+            void RecordTransition(Player* player);
 
             void RaiseStreamEvent(int type, Player* player);
             void SetPlaybackState(int state);
@@ -98,6 +115,13 @@ namespace musik { namespace core { namespace audio {
             virtual void OnPlayerFinished(Player* player);
             virtual void OnPlayerError(Player* player);
             virtual void OnPlayerDestroying(Player* player);
+            virtual void OnPlayerMixPoint(Player* player, int id, double time);
+
+            struct Handoff {
+                Player* player { nullptr }; /* the incoming player */
+                std::chrono::steady_clock::time_point time;
+                double queuedSeconds { 0.0 }; /* still to play from the outgoing one */
+            };
 
             musik::core::sdk::PlaybackState state;
             std::recursive_mutex stateMutex;
@@ -107,6 +131,17 @@ namespace musik { namespace core { namespace audio {
             double volume;
             bool nextCanStart;
             bool muted;
+
+            /* if lookaheadSeconds is set, the next track is held here until the
+            active one is that close to the end. */
+            std::string pendingUri;
+            Gain pendingGain;
+            Player* lookaheadPlayer;
+            double lookaheadSeconds;
+            double prebufferSeconds;
+
+            Handoff handoff;
+            TransitionStats transitionStats;
     };
 
 } } }
@@ -39,6 +39,7 @@
 #include <core/sdk/IDecoder.h>
 #include <core/sdk/IDSP.h>
 #include <core/sdk/IDecoderFactory.h>
+#include <core/audio/StreamMetrics.h>
 
 #include <list>
 
@@ -48,9 +49,13 @@ namespace musik { namespace core { namespace audio {
         public:
             virtual musik::core::sdk::IBuffer* GetNextProcessedOutputBuffer() = 0;
             virtual void OnBufferProcessedByPlayer(musik::core::sdk::IBuffer* buffer) = 0;
+            virtual void OnBufferDiscardedByPlayer(musik::core::sdk::IBuffer* buffer) = 0;
             virtual double SetPosition(double seconds) = 0;
             virtual double GetDuration() = 0;
             virtual bool OpenStream(std::string uri) = 0;
+            virtual void SetOutputFormat(long sampleRate, int channels) = 0;
+            virtual void SetPrebufferSeconds(double seconds) = 0;
+            virtual void SetMetrics(StreamMetrics::Ptr metrics) = 0;
             virtual void Interrupt() = 0;
             virtual int GetCapabilities() = 0;
             virtual bool Eof() = 0;
@@ -66,9 +66,9 @@ void MasterTransport::SwitchTo(Type type) {
         switch (this->type) {
             case Type::Gapless:
                 if (this->transport) {
-                    /* hacky -- we know it's a crossfade transport, stop it
-                    immediately without fading out so we don't block the UI
-                    for a second or so. */
+                    /* hacky -- we know it's a crossfade transport (either
+                    mode), stop it immediately without fading out so we don't
+                    block the UI for a second or so. */
                     static_cast<CrossfadeTransport*>
                         (this->transport.get())->StopImmediately();
                 }
@@ -79,6 +79,11 @@ void MasterTransport::SwitchTo(Type type) {
             case Type::Crossfade:
                 this->transport.reset(new CrossfadeTransport());
                 break;
+
+            case Type::Mixing:
+                this->transport.reset(
+                    new CrossfadeTransport(CrossfadeTransport::Mode::Mixer));
+                break;
         }
 
         if (volume > 0) {
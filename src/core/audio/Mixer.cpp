@@ -0,0 +1,834 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <core/audio/Mixer.h>
+#include <core/audio/Outputs.h>
+#include <core/sdk/constants.h>
+#include <core/support/ThreadPriority.h>
+
+#include <algorithm>
+#include <math.h>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+#define MIX_FRAMES 1024
+#define MIX_BUFFER_COUNT 16
+#define CHANNEL_BUFFER_COUNT 8
+#define RETRY_MS 100
+#define READY_TIMEOUT_MS 1000
+#define STARVED_MS 250
+#define HALF_PI 1.57079632679489661923
+
+using Channel = Mixer::Channel;
+
+/* ------------------------------------------------------------------------ */
+
+std::shared_ptr<Mixer> Mixer::Create() {
+    return std::shared_ptr<Mixer>(new Mixer());
+}
+
+Mixer::Mixer()
+: curve(Curve::EqualPower)
+, processed(0)
+, flushes(0)
+, generation(0)
+, quit(false)
+, writing(false)
+, outputPaused(false)
+, outputStopped(false)
+, starving(false) {
+    /* volume is applied per channel while mixing */
+    this->output = outputs::SelectedOutput();
+    this->output->SetVolume(1.0);
+    this->thread.reset(new std::thread(std::bind(&Mixer::ThreadLoop, this)));
+}
+
+Mixer::~Mixer() {
+    {
+        Lock lock(this->mutex);
+        this->quit = true;
+    }
+
+    this->mixCondition.notify_all();
+    this->drainCondition.notify_all();
+    this->thread->join();
+
+    auto notifying = dynamic_cast<INotifyingOutput*>(this->output.get());
+    if (notifying) {
+        notifying->CancelNotify(this);
+    }
+
+    /* returns any buffers the device still has back to us */
+    this->output->Stop();
+
+    for (Buffer* buffer : this->allBuffers) {
+        delete buffer;
+    }
+}
+
+Mixer::ChannelPtr Mixer::CreateChannel() {
+    auto channel = std::make_shared<Channel>(shared_from_this());
+    Lock lock(this->mutex);
+    this->channels.push_back(channel.get());
+    return channel;
+}
+
+void Mixer::SetCurve(Curve curve) {
+    Lock lock(this->mutex);
+    this->curve = curve;
+}
+
+void Mixer::ReloadOutput() {
+    Output old;
+
+    {
+        Lock lock(this->mutex);
+        old = this->output;
+        this->output = outputs::SelectedOutput();
+        this->output->SetVolume(1.0);
+        this->outputStopped = false;
+        ++this->flushes;
+        ++this->generation;
+    }
+
+    this->mixCondition.notify_all();
+
+    auto notifying = dynamic_cast<INotifyingOutput*>(old.get());
+    if (notifying) {
+        notifying->CancelNotify(this);
+    }
+
+    old->Stop();
+}
+
+Mixer::Output Mixer::GetOutput() {
+    Lock lock(this->mutex);
+    return this->output;
+}
+
+void Mixer::OnBufferProcessed(IBuffer *buffer) {
+    {
+        Lock lock(this->mutex);
+        this->freeBuffers.push_back(static_cast<Buffer*>(buffer));
+        ++this->processed;
+    }
+
+    this->mixCondition.notify_all();
+}
+
+void Mixer::OnOutputReady() {
+    {
+        Lock lock(this->mutex);
+        ++this->processed;
+    }
+
+    this->mixCondition.notify_all();
+}
+
+void Mixer::Flush(Channel* channel, Releases& releases) {
+    for (auto& pending : channel->queue) {
+        releases.push_back(pending);
+    }
+    channel->queue.clear();
+    channel->offset = 0;
+    channel->NotifyIfReady();
+}
+
+void Mixer::ReleaseAll(Releases& releases) {
+    /* never called with the lock held; the provider will generally be a
+    Player, which may call back into the transport, and then into us. */
+    for (auto& pending : releases) {
+        pending.provider->OnBufferProcessed(pending.buffer);
+    }
+
+    if (releases.size()) {
+        releases.clear();
+        this->drainCondition.notify_all();
+    }
+}
+
+bool Mixer::HasOtherActiveChannel(Channel* channel) {
+    for (Channel* c : this->channels) {
+        if (c != channel && c->active && !c->silent) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Mixer::OutputAction Mixer::UpdateOutputState() {
+    /* the device is paused when every channel that has written something
+    is paused. must be called with the lock held. */
+    bool anyActive = false, allPaused = true;
+    for (Channel* c : this->channels) {
+        if (c->active) {
+            anyActive = true;
+            allPaused = allPaused && c->paused;
+        }
+    }
+
+    const bool pause = anyActive && allPaused;
+
+    if (pause != this->outputPaused) {
+        this->outputPaused = pause;
+        ++this->generation;
+        return pause ? OutputAction::Pause : OutputAction::Resume;
+    }
+
+    return OutputAction::None;
+}
+
+void Mixer::Apply(OutputAction action, Output output) {
+    if (action == OutputAction::Pause) {
+        output->Pause();
+    }
+    else if (action == OutputAction::Resume) {
+        output->Resume();
+        this->mixCondition.notify_all();
+    }
+}
+
+Buffer* Mixer::MixNext(Releases& releases) {
+    this->starving = false;
+
+    if (this->quit || this->outputPaused) {
+        return nullptr;
+    }
+
+    /* channels that have finished fading out don't contribute anything
+    anymore; hand their buffers back right away */
+    for (Channel* c : this->channels) {
+        if (c->silent && c->queue.size()) {
+            this->Flush(c, releases);
+        }
+    }
+
+    /* the oldest channel with data determines the format of this pass. channels
+    with a different format wait until it has finished; we can't mix them. */
+    IBuffer* leader = nullptr;
+    for (Channel* c : this->channels) {
+        if (!c->paused && c->queue.size()) {
+            leader = c->queue.front().buffer;
+            break;
+        }
+    }
+
+    if (!leader) {
+        return nullptr;
+    }
+
+    const long rate = leader->SampleRate();
+    const int channelCount = leader->Channels();
+
+    auto eligible = [rate, channelCount](Channel* c) -> bool {
+        if (c->paused || !c->queue.size()) {
+            return false;
+        }
+        IBuffer* front = c->queue.front().buffer;
+        return front->SampleRate() == rate && front->Channels() == channelCount;
+    };
+
+    /* a channel that's still running but has nothing queued is just behind;
+    wait for it instead of mixing a gap into the middle of its track. if its
+    Player has stalled, or is going away without draining, don't hold the
+    others up for more than a moment. */
+    const auto now = std::chrono::steady_clock::now();
+
+    for (Channel* c : this->channels) {
+        if (c->Running() && !c->queue.size()) {
+            if (!c->starving) {
+                c->starving = true;
+                c->starvedAt = now;
+            }
+
+            if (now - c->starvedAt < std::chrono::milliseconds(STARVED_MS)) {
+                this->starving = true;
+                return nullptr;
+            }
+        }
+    }
+
+    /* running channels all have to be able to fill the whole block, so mix
+    only as much as the one with the least queued. channels that are ending
+    (their Player is draining) have nothing more coming, so they don't hold
+    the others back; they're padded with silence instead. */
+    long frames = -1, endingFrames = 0;
+    for (Channel* c : this->channels) {
+        if (eligible(c)) {
+            const long queued = std::min(
+                (long) MIX_FRAMES, c->QueuedFrames(rate, channelCount));
+
+            if (c->draining) {
+                endingFrames = std::max(endingFrames, queued);
+            }
+            else {
+                frames = (frames < 0) ? queued : std::min(frames, queued);
+            }
+        }
+    }
+
+    if (frames < 0) {
+        frames = endingFrames;
+    }
+
+    Buffer* out = nullptr;
+
+    if (frames > 0) {
+        if (this->freeBuffers.size()) {
+            out = this->freeBuffers.back();
+            this->freeBuffers.pop_back();
+        }
+        else if (this->allBuffers.size() < MIX_BUFFER_COUNT) {
+            out = new Buffer();
+            this->allBuffers.push_back(out);
+        }
+        else {
+            return nullptr; /* wait for the device to return one */
+        }
+
+        out->SetSampleRate(rate);
+        out->SetChannels(channelCount);
+        out->SetSamples(frames * channelCount);
+        out->SetPosition(0.0);
+        memset(out->BufferPointer(), 0, frames * channelCount * sizeof(float));
+    }
+
+    for (Channel* c : this->channels) {
+        if (!eligible(c)) {
+            continue;
+        }
+
+        if (c->fadeFramesTotal < 0) {
+            c->fadeFramesTotal = (long)((double) c->fadeDurationMs * rate / 1000.0);
+        }
+
+        long written = 0;
+
+        while (written < frames && c->queue.size()) {
+            Channel::Pending& front = c->queue.front();
+            IBuffer* in = front.buffer;
+
+            if (in->SampleRate() != rate || in->Channels() != channelCount) {
+                break; /* format change; we'll pick it up later */
+            }
+
+            const long available = (in->Samples() - c->offset) / channelCount;
+            const long count = std::min(available, frames - written);
+            const float* src = in->BufferPointer() + c->offset;
+            float* dst = out->BufferPointer() + (written * channelCount);
+            const float volume = (float) c->volume;
+
+            if (c->fadeFrames >= c->fadeFramesTotal) {
+                /* steady state, constant gain */
+                const float gain = volume * c->fadeTo;
+                if (gain != 0.0f) {
+                    const long samples = count * channelCount;
+                    for (long i = 0; i < samples; i++) {
+                        dst[i] += src[i] * gain;
+                    }
+                }
+            }
+            else {
+                /* fading; gain is computed per frame */
+                for (long f = 0; f < count; f++) {
+                    const float gain = volume * c->Envelope(this->curve);
+                    if (c->fadeFrames < c->fadeFramesTotal) {
+                        ++c->fadeFrames;
+                    }
+                    for (int i = 0; i < channelCount; i++) {
+                        *dst++ += (*src++) * gain;
+                    }
+                }
+            }
+
+            c->offset += count * channelCount;
+            written += count;
+
+            if (c->offset >= in->Samples()) {
+                releases.push_back(front);
+                c->queue.pop_front();
+                c->offset = 0;
+            }
+        }
+
+        if (written > 0) {
+            c->started = true;
+        }
+
+        /* a completed fade-out means the channel is done for good */
+        if (c->fadeTo == 0.0f && c->fadeFrames >= c->fadeFramesTotal) {
+            c->silent = true;
+        }
+
+        c->NotifyIfReady();
+    }
+
+    if (out) {
+        this->writing = true;
+    }
+
+    return out;
+}
+
+void Mixer::Write(Buffer* buffer) {
+    long flushesBefore;
+
+    {
+        Lock lock(this->mutex);
+        flushesBefore = this->flushes;
+    }
+
+    while (true) {
+        Output output;
+        long processedBefore, generationBefore;
+        bool resume = false;
+
+        {
+            Lock lock(this->mutex);
+
+            /* if the device was stopped (e.g. the user seeked) while we were
+            waiting, this audio is stale. drop it. */
+            if (this->quit || this->flushes != flushesBefore) {
+                this->freeBuffers.push_back(buffer);
+                break;
+            }
+
+            output = this->output;
+            processedBefore = this->processed;
+            generationBefore = this->generation;
+            resume = this->outputStopped && !this->outputPaused;
+            this->outputStopped = false;
+        }
+
+        if (resume) {
+            output->Resume();
+        }
+
+        /* don't hold the lock here; some outputs call OnBufferProcessed()
+        before returning. */
+        const int result = output->Play(buffer, this);
+
+        if (result == OutputBufferWritten) {
+            break;
+        }
+
+        /* if the device can tell us when it has room, let it. */
+        auto notifying = dynamic_cast<INotifyingOutput*>(output.get());
+        if (notifying && !notifying->NotifyWhenReady(this)) {
+            continue;
+        }
+
+        const int waitMs = notifying
+            ? READY_TIMEOUT_MS : (result > 0 ? result : RETRY_MS);
+
+        Lock lock(this->mutex);
+
+        this->mixCondition.wait_for(
+            lock,
+            std::chrono::milliseconds(waitMs),
+            [this, processedBefore, generationBefore]() {
+                return
+                    this->quit ||
+                    this->processed != processedBefore ||
+                    this->generation != generationBefore;
+            });
+    }
+
+    {
+        Lock lock(this->mutex);
+        this->writing = false;
+    }
+
+    this->drainCondition.notify_all();
+}
+
+void Mixer::ThreadLoop() {
+    musik::core::threads::Configure(musik::core::threads::Role::Audio);
+
+    Releases releases;
+
+    while (true) {
+        Buffer* mixed = nullptr;
+        bool quit = false;
+
+        {
+            Lock lock(this->mutex);
+
+            while (!this->quit) {
+                mixed = this->MixNext(releases);
+
+                if (mixed || releases.size()) {
+                    break;
+                }
+
+                if (this->starving) {
+                    this->mixCondition.wait_for(lock, std::chrono::milliseconds(STARVED_MS));
+                }
+                else {
+                    this->mixCondition.wait(lock);
+                }
+            }
+
+            quit = this->quit;
+
+            if (quit && mixed) {
+                this->freeBuffers.push_back(mixed);
+                mixed = nullptr;
+            }
+        }
+
+        /* source buffers that were fully consumed go back to their Players */
+        this->ReleaseAll(releases);
+
+        if (quit) {
+            break;
+        }
+
+        if (mixed) {
+            this->Write(mixed);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+
+Channel::Channel(std::shared_ptr<Mixer> mixer)
+: mixer(mixer)
+, offset(0)
+, volume(1.0)
+, paused(false)
+, active(false)
+, started(false)
+, silent(false)
+, draining(false)
+, starving(false)
+, fadeFrom(1.0f)
+, fadeTo(1.0f)
+, fadeDurationMs(0)
+, fadeFrames(0)
+, fadeFramesTotal(0) {
+}
+
+Channel::~Channel() {
+    Mixer::OutputAction action;
+    Mixer::Output output;
+
+    {
+        Lock lock(mixer->mutex);
+
+        /* the Player that wrote to us holds a reference, so it's gone by now
+        and has already waited for all of its buffers to be returned. */
+        this->queue.clear();
+        this->readyListeners.clear();
+        this->active = false;
+        mixer->channels.remove(this);
+        action = mixer->UpdateOutputState();
+        output = mixer->output;
+    }
+
+    mixer->Apply(action, output);
+}
+
+long Channel::QueuedFrames(long rate, int channels) {
+    /* only what can be mixed in this format; anything after a format change
+    waits for a later pass. */
+    long samples = -this->offset;
+    for (auto& pending : this->queue) {
+        IBuffer* buffer = pending.buffer;
+        if (buffer->SampleRate() != rate || buffer->Channels() != channels) {
+            break;
+        }
+        samples += buffer->Samples();
+    }
+    return std::max(0L, samples / channels);
+}
+
+bool Channel::Running() {
+    return this->active && !this->paused && !this->silent && !this->draining;
+}
+
+bool Channel::HasCapacity() {
+    return !this->paused && this->queue.size() < CHANNEL_BUFFER_COUNT;
+}
+
+void Channel::NotifyIfReady() {
+    /* called with the mixer's lock held; that's what lets CancelNotify()
+    guarantee a listener won't be called once it returns. */
+    if (this->readyListeners.size() && this->HasCapacity()) {
+        for (IOutputReadyListener* listener : this->readyListeners) {
+            listener->OnOutputReady();
+        }
+        this->readyListeners.clear();
+    }
+}
+
+bool Channel::NotifyWhenReady(IOutputReadyListener* listener) {
+    Lock lock(mixer->mutex);
+
+    if (this->HasCapacity()) {
+        return false;
+    }
+
+    auto& listeners = this->readyListeners;
+    if (std::find(listeners.begin(), listeners.end(), listener) == listeners.end()) {
+        listeners.push_back(listener);
+    }
+
+    return true;
+}
+
+void Channel::CancelNotify(IOutputReadyListener* listener) {
+    Lock lock(mixer->mutex);
+    auto& listeners = this->readyListeners;
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
+
+bool Channel::GetFixedFormat(long* sampleRate, int* channels) {
+    auto fixed = dynamic_cast<IFixedFormatOutput*>(mixer->GetOutput().get());
+    return fixed && fixed->GetFixedFormat(sampleRate, channels);
+}
+
+float Channel::Envelope(Curve curve) {
+    if (this->fadeFramesTotal <= 0 || this->fadeFrames >= this->fadeFramesTotal) {
+        return this->fadeTo;
+    }
+
+    const float progress = (float) this->fadeFrames / (float) this->fadeFramesTotal;
+    float shape = progress;
+
+    if (curve == Curve::EqualPower) {
+        /* sin() rising and cos() falling sum to constant power */
+        shape = (this->fadeTo > this->fadeFrom)
+            ? (float) sin(progress * HALF_PI)
+            : 1.0f - (float) cos(progress * HALF_PI);
+    }
+
+    return this->fadeFrom + ((this->fadeTo - this->fadeFrom) * shape);
+}
+
+void Channel::Fade(bool fadeIn, long durationMs) {
+    Lock lock(mixer->mutex);
+
+    const float current = this->started
+        ? this->Envelope(mixer->curve)
+        : (fadeIn ? 0.0f : 1.0f);
+
+    this->fadeFrom = current;
+    this->fadeTo = fadeIn ? 1.0f : 0.0f;
+    this->fadeDurationMs = durationMs;
+    this->fadeFrames = 0;
+    this->fadeFramesTotal = -1;
+
+    if (fadeIn) {
+        this->silent = false;
+    }
+}
+
+void Channel::Pause() {
+    Mixer::OutputAction action;
+    Mixer::Output output;
+
+    {
+        Lock lock(mixer->mutex);
+        this->paused = true;
+        action = mixer->UpdateOutputState();
+        output = mixer->output;
+    }
+
+    mixer->Apply(action, output);
+}
+
+void Channel::Resume() {
+    Mixer::OutputAction action;
+    Mixer::Output output;
+
+    {
+        Lock lock(mixer->mutex);
+        this->paused = false;
+        this->NotifyIfReady();
+        action = mixer->UpdateOutputState();
+        output = mixer->output;
+    }
+
+    mixer->Apply(action, output);
+    mixer->mixCondition.notify_all();
+    mixer->drainCondition.notify_all();
+}
+
+void Channel::SetVolume(double volume) {
+    Lock lock(mixer->mutex);
+    this->volume = volume;
+}
+
+double Channel::GetVolume() {
+    Lock lock(mixer->mutex);
+    return this->volume;
+}
+
+void Channel::Stop() {
+    Mixer::Releases releases;
+    Mixer::OutputAction action;
+    Mixer::Output output;
+    bool stopOutput = false;
+
+    {
+        Lock lock(mixer->mutex);
+
+        mixer->Flush(this, releases);
+        this->draining = false;
+
+        /* if nothing else is playing, also flush the device so the sound
+        stops immediately, like it would with a regular output. */
+        if (this->active && !mixer->HasOtherActiveChannel(this)) {
+            stopOutput = true;
+            mixer->outputStopped = true;
+            ++mixer->flushes;
+            ++mixer->generation;
+        }
+
+        this->active = false;
+        action = mixer->UpdateOutputState();
+        output = mixer->output;
+    }
+
+    mixer->ReleaseAll(releases);
+
+    if (stopOutput) {
+        output->Stop();
+    }
+
+    mixer->Apply(action, output);
+    mixer->mixCondition.notify_all();
+}
+
+int Channel::Play(IBuffer *buffer, IBufferProvider *provider) {
+    Mixer::Releases releases;
+    Mixer::OutputAction action = Mixer::OutputAction::None;
+    Mixer::Output output;
+
+    {
+        Lock lock(mixer->mutex);
+
+        if (this->paused) {
+            return OutputInvalidState;
+        }
+
+        if (this->silent) {
+            /* we've been faded out, nobody will hear this. */
+            releases.push_back({ buffer, provider });
+        }
+        else {
+            if (this->queue.size() >= CHANNEL_BUFFER_COUNT) {
+                return OutputBufferFull;
+            }
+
+            this->queue.push_back({ buffer, provider });
+            this->active = true;
+            this->draining = false;
+            this->starving = false;
+            action = mixer->UpdateOutputState();
+            output = mixer->output;
+        }
+    }
+
+    mixer->ReleaseAll(releases);
+    mixer->Apply(action, output);
+    mixer->mixCondition.notify_all();
+
+    return OutputBufferWritten;
+}
+
+void Channel::Drain() {
+    Mixer::Output output;
+    bool drainOutput = false;
+
+    {
+        Lock lock(mixer->mutex);
+
+        /* nothing more is coming; don't make other channels wait for us */
+        this->draining = true;
+        mixer->mixCondition.notify_all();
+
+        auto interrupted = [this]() -> bool {
+            return mixer->quit || this->paused;
+        };
+
+        while (!interrupted() && this->queue.size()) {
+            mixer->drainCondition.wait(lock);
+        }
+
+        /* everything we had has been mixed. if we're the only one playing,
+        wait for the device too, like a regular output would. otherwise the
+        other channels keep the device busy, and there's nothing to wait for. */
+        drainOutput =
+            this->active &&
+            !this->queue.size() &&
+            !mixer->HasOtherActiveChannel(this);
+
+        if (drainOutput) {
+            while (!interrupted() && mixer->writing) {
+                mixer->drainCondition.wait(lock);
+            }
+        }
+
+        output = mixer->output;
+    }
+
+    if (drainOutput) {
+        output->Drain();
+    }
+}
+
+double Channel::Latency() {
+    return mixer->GetOutput()->Latency();
+}
+
+const char* Channel::Name() {
+    return mixer->GetOutput()->Name();
+}
+
+IDeviceList* Channel::GetDeviceList() {
+    return mixer->GetOutput()->GetDeviceList();
+}
+
+bool Channel::SetDefaultDevice(const char* deviceId) {
+    return mixer->GetOutput()->SetDefaultDevice(deviceId);
+}
+
+IDevice* Channel::GetDefaultDevice() {
+    return mixer->GetOutput()->GetDefaultDevice();
+}
@@ -0,0 +1,187 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <core/config.h>
+#include <core/audio/Buffer.h>
+#include <core/sdk/IOutput.h>
+#include <core/sdk/IBufferProvider.h>
+#include <core/sdk/INotifyingOutput.h>
+#include <core/sdk/IFixedFormatOutput.h>
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* sums the output of multiple Players into a single output device. each
+    Player writes to its own Channel, which looks like a regular IOutput. the
+    mixer applies a per-sample gain envelope to every channel, so crossfades
+    are sample-accurate and only ever require one open device. */
+    class Mixer :
+        public musik::core::sdk::IBufferProvider,
+        public musik::core::sdk::IOutputReadyListener,
+        public std::enable_shared_from_this<Mixer>
+    {
+        public:
+            using IOutput = musik::core::sdk::IOutput;
+            using INotifyingOutput = musik::core::sdk::INotifyingOutput;
+            using IOutputReadyListener = musik::core::sdk::IOutputReadyListener;
+            using IFixedFormatOutput = musik::core::sdk::IFixedFormatOutput;
+            using IBuffer = musik::core::sdk::IBuffer;
+            using IBufferProvider = musik::core::sdk::IBufferProvider;
+            using IDeviceList = musik::core::sdk::IDeviceList;
+            using IDevice = musik::core::sdk::IDevice;
+
+            enum class Curve : int {
+                Linear = 0,
+                EqualPower = 1
+            };
+
+            class Channel : public INotifyingOutput, public IFixedFormatOutput {
+                public:
+                    Channel(std::shared_ptr<Mixer> mixer);
+                    virtual ~Channel();
+
+                    /* starts a fade from the current gain. channels that haven't
+                    played anything yet always fade in from silence. */
+                    void Fade(bool fadeIn, long durationMs);
+
+                    /* IOutput */
+                    virtual void Release() override { delete this; }
+                    virtual void Pause() override;
+                    virtual void Resume() override;
+                    virtual void SetVolume(double volume) override;
+                    virtual double GetVolume() override;
+                    virtual void Stop() override;
+                    virtual int Play(IBuffer *buffer, IBufferProvider *provider) override;
+                    virtual void Drain() override;
+                    virtual double Latency() override;
+                    virtual const char* Name() override;
+                    virtual IDeviceList* GetDeviceList() override;
+                    virtual bool SetDefaultDevice(const char* deviceId) override;
+                    virtual IDevice* GetDefaultDevice() override;
+
+                    /* INotifyingOutput */
+                    virtual bool NotifyWhenReady(IOutputReadyListener* listener) override;
+                    virtual void CancelNotify(IOutputReadyListener* listener) override;
+
+                    /* IFixedFormatOutput. forwarded from the device; channels in
+                    the same format can always be mixed together. */
+                    virtual bool GetFixedFormat(long* sampleRate, int* channels) override;
+
+                private:
+                    friend class Mixer;
+
+                    struct Pending {
+                        IBuffer* buffer;
+                        IBufferProvider* provider;
+                    };
+
+                    long QueuedFrames(long rate, int channels);
+                    bool Running();
+                    float Envelope(Curve curve);
+                    bool HasCapacity();
+                    void NotifyIfReady();
+
+                    std::shared_ptr<Mixer> mixer;
+                    std::deque<Pending> queue;
+                    std::vector<IOutputReadyListener*> readyListeners;
+                    long offset; /* into the front buffer, in samples */
+                    double volume;
+                    bool paused, active, started, silent, draining, starving;
+                    std::chrono::steady_clock::time_point starvedAt;
+
+                    /* gain envelope. fadeFramesTotal is -1 until we know the
+                    sample rate of the audio being faded. */
+                    float fadeFrom, fadeTo;
+                    long fadeDurationMs;
+                    long fadeFrames, fadeFramesTotal;
+            };
+
+            using ChannelPtr = std::shared_ptr<Channel>;
+
+            static std::shared_ptr<Mixer> Create();
+
+            virtual ~Mixer();
+
+            ChannelPtr CreateChannel();
+            void SetCurve(Curve curve);
+            void ReloadOutput();
+
+            /* IBufferProvider and IOutputReadyListener, called by the device */
+            virtual void OnBufferProcessed(IBuffer *buffer) override;
+            virtual void OnOutputReady() override;
+
+        private:
+            using Lock = std::unique_lock<std::mutex>;
+            using Releases = std::vector<Channel::Pending>;
+            using Output = std::shared_ptr<IOutput>;
+
+            Mixer();
+
+            enum class OutputAction : int { None, Pause, Resume };
+
+            void ThreadLoop();
+            Buffer* MixNext(Releases& releases);
+            void Write(Buffer* buffer);
+            void Flush(Channel* channel, Releases& releases);
+            OutputAction UpdateOutputState();
+            void Apply(OutputAction action, Output output);
+            void ReleaseAll(Releases& releases);
+            bool HasOtherActiveChannel(Channel* channel);
+            Output GetOutput();
+
+            std::mutex mutex;
+            std::condition_variable mixCondition, drainCondition;
+            std::unique_ptr<std::thread> thread;
+            std::list<Channel*> channels;
+            std::vector<Buffer*> allBuffers;
+            std::vector<Buffer*> freeBuffers;
+            Output output;
+            Curve curve;
+            long processed; /* incremented when the device releases a buffer, or has room */
+            long flushes; /* incremented every time the device is stopped */
+            long generation; /* incremented on pause, resume, flush, reload */
+            bool quit, writing, outputPaused, outputStopped;
+            bool starving; /* waiting on a channel that's fallen behind */
+    };
+
+} } }
@@ -0,0 +1,191 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <core/audio/PcmDispatcher.h>
+#include <core/audio/Visualizer.h>
+
+#include <algorithm>
+#include <functional>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+using Tap = PcmDispatcher::Tap;
+
+#define TAP_BLOCK_COUNT 16
+#define MAX_FRAMES_PER_SECOND 240
+
+PcmDispatcher& PcmDispatcher::Instance() {
+    /* never deleted; the dispatcher thread is detached and has no way to
+    be stopped, so there's nothing safe to tear down at exit. */
+    static PcmDispatcher* instance = new PcmDispatcher();
+    return *instance;
+}
+
+PcmDispatcher::PcmDispatcher()
+: decimation(DefaultDecimation)
+, frameIntervalMs(1000 / DefaultFramesPerSecond) {
+}
+
+void PcmDispatcher::Configure(int decimation, int framesPerSecond) {
+    framesPerSecond = std::max(1, std::min(MAX_FRAMES_PER_SECOND, framesPerSecond));
+    this->decimation.store(std::max(1, std::min((int) MaxDecimation, decimation)));
+    this->frameIntervalMs.store(std::max(1, 1000 / framesPerSecond));
+}
+
+PcmDispatcher::TapPtr PcmDispatcher::CreateTap() {
+    TapPtr tap(new Tap(*this));
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    this->taps.push_back(tap.get());
+
+    if (!this->thread) {
+        this->thread.reset(new std::thread(
+            std::bind(&PcmDispatcher::ThreadLoop, this)));
+        this->thread->detach();
+    }
+
+    return tap;
+}
+
+void PcmDispatcher::Remove(Tap* tap) {
+    /* the worker holds the lock while it's using a tap */
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->taps.remove(tap);
+}
+
+void PcmDispatcher::ThreadLoop() {
+    auto next = std::chrono::steady_clock::now();
+
+    while (true) {
+        next += std::chrono::milliseconds(this->frameIntervalMs.load());
+
+        /* if we fell behind (a slow visualizer, a suspended machine), don't
+        try to catch up with a burst of frames. */
+        auto now = std::chrono::steady_clock::now();
+        if (next < now) {
+            next = now;
+        }
+
+        std::this_thread::sleep_until(next);
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        for (Tap* tap : this->taps) {
+            this->Dispatch(tap);
+        }
+    }
+}
+
+void PcmDispatcher::Dispatch(Tap* tap) {
+    /* everything the tap has queued since the last frame goes out in a
+    single buffer, as long as the format doesn't change part way through. */
+    Buffer& output = this->output;
+    output.SetSamples(0);
+
+    TapQueue::Block* block;
+    while (tap->queue.Read(block)) {
+        if (output.Samples() > 0 &&
+            (output.Channels() != block->channels || output.SampleRate() != block->sampleRate))
+        {
+            this->Flush();
+        }
+
+        output.SetChannels(block->channels);
+        output.SetSampleRate(block->sampleRate);
+        output.Copy(block->samples.data(), block->count, output.Samples());
+
+        tap->queue.Release(block);
+    }
+
+    this->Flush();
+}
+
+void PcmDispatcher::Flush() {
+    if (this->output.Samples() > 0) {
+        IPcmVisualizer* visualizer = vis::PcmVisualizer();
+        if (visualizer && visualizer->Visible()) {
+            visualizer->Write(&this->output);
+        }
+        this->output.SetSamples(0);
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+
+Tap::Tap(PcmDispatcher& dispatcher)
+: dispatcher(dispatcher)
+, queue(TAP_BLOCK_COUNT) {
+}
+
+Tap::~Tap() {
+    this->dispatcher.Remove(this);
+}
+
+void Tap::Write(IBuffer* buffer) {
+    const int decimation = this->dispatcher.decimation.load();
+    const int channels = std::max(1, buffer->Channels());
+    const long frames = (buffer->Samples() / channels) / decimation;
+    const long count = frames * channels;
+
+    this->queue.Write(count, [&](TapQueue::Block& block) {
+        const float* src = buffer->BufferPointer();
+
+        if (decimation == 1) {
+            std::copy(src, src + count, block.samples.begin());
+        }
+        else {
+            /* a box filter: cheap, and enough to keep the worst of the
+            aliasing out of what's really just a picture. */
+            const float scale = 1.0f / (float) decimation;
+            float* dst = block.samples.data();
+            for (long i = 0; i < frames; i++) {
+                for (int c = 0; c < channels; c++) {
+                    float sum = 0.0f;
+                    for (int j = 0; j < decimation; j++) {
+                        sum += src[j * channels + c];
+                    }
+                    *dst++ = sum * scale;
+                }
+                src += decimation * channels;
+            }
+        }
+
+        block.count = count;
+        block.channels = channels;
+        block.sampleRate = buffer->SampleRate() / decimation;
+    });
+}
@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <core/config.h>
+#include <core/audio/Buffer.h>
+#include <core/audio/TapQueue.h>
+#include <core/sdk/IBuffer.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* feeds the selected IPcmVisualizer from its own thread, at a fixed frame
+    rate, so a slow visualizer can't hold up the output. every Player writes
+    the audio it plays to a Tap, which averages it down by the decimation
+    factor and hands it over without locking. once per frame the dispatcher
+    collects what each tap has and writes it to the visualizer in one go. */
+    class PcmDispatcher {
+        public:
+            static const int DefaultDecimation = 1;
+            static const int MaxDecimation = 64;
+            static const int DefaultFramesPerSecond = 60;
+
+            class Tap {
+                public:
+                    ~Tap();
+
+                    /* called by the output with audio it just played. never
+                    blocks; if the dispatcher falls behind, audio is dropped. */
+                    void Write(musik::core::sdk::IBuffer* buffer);
+
+                private:
+                    friend class PcmDispatcher;
+
+                    Tap(PcmDispatcher& dispatcher);
+
+                    PcmDispatcher& dispatcher;
+                    TapQueue queue;
+            };
+
+            using TapPtr = std::unique_ptr<Tap>;
+
+            static PcmDispatcher& Instance();
+
+            /* decimation is clamped to [1, MaxDecimation]; framesPerSecond
+            to [1, 240]. */
+            void Configure(int decimation, int framesPerSecond);
+
+            TapPtr CreateTap();
+
+        private:
+            PcmDispatcher();
+
+            void Remove(Tap* tap);
+            void ThreadLoop();
+            void Dispatch(Tap* tap);
+            void Flush();
+
+            std::mutex mutex;
+            std::unique_ptr<std::thread> thread;
+            std::list<Tap*> taps;
+            std::atomic<int> decimation;
+            std::atomic<int> frameIntervalMs;
+            Buffer output; /* dispatcher thread only */
+    };
+
+} } }
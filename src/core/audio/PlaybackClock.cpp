@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <core/audio/PlaybackClock.h>
+#include <algorithm>
+
+/* if the output says we're this far behind what we've already reported,
+something (an xrun, a device reset) really did set us back. */
+#define MAX_HOLD_SECONDS 0.5
+
+using namespace musik::core::audio;
+
+PlaybackClock::PlaybackClock()
+: anchorPosition(0.0)
+, window(0.0)
+, lastPosition(0.0)
+, anchored(false) {
+}
+
+void PlaybackClock::Anchor(double position, double window) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->anchorTime = Clock::now();
+    this->anchorPosition = position;
+    this->window = window;
+    this->anchored = true;
+
+    if (position < this->lastPosition - MAX_HOLD_SECONDS) {
+        this->lastPosition = position;
+    }
+}
+
+void PlaybackClock::Reset(double position) {
+    /* e.g. after a seek. we stand still until the output tells us where
+    it really is. */
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->anchorPosition = this->lastPosition = position;
+    this->anchored = false;
+}
+
+double PlaybackClock::Position() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    double position = this->anchorPosition;
+
+    if (this->anchored) {
+        const double elapsed =
+            std::chrono::duration<double>(Clock::now() - this->anchorTime).count();
+
+        position += std::min(elapsed, this->window);
+    }
+
+    /* if the device reports a little behind where we'd interpolated to,
+    wait for it to catch up instead of stepping back. */
+    this->lastPosition = std::max(this->lastPosition, position);
+    return this->lastPosition;
+}
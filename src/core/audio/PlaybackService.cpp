@@ -36,7 +36,9 @@
 
 #include "PlaybackService.h"
 
+#include <core/audio/DecoderPool.h>
 #include <core/audio/MasterTransport.h>
+#include <core/audio/StreamMetrics.h>
 #include <core/library/LocalLibraryConstants.h>
 #include <core/library/track/Track.h>
 #include <core/library/query/local/MarkTrackPlayedQuery.h>
@@ -126,6 +128,10 @@ static inline void loadPreferences(
 
     int timeChangeMode = prefs->GetInt(keys::TimeChangeMode, TimeChangeScrub);
     playback.SetTimeChangeMode((TimeChangeMode) timeChangeMode);
+
+    DecoderPool::Instance().Configure(
+        prefs->GetInt(keys::DecoderPoolSize, DecoderPool::DefaultSize),
+        prefs->GetInt(keys::DecoderPoolMaxFileMegabytes, DecoderPool::DefaultMaxFileMegabytes));
 }
 
 static inline void savePreferences(
@@ -199,6 +205,7 @@ void PlaybackService::PrepareNextTrack() {
         /* repeat track, just keep playing the same thing over and over */
         if (this->repeatMode == RepeatTrack) {
             this->nextIndex = this->index;
+            this->PrepareUpcomingTracks(this->index);
             this->transport->PrepareNextTrack(
                 this->UriAtIndex(this->index),
                 this->GainAtIndex(this->index));
@@ -211,6 +218,7 @@ void PlaybackService::PrepareNextTrack() {
                 if (this->playlist.Count() > 0) {
                     this->index = NO_POSITION;
                     this->nextIndex = 0;
+                    this->PrepareUpcomingTracks(nextIndex);
                     this->transport->PrepareNextTrack(
                         this->UriAtIndex(nextIndex),
                         this->GainAtIndex(nextIndex));
@@ -220,6 +228,7 @@ void PlaybackService::PrepareNextTrack() {
             else if (this->playlist.Count() > this->index + 1) {
                 if (this->nextIndex != this->index + 1) {
                     this->nextIndex = this->index + 1;
+                    this->PrepareUpcomingTracks(nextIndex);
                     this->transport->PrepareNextTrack(
                         this->UriAtIndex(nextIndex),
                         this->GainAtIndex(nextIndex));
@@ -229,6 +238,7 @@ void PlaybackService::PrepareNextTrack() {
             else if (this->repeatMode == RepeatList) {
                 if (this->nextIndex != 0) {
                     this->nextIndex = 0;
+                    this->PrepareUpcomingTracks(nextIndex);
                     this->transport->PrepareNextTrack(
                         this->UriAtIndex(nextIndex),
                         this->GainAtIndex(nextIndex));
@@ -236,12 +246,44 @@ void PlaybackService::PrepareNextTrack() {
             }
             else {
                 /* nothing to prepare if we get here. */
+                this->PrepareUpcomingTracks(NO_POSITION);
                 this->transport->PrepareNextTrack("", ITransport::Gain());
             }
         }
     }
 }
 
+void PlaybackService::PrepareUpcomingTracks(size_t index) {
+    /* called with the playlist lock held. starts opening decoders for the
+    tracks after index, so they're ready by the time we get to them. the one
+    at index is the transport's next track; the pool leaves that for the
+    transport to open, when its gapless lookahead says so. */
+    std::vector<std::string> uris;
+
+    const size_t count = this->playlist.Count();
+    const size_t size = DecoderPool::Instance().Size();
+
+    if (index != NO_POSITION && index < count) {
+        if (this->repeatMode == RepeatTrack) {
+            uris.push_back(this->UriAtIndex(index));
+        }
+        else {
+            for (size_t i = 0; i < size && i < count; i++) {
+                size_t next = index + i;
+                if (next >= count) {
+                    if (this->repeatMode != RepeatList) {
+                        break;
+                    }
+                    next -= count;
+                }
+                uris.push_back(this->UriAtIndex(next));
+            }
+        }
+    }
+
+    DecoderPool::Instance().Prepare(uris);
+}
+
 void PlaybackService::SetRepeatMode(RepeatMode mode) {
     if (this->repeatMode != mode) {
         this->repeatMode = mode;
@@ -1108,6 +1150,17 @@ ITrackList* PlaybackService::Clone() {
     return to->GetSdkValue();
 }
 
+size_t PlaybackService::GetPlaybackMetrics(PlaybackMetrics* target, size_t count) {
+    std::vector<PlaybackMetrics> snapshot;
+    metrics::GetSnapshot(snapshot);
+
+    if (target) {
+        std::copy(snapshot.begin(), snapshot.begin() + std::min(count, snapshot.size()), target);
+    }
+
+    return snapshot.size();
+}
+
 ITransport::Gain PlaybackService::GainAtIndex(size_t index) {
     using Mode = ReplayGainMode;
 
@@ -1131,8 +1184,8 @@ ITransport::Gain PlaybackService::GainAtIndex(size_t index) {
                 if (gain != 1.0f) {
                     /* http://wiki.hydrogenaud.io/index.php?title=ReplayGain_2.0_specification#Reduced_gain */
                     result.gain = powf(10.0f, (gain / 20.0f));
-                    result.peak = (1.0f / peak);
-                    result.peakValid = true;
+                    result.peak = peak > 0.0f ? (1.0f / peak) : 0.0f;
+                    result.peakValid = peak > 0.0f;
                 }
             }
         }
@@ -111,6 +111,7 @@ namespace musik { namespace core { namespace audio {
             virtual void SetTimeChangeMode(musik::core::sdk::TimeChangeMode) override;
             virtual void ReloadOutput() override;
             virtual musik::core::sdk::ITrackList* Clone() override;
+            virtual size_t GetPlaybackMetrics(musik::core::sdk::PlaybackMetrics* target, size_t count) override;
 
             /* TODO: include in SDK? */
             virtual bool HotSwap(const TrackList& source, size_t index = 0);
@@ -183,6 +184,7 @@ namespace musik { namespace core { namespace audio {
 
             void NotifyRemotesModeChanged();
             void PrepareNextTrack();
+            void PrepareUpcomingTracks(size_t index);
             void InitRemotes();
             void ResetRemotes();
             void MarkTrackAsPlayed(int64_t trackId);
@@ -34,22 +34,29 @@
 
 #include "pch.hpp"
 
-#include <kiss_fftr.h>
 #include <core/debug.h>
 #include <core/audio/Stream.h>
 #include <core/audio/Player.h>
 #include <core/audio/Visualizer.h>
 #include <core/plugin/PluginFactory.h>
+#include <core/support/Preferences.h>
+#include <core/support/PreferenceKeys.h>
+#include <core/support/ThreadPriority.h>
 #include <core/sdk/constants.h>
+#include <core/sdk/IFixedFormatOutput.h>
+#include <core/sdk/IOutputDiagnostics.h>
 
 #include <algorithm>
 #include <math.h>
 #include <future>
 
 #define MAX_PREBUFFER_QUEUE_COUNT 8
-#define FFT_N 512
-#define PI 3.14159265358979323846
+#define SAMPLES_PER_CHANNEL 2048
+#define DEFAULT_SEEK_PREROLL_SECONDS 3.0
+#define OUTPUT_READY_TIMEOUT_MS 1000
+#define OUTPUT_POLL_INTERVAL_MS 10
 
+using namespace musik::core;
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
 
@@ -57,7 +64,6 @@ using std::min;
 using std::max;
 
 static std::string TAG = "Player";
-static float* hammingWindow = nullptr;
 
 using Listener = Player::EventListener;
 using ListenerList = std::list<Listener*>;
@@ -66,45 +72,84 @@ namespace musik {
     namespace core {
         namespace audio {
             void playerThreadLoop(Player* player);
+        }
+    }
+}
 
-            struct FftContext {
-                FftContext() {
-                    samples = 0;
-                    cfg = nullptr;
-                    deinterleaved = nullptr;
-                    scratch = nullptr;
-                }
+static IStreamPtr createStream(IOutput* output) {
+    auto playbackPrefs = Preferences::ForComponent(prefs::components::Playback);
 
-                ~FftContext() {
-                    Reset();
-                }
+    /* all streams share the same buffer pool; make sure it respects the
+    user's memory ceiling before this one borrows from it. */
+    int poolMegabytes = playbackPrefs->GetInt(
+        prefs::keys::MaxBufferPoolMegabytes, (int) BufferPool::DefaultMaxMegabytes);
 
-                void Reset() {
-                    kiss_fftr_free(cfg);
-                    delete[] deinterleaved;
-                    delete[] scratch;
-                    cfg = nullptr;
-                    deinterleaved = nullptr;
-                    scratch = nullptr;
-                }
+    BufferPool::Instance().SetMaxBytes((size_t) std::max(1, poolMegabytes) * 1024 * 1024);
 
-                void Init(int samples) {
-                    if (!cfg || samples != this->samples) {
-                        Reset();
-                        cfg = kiss_fftr_alloc(FFT_N, false, 0, 0);
-                        deinterleaved = new float[samples];
-                        scratch = new kiss_fft_cpx[(FFT_N / 2) + 1];
-                        this->samples = samples;
-                    }
-                }
+    /* seeking back less than this many seconds replays recently decoded
+    audio instead of asking the decoder to seek. */
+    double prerollSeconds = playbackPrefs->GetDouble(
+        prefs::keys::SeekPrerollSeconds, DEFAULT_SEEK_PREROLL_SECONDS);
 
-                int samples;
-                kiss_fftr_cfg cfg;
-                float* deinterleaved;
-                kiss_fft_cpx* scratch;
-            };
-        }
+    /* if the user has asked for decode-ahead, the stream gets its own
+    decoder thread that keeps this many seconds of processed audio ready. */
+    double decodeAheadSeconds = playbackPrefs->GetDouble(prefs::keys::DecodeAheadSeconds, 0.0);
+
+    IStreamPtr stream = (decodeAheadSeconds > 0.0)
+        ? Stream::Create(SAMPLES_PER_CHANNEL, decodeAheadSeconds, StreamFlags::DecodeAhead, prerollSeconds)
+        : Stream::Create(SAMPLES_PER_CHANNEL, 5, StreamFlags::None, prerollSeconds);
+
+    /* some outputs would rather we did the sample rate and channel conversion
+    than re-open the device every time the format changes. */
+    auto fixedFormatOutput = dynamic_cast<IFixedFormatOutput*>(output);
+    long sampleRate = 0;
+    int channels = 0;
+    if (fixedFormatOutput && fixedFormatOutput->GetFixedFormat(&sampleRate, &channels)) {
+        stream->SetOutputFormat(sampleRate, channels);
     }
+
+    return stream;
+}
+
+static inline long long bufferMicros(IBuffer* buffer) {
+    const long long frames = buffer->Samples() / std::max(1, buffer->Channels());
+    return buffer->SampleRate() > 0 ? (frames * 1000000LL) / buffer->SampleRate() : 0;
+}
+
+static SpectrumAnalyzer::TapPtr createSpectrumTap() {
+    auto playbackPrefs = Preferences::ForComponent(prefs::components::Playback);
+
+    /* larger transforms give finer frequency resolution; overlapping them
+    gives smoother motion. both cost cpu, but not on the output's thread. */
+    SpectrumAnalyzer::Instance().Configure(
+        playbackPrefs->GetInt(prefs::keys::SpectrumFftSize, SpectrumAnalyzer::DefaultFftSize),
+        (float) playbackPrefs->GetDouble(prefs::keys::SpectrumOverlap, 0.0));
+
+    return SpectrumAnalyzer::Instance().CreateTap();
+}
+
+static PcmDispatcher::TapPtr createPcmTap() {
+    auto playbackPrefs = Preferences::ForComponent(prefs::components::Playback);
+
+    /* pcm visualizers mostly draw waveforms and scopes, which rarely need
+    every sample, or more frames than the screen can show. */
+    PcmDispatcher::Instance().Configure(
+        playbackPrefs->GetInt(prefs::keys::PcmVisualizerDecimation, PcmDispatcher::DefaultDecimation),
+        playbackPrefs->GetInt(prefs::keys::PcmVisualizerFps, PcmDispatcher::DefaultFramesPerSecond));
+
+    return PcmDispatcher::Instance().CreateTap();
+}
+
+static void configureGainStage(GainStage& stage, const Player::Gain& gain) {
+    auto playbackPrefs = Preferences::ForComponent(prefs::components::Playback);
+
+    /* by default positive gains are limited to the ceiling, rather than
+    being reduced to whatever the track's peak allows. */
+    stage.Configure(
+        gain.preamp * gain.gain,
+        gain.peakValid ? gain.peak : 0.0f,
+        (float) playbackPrefs->GetDouble(prefs::keys::TruePeakCeilingDecibels, -1.0),
+        playbackPrefs->GetBool(prefs::keys::ReplayGainLimiter, true));
 }
 
 Player* Player::Create(
@@ -112,9 +157,10 @@ Player* Player::Create(
     std::shared_ptr<IOutput> output,
     DestroyMode destroyMode,
     EventListener *listener,
-    Gain gain)
+    Gain gain,
+    double prebufferSeconds)
 {
-    return new Player(url, output, destroyMode, listener, gain);
+    return new Player(url, output, destroyMode, listener, gain, prebufferSeconds);
 }
 
 Player::Player(
@@ -122,9 +168,10 @@ Player::Player(
     std::shared_ptr<IOutput> output,
     DestroyMode destroyMode,
     EventListener *listener,
-    Gain gain)
+    Gain gain,
+    double prebufferSeconds)
 : state(Player::Idle)
-, stream(Stream::Create())
+, stream(createStream(output.get()))
 , url(url)
 , currentPosition(0)
 , output(output)
@@ -132,28 +179,40 @@ Player::Player(
 , seekToPosition(-1)
 , nextMixPoint(-1.0)
 , pendingBufferCount(0)
+, outputReadyCount(0)
+, queuedMicros(0)
+, wroteOutput(false)
+, firstWriteSampleRate(0)
+, tailPosition(0.0)
 , destroyMode(destroyMode)
-, fftContext(nullptr)
+, spectrumTap(createSpectrumTap())
+, pcmTap(createPcmTap())
+, metrics(StreamMetrics::Create())
+, delayReportingOutput(dynamic_cast<IDelayReportingOutput*>(output.get()))
 , gain(gain) {
     musik::debug::info(TAG, "new instance created");
 
-    this->spectrum = new float[FFT_N / 2];
-
     if (!this->output) {
         throw std::runtime_error("output cannot be null!");
     }
 
+    configureGainStage(this->gainStage, gain);
+
     if (listener) {
         listeners.push_back(listener);
     }
 
+    if (prebufferSeconds > 0.0) {
+        this->stream->SetPrebufferSeconds(prebufferSeconds);
+    }
+
+    this->stream->SetMetrics(this->metrics);
+
     /* each player instance is driven by a background thread. start it. */
     this->thread = new std::thread(std::bind(&musik::core::audio::playerThreadLoop, this));
 }
 
 Player::~Player() {
-    delete[] this->spectrum;
-    delete fftContext;
 }
 
 void Player::Play() {
@@ -161,6 +220,10 @@ void Player::Play() {
 
     if (this->state != Player::Quit) {
         this->state = Player::Playing;
+
+        /* we're typically called after the output has been resumed, so it's
+        probably ready for data again; wake up the thread if it's waiting. */
+        ++this->outputReadyCount;
         this->writeToOutputCondition.notify_all();
     }
 }
@@ -215,9 +278,7 @@ ListenerList Player::Listeners() {
 
 double Player::GetPosition() {
     double seek = this->seekToPosition.load();
-    double current = this->currentPosition.load();
-    const double latency = this->output ? this->output->Latency() : 0.0;
-    return std::max(0.0, round((seek >= 0 ? seek : current) - latency));
+    return (seek >= 0) ? seek : this->clock.Position();
 }
 
 double Player::GetPositionInternal() {
@@ -248,6 +309,9 @@ void Player::SetPosition(double seconds) {
         this->processedMixPoints);
 
     this->UpdateNextMixPointTime();
+
+    /* wake the player thread if it's waiting on the output */
+    this->writeToOutputCondition.notify_all();
 }
 
 void Player::AddMixPoint(int id, double time) {
@@ -256,6 +320,19 @@ void Player::AddMixPoint(int id, double time) {
     this->UpdateNextMixPointTime();
 }
 
+double Player::GetQueuedSeconds() {
+    return std::max(0.0, (double) this->queuedMicros.load() / 1000000.0);
+}
+
+bool Player::GetFirstWrite(std::chrono::steady_clock::time_point& time, long& sampleRate) {
+    if (this->wroteOutput.load()) {
+        time = this->firstWriteTime;
+        sampleRate = this->firstWriteSampleRate;
+        return true;
+    }
+    return false;
+}
+
 int Player::State() {
     std::unique_lock<std::mutex> lock(this->queueMutex);
     return this->state;
@@ -284,17 +361,10 @@ void Player::UpdateNextMixPointTime() {
 }
 
 void musik::core::audio::playerThreadLoop(Player* player) {
-#ifdef WIN32
-    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
-#endif
+    threads::Configure(threads::Role::Audio);
 
     IBuffer* buffer = nullptr;
 
-    float gain = player->gain.preamp * player->gain.gain;
-    if (gain > 1.0f && player->gain.peakValid) {
-        gain = player->gain.peak;
-    }
-
     if (player->stream->OpenStream(player->url)) {
         for (Listener* l : player->Listeners()) {
             l->OnPlayerPrepared(player);
@@ -308,10 +378,22 @@ void musik::core::audio::playerThreadLoop(Player* player) {
             }
         }
 
+        /* outputs that implement INotifyingOutput tell us exactly when they
+        can accept more data, so we don't have to guess. */
+        auto notifyingOutput = dynamic_cast<INotifyingOutput*>(player->output.get());
+        auto diagnostics = dynamic_cast<IOutputDiagnostics*>(player->output.get());
+
+        StreamMetrics& stats = *player->metrics;
+        bool starved = false;
+
         /* we're ready to go.... */
         bool finished = false;
 
         while (!finished && !player->Exited()) {
+            /* snapshot before we touch the output, so we can't miss a wakeup
+            that happens between a failed Play() and the wait below. */
+            const long readyCount = player->outputReadyCount.load();
+
             /* see if we've been asked to seek since the last sample was
             played. if we have, clear our output buffer and seek the
             stream. */
@@ -326,11 +408,13 @@ void musik::core::audio::playerThreadLoop(Player* player) {
                 not performed, will result in a deadlock just below while
                 waiting for all buffers to complete. */
                 if (buffer) {
-                    player->OnBufferProcessed(buffer);
+                    player->DiscardBuffer(buffer);
                     buffer = nullptr;
                 }
 
                 player->currentPosition.store(seek);
+                player->clock.Reset(seek);
+                player->gainStage.Reset();
 
                 {
                     std::unique_lock<std::mutex> lock(player->queueMutex);
@@ -343,40 +427,110 @@ void musik::core::audio::playerThreadLoop(Player* player) {
                 player->seekToPosition.exchange(-1.0);
             }
 
-            /* let's see if we can find some samples to play */
+            /* let's see if we can find some samples to play. note we do not hold
+            the queue mutex here; decoding may take a while, and the output thread
+            returns buffers to the stream via a lock-free ring. */
             if (!buffer) {
-                std::unique_lock<std::mutex> lock(player->queueMutex);
-
                 buffer = player->stream->GetNextProcessedOutputBuffer();
 
                 if (buffer) {
-                    /* apply replay gain, if specified */
-                    if (gain != 1.0f) {
-                        float* samples = buffer->BufferPointer();
-                        for (long i = 0; i < buffer->Samples(); i++) {
-                            samples[i] *= gain;
-                        }
-                    }
+                    /* apply replay gain and preamp, limited if necessary */
+                    player->gainStage.Process(buffer);
 
                     ++player->pendingBufferCount;
+
+                    if (buffer->Samples() == 0) {
+                        /* all of it went into the limiter's look-ahead */
+                        player->DiscardBuffer(buffer);
+                        buffer = nullptr;
+                    }
+                    else {
+                        player->tailPosition = ((Buffer*) buffer)->Position() +
+                            (double) bufferMicros(buffer) / 1000000.0;
+                    }
+                }
+                else if (player->stream->Eof()) {
+                    /* the limiter is still holding the last few milliseconds */
+                    if (!player->tailBuffer) {
+                        player->tailBuffer.reset(new Buffer());
+                    }
+
+                    if (player->gainStage.Flush(player->tailBuffer.get())) {
+                        player->tailBuffer->SetPosition(player->tailPosition);
+                        buffer = player->tailBuffer.get();
+                        ++player->pendingBufferCount;
+                    }
                 }
             }
 
             /* if we have a decoded, processed buffer available. let's try to send it to
             the output device. */
             if (buffer) {
+                /* read up front: once the output has the buffer it may be done
+                with it, and recycled, before Play() even returns. */
+                const auto writeTime = std::chrono::steady_clock::now();
+                const long writeSampleRate = buffer->SampleRate();
+
+                /* counted first, the output may be done with it before Play()
+                even returns. */
+                const long long micros = bufferMicros(buffer);
+                player->queuedMicros += micros;
+
                 /* if this result is negative it's an error code defined by the sdk's
                 OutputPlay enum. if it's a positive number it's the number of milliseconds
                 we should wait until automatically trying to play the buffer again. */
-                int playResult = player->output->Play(buffer, player);
+                int playResult;
+
+                {
+                    metrics::ScopedTimer timer(&stats.outputMicros);
+                    playResult = player->output->Play(buffer, player);
+                }
+
+                if (playResult != OutputBufferWritten) {
+                    player->queuedMicros -= micros;
+                }
+                else {
+                    ++stats.buffersPlayed;
+                    stats.outputQueueDepth.Record((uint64_t) player->pendingBufferCount.load());
+                    starved = false;
+
+                    /* only a buffer the output actually accepted marks the start
+                    of playback; a rejected attempt says nothing about when we'll
+                    be heard. */
+                    if (!player->wroteOutput.load()) {
+                        player->firstWriteTime = writeTime;
+                        player->firstWriteSampleRate = writeSampleRate;
+                        player->wroteOutput.store(true);
+                    }
+                }
+
+                if (diagnostics) {
+                    metrics::ObserveOutput(diagnostics, stats);
+                }
 
                 if (playResult == OutputBufferWritten) {
                     buffer = nullptr; /* reset so we pick up a new one next iteration */
                 }
+                else if (notifyingOutput) {
+                    /* the output will tell us when it's ready. if it says it's ready
+                    now, just go around again. */
+                    if (notifyingOutput->NotifyWhenReady(player)) {
+                        player->WaitForOutput(readyCount, OUTPUT_READY_TIMEOUT_MS);
+                    }
+                }
+                else if (playResult == OutputBufferFull) {
+                    /* the output is holding some of our buffers, and will wake us up
+                    via OnBufferProcessed() when it's done with one. if it isn't, it's
+                    full of someone else's buffers, and all we can do is poll. */
+                    player->WaitForOutput(
+                        readyCount,
+                        player->pendingBufferCount > 0
+                            ? OUTPUT_READY_TIMEOUT_MS : OUTPUT_POLL_INTERVAL_MS);
+                }
                 else {
                     /* if the buffer was unable to be processed, we'll try again after
                     sleepMs milliseconds */
-                    int sleepMs = 1000; /* default */
+                    int sleepMs = OUTPUT_READY_TIMEOUT_MS; /* default */
 
                     /* if the playResult value >= 0, that means the output requested a
                     specific callback time because its internal buffer is full. */
@@ -394,10 +548,7 @@ void musik::core::audio::playerThreadLoop(Player* player) {
                         }
                     }
 
-                    std::unique_lock<std::mutex> lock(player->queueMutex);
-
-                    player->writeToOutputCondition.wait_for(
-                        lock, std::chrono::milliseconds(sleepMs));
+                    player->WaitForOutput(readyCount, sleepMs);
                 }
             }
             else {
@@ -405,16 +556,29 @@ void musik::core::audio::playerThreadLoop(Player* player) {
                     finished = true;
                 }
                 else {
-                    /* we should never get here, but if for some reason we can't get the
-                    next buffer, but we're not EOF, that means we need to wait for a short
-                    while and try again... */
-                    std::unique_lock<std::mutex> lock(player->queueMutex);
-                    player->writeToOutputCondition.wait_for(
-                        lock, std::chrono::milliseconds(10));
+                    /* if the output has already finished with everything we gave
+                    it, we're late. count it once, not every time we poll. */
+                    if (!starved && player->wroteOutput.load() && player->pendingBufferCount == 0) {
+                        ++stats.starved;
+                        starved = true;
+                    }
+
+                    /* all of our buffers are with the output (we'll be woken up
+                    as soon as one is returned), or, in decode-ahead mode, the worker
+                    hasn't caught up yet. outputs that notify always return buffers
+                    promptly, so there's nothing to poll for while they hold some. */
+                    player->WaitForOutput(
+                        readyCount,
+                        notifyingOutput && player->pendingBufferCount > 0
+                            ? OUTPUT_READY_TIMEOUT_MS : OUTPUT_POLL_INTERVAL_MS);
                 }
             }
         }
 
+        if (notifyingOutput) {
+            notifyingOutput->CancelNotify(player);
+        }
+
         /* if the Quit flag isn't set, that means the stream has ended "naturally", i.e.
         it wasn't stopped by the user. raise the "almost ended" flag. */
         if (!player->Exited()) {
@@ -435,7 +599,7 @@ void musik::core::audio::playerThreadLoop(Player* player) {
 
     /* if non-null, it was never accepted by the output. release it now. */
     if (buffer) {
-        player->OnBufferProcessed(buffer);
+        player->DiscardBuffer(buffer);
         buffer = nullptr;
     }
 
@@ -474,54 +638,54 @@ bool Player::Exited() {
     return (this->state == Player::Quit);
 }
 
-static inline void initHammingWindow() {
-    delete hammingWindow;
-    hammingWindow = new float[FFT_N];
+void Player::DiscardBuffer(IBuffer *buffer) {
+    /* called on the player thread for a buffer the output never accepted.
+    hand it straight back to the stream; it must not go through the ring
+    the output thread writes to. */
+    this->ReturnToStream(buffer, true);
 
-    for (int i = 0; i < FFT_N; i++) {
-        hammingWindow[i] = 0.54f - 0.46f * (float) cos((2 * PI * i) / (FFT_N - 1));
+    {
+        std::unique_lock<std::mutex> lock(this->queueMutex);
+        --pendingBufferCount;
     }
-}
 
-static inline bool performFft(IBuffer* buffer, FftContext* fft, float* output, int outputSize) {
-    long samples = buffer->Samples();
-    int channels = buffer->Channels();
-    long samplesPerChannel = samples / channels;
+    this->writeToOutputCondition.notify_all();
+}
 
-    if (samplesPerChannel < FFT_N || outputSize != FFT_N / 2) {
-        return false;
+void Player::ReturnToStream(IBuffer* buffer, bool discarded) {
+    if (buffer == this->tailBuffer.get()) {
+        return; /* never the stream's to begin with */
     }
 
-    if (!hammingWindow) {
-        initHammingWindow();
+    if (discarded) {
+        this->stream->OnBufferDiscardedByPlayer(buffer);
     }
-
-    memset(output, 0, outputSize * sizeof(float));
-
-    float* input = buffer->BufferPointer();
-
-    fft->Init(samples);
-
-    for (int i = 0; i < samples; i++) {
-        const int to = ((i % channels) * samplesPerChannel) + (i / channels);
-        fft->deinterleaved[to] = input[i] * hammingWindow[to % FFT_N];
+    else {
+        this->stream->OnBufferProcessedByPlayer((Buffer*) buffer);
     }
+}
 
-    int offset = 0;
-    int iterations = samples / FFT_N;
-    for (int i = 0; i < iterations; i++) {
-        kiss_fftr(fft->cfg, fft->deinterleaved + offset, fft->scratch);
+void Player::WaitForOutput(long readyCount, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(this->queueMutex);
 
-        for (int z = 0; z < outputSize; z++) {
-            /* convert to decibels */
-            double db = (fft->scratch[z].r * fft->scratch[z].r + fft->scratch[z].i + fft->scratch[z].i);
-            output[z] += (db < 1 ? 0 : 20 * (float) log10(db)) / iterations; /* frequencies over all channels */
-        }
+    this->writeToOutputCondition.wait_for(
+        lock,
+        std::chrono::milliseconds(timeoutMs),
+        [this, readyCount]() {
+            return
+                this->state == Player::Quit ||
+                this->seekToPosition.load() != -1.0 ||
+                this->outputReadyCount.load() != readyCount;
+        });
+}
 
-        offset += FFT_N;
+void Player::OnOutputReady() {
+    {
+        std::unique_lock<std::mutex> lock(this->queueMutex);
+        ++this->outputReadyCount;
     }
 
-    return true;
+    this->writeToOutputCondition.notify_all();
 }
 
 void Player::OnBufferProcessed(IBuffer *buffer) {
@@ -534,33 +698,51 @@ void Player::OnBufferProcessed(IBuffer *buffer) {
     IPcmVisualizer* pcmVis = vis::PcmVisualizer();
 
     if (specVis && specVis->Visible()) {
-        if (!fftContext) {
-            fftContext = new FftContext();
-        }
-
-        if (performFft(buffer, fftContext, spectrum, FFT_N / 2)) {
-            vis::SpectrumVisualizer()->Write(spectrum, FFT_N / 2);
-        }
+        /* the analysis happens on another thread; this just copies */
+        this->spectrumTap->Write(buffer);
     }
     else if (pcmVis && pcmVis->Visible()) {
-        vis::PcmVisualizer()->Write(buffer);
+        /* likewise, the visualizer is fed from the dispatcher's thread */
+        this->pcmTap->Write(buffer);
     }
 
-    /* release the buffer back to the stream, find mixpoints */
+    /* if we're seeking this value will be non-negative, so we shouldn't touch
+    the current time. */
+    if (this->seekToPosition.load() == -1) {
+        const double start = ((Buffer*)buffer)->Position();
+        const double duration = (double) bufferMicros(buffer) / 1000000.0;
+
+        this->currentPosition.store(start);
+
+        /* the output has just finished with this buffer, so the device is
+        holding (about) 'delay' seconds of audio that ends where it does. we
+        allow ourselves to run ahead by a couple of buffers before the next
+        release puts us right again. */
+        double delay = this->delayReportingOutput ? this->delayReportingOutput->GetDelay() : -1.0;
+        if (delay < 0.0) {
+            delay = this->output->Latency();
+        }
+
+        this->clock.Anchor(std::max(0.0, start + duration - delay), duration * 2.0);
+    }
+
+    this->queuedMicros -= bufferMicros(buffer);
+
+    /* lets the stream know the buffer can be recycled. this never waits on
+    the player thread, which may be busy decoding. */
+    this->ReturnToStream(buffer, false);
+
+    /* find mixpoints. the queue mutex is only ever held for short periods
+    of bookkeeping, never while decoding. */
 
     {
         std::unique_lock<std::mutex> lock(this->queueMutex);
 
-        /* removes the specified buffer from the list of locked buffers, and also
-        lets the stream know it can be recycled. */
+        /* removes the specified buffer from the list of locked buffers. this
+        is done with the lock held so the player thread can't miss a wakeup
+        while waiting for the pending count to drain. */
         --pendingBufferCount;
-        this->stream->OnBufferProcessedByPlayer((Buffer*)buffer);
-
-        /* if we're seeking this value will be non-negative, so we shouldn't touch
-        the current time. */
-        if (this->seekToPosition.load() == -1) {
-            this->currentPosition.store(((Buffer*)buffer)->Position());
-        }
+        ++outputReadyCount;
 
         /* did we hit any pending mixpoints? if so add them to our set and
         move them to the processed set. we'll notify once out of the
@@ -36,12 +36,20 @@
 
 #include <core/config.h>
 #include <core/audio/IStream.h>
+#include <core/audio/Buffer.h>
+#include <core/audio/PlaybackClock.h>
+#include <core/audio/GainStage.h>
+#include <core/audio/PcmDispatcher.h>
+#include <core/audio/SpectrumAnalyzer.h>
 #include <core/sdk/constants.h>
 #include <core/sdk/IOutput.h>
 #include <core/sdk/IBufferProvider.h>
+#include <core/sdk/INotifyingOutput.h>
+#include <core/sdk/IDelayReportingOutput.h>
 
 #include <sigslot/sigslot.h>
 
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -49,9 +57,10 @@
 
 namespace musik { namespace core { namespace audio {
 
-    struct FftContext;
-
-    class Player : public musik::core::sdk::IBufferProvider {
+    class Player :
+        public musik::core::sdk::IBufferProvider,
+        public musik::core::sdk::IOutputReadyListener
+    {
         public:
             enum DestroyMode { Drain = 0, NoDrain = 1 };
 
@@ -81,9 +90,11 @@ namespace musik { namespace core { namespace audio {
                 std::shared_ptr<musik::core::sdk::IOutput> output,
                 DestroyMode destroyMode,
                 EventListener *listener,
-                Gain gain = Gain());
+                Gain gain = Gain(),
+                double prebufferSeconds = 0.0);
 
             virtual void OnBufferProcessed(musik::core::sdk::IBuffer *buffer);
+            virtual void OnOutputReady() override;
 
             void Detach(EventListener *listener);
             void Attach(EventListener *listener);
@@ -98,8 +109,19 @@ namespace musik { namespace core { namespace audio {
 
             void AddMixPoint(int id, double time);
 
+            /* how much audio we've handed to the output that it hasn't
+            finished with yet. */
+            double GetQueuedSeconds();
+
+            /* when we first tried to write to the output, and in what format.
+            returns false if we haven't yet. */
+            bool GetFirstWrite(std::chrono::steady_clock::time_point& time, long& sampleRate);
+
             bool HasCapability(musik::core::sdk::Capability capability);
 
+            /* shared with our stream; outlives us if someone holds on to it */
+            StreamMetrics::Ptr Metrics() const { return this->metrics; }
+
             std::string GetUrl() const { return this->url; }
 
         private:
@@ -112,7 +134,8 @@ namespace musik { namespace core { namespace audio {
                 std::shared_ptr<musik::core::sdk::IOutput> output,
                 DestroyMode finishMode,
                 EventListener *listener,
-                Gain gain);
+                Gain gain,
+                double prebufferSeconds);
 
             virtual ~Player();
 
@@ -151,10 +174,14 @@ namespace musik { namespace core { namespace audio {
             MixPointList mixPointsHitTemp; /* so we don't have to keep alloc'ing it */
 
             void UpdateNextMixPointTime();
+            void DiscardBuffer(musik::core::sdk::IBuffer* buffer);
+            void ReturnToStream(musik::core::sdk::IBuffer* buffer, bool discarded);
+            void WaitForOutput(long readyCount, int timeoutMs);
 
             std::string url;
 
-            /* granular mutexes for better performance */
+            /* granular mutexes for better performance. note queueMutex is never
+            held while decoding, so the output thread never waits on the decoder */
             std::mutex queueMutex, listenerMutex;
             std::condition_variable writeToOutputCondition;
 
@@ -164,13 +191,30 @@ namespace musik { namespace core { namespace audio {
             std::atomic<double> seekToPosition;
             int state;
             bool notifiedStarted;
-            float* spectrum;
             DestroyMode destroyMode;
             Gain gain;
-            int pendingBufferCount;
+            GainStage gainStage;
+            std::atomic<int> pendingBufferCount;
+            std::atomic<long> outputReadyCount; /* modified with queueMutex held */
             bool threadFinished;
-
-            FftContext* fftContext;
+            std::atomic<long long> queuedMicros;
+            std::atomic<bool> wroteOutput;
+            std::chrono::steady_clock::time_point firstWriteTime; /* set before wroteOutput */
+            long firstWriteSampleRate;
+
+            /* what the gain stage was still holding back when the stream
+            ended. it's ours, not the stream's, so it's never returned. */
+            std::unique_ptr<Buffer> tailBuffer;
+            double tailPosition;
+
+            SpectrumAnalyzer::TapPtr spectrumTap;
+            PcmDispatcher::TapPtr pcmTap;
+            StreamMetrics::Ptr metrics;
+
+            /* what's audible right now, for GetPosition(). anchored every time
+            the output releases a buffer, and interpolated in between. */
+            PlaybackClock clock;
+            musik::core::sdk::IDelayReportingOutput* delayReportingOutput;
     };
 
 } } }
@@ -0,0 +1,299 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#include "pch.hpp"
+
+#include <core/audio/Resampler.h>
+#include <core/sdk/SampleOps.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+/* the number of phases is the reduced output rate; it's < 1000 for every
+pair of common rates. beyond this we approximate the ratio. */
+#define MAX_PHASES 4096
+
+/* downsampling needs proportionally longer filters */
+#define MAX_TAPS 1024
+
+#define PI 3.14159265358979323846
+
+struct QualitySettings {
+    int taps;
+    double beta; /* kaiser window shape */
+};
+
+static const QualitySettings QUALITY[] = {
+    { 32, 6.0 },
+    { 64, 8.0 },
+    { 128, 9.0 }
+};
+
+static long gcd(long a, long b) {
+    while (b) {
+        long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* best rational approximation of num/den with a numerator <= maxNum,
+via continued fraction convergents */
+static void approximate(long num, long den, long maxNum, int& p, int& q) {
+    long p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    long n = num, d = den;
+    while (d) {
+        long a = n / d;
+        long p2 = a * p1 + p0, q2 = a * q1 + q0;
+        if (p2 > maxNum) {
+            break;
+        }
+        p0 = p1; q0 = q1; p1 = p2; q1 = q2;
+        long t = n % d;
+        n = d;
+        d = t;
+    }
+    p = (int) p1;
+    q = (int) q1;
+}
+
+/* zeroth order modified bessel function of the first kind */
+static double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    const double y = x * x / 4.0;
+    for (int k = 1; k < 50 && term > sum * 1e-12; k++) {
+        term *= y / ((double) k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+Resampler::Resampler(long inputRate, long outputRate, int channels, Quality quality)
+: inputRate(inputRate)
+, outputRate(outputRate)
+, channels(channels) {
+    if (inputRate <= 0 || outputRate <= 0 || channels <= 0) {
+        throw std::invalid_argument("invalid resampler format");
+    }
+
+    const long divisor = gcd(inputRate, outputRate);
+    this->upFactor = (int) (outputRate / divisor);
+    this->downFactor = (int) (inputRate / divisor);
+
+    if (this->upFactor > MAX_PHASES) {
+        approximate(outputRate, inputRate, MAX_PHASES, this->upFactor, this->downFactor);
+    }
+
+    const int L = this->upFactor, M = this->downFactor;
+    const QualitySettings& settings = QUALITY[std::max(0, std::min(2, (int) quality))];
+
+    /* when downsampling, the transition band has to be narrower relative
+    to the input rate, so we need more taps to keep the same quality. keep
+    it a multiple of 8 so the dot products stay on the vector path. */
+    double stretch = std::max(1.0, (double) M / (double) L);
+    this->taps = std::min(MAX_TAPS, ((int) std::ceil(settings.taps * stretch) + 7) & ~7);
+
+    const int T = this->taps;
+    const int64_t N = (int64_t) L * T;
+
+    /* the transition band we can afford with this many taps (kaiser's
+    estimate), as a fraction of the lower nyquist rate. place the cutoff so
+    the stopband starts right at nyquist. */
+    const double attenuation = settings.beta / 0.1102 + 8.7;
+    const double transition = std::min(0.5,
+        (attenuation - 8.0) / (2.285 * (double) (T / stretch) * PI));
+    const double cutoff = (1.0 - transition / 2.0) / (2.0 * std::max(L, M));
+
+    /* the center has to land exactly on a phase, or the output would be
+    shifted by a fraction of a sample. */
+    const double center = (double) (N / 2);
+    const double windowScale = 1.0 / besselI0(settings.beta);
+
+    /* phase p, tap k of the prototype is h[p + k * L]. we store each phase's
+    taps reversed so they line up with the input window, oldest sample first. */
+    this->coefficients.resize((size_t) N);
+    for (int p = 0; p < L; p++) {
+        float* row = &this->coefficients[(size_t) p * T];
+        double sum = 0.0;
+        for (int k = 0; k < T; k++) {
+            const double j = (double) p + (double) k * L;
+            const double t = j - center;
+            const double x = 2.0 * cutoff * t;
+            const double sinc = (t == 0.0) ? 1.0 : std::sin(PI * x) / (PI * x);
+            const double r = t / center;
+            const double window = besselI0(settings.beta * std::sqrt(std::max(0.0, 1.0 - r * r))) * windowScale;
+            const double value = sinc * window;
+            row[T - 1 - k] = (float) value;
+            sum += value;
+        }
+
+        /* normalize so every phase has exactly unity gain at dc */
+        if (sum != 0.0) {
+            for (int k = 0; k < T; k++) {
+                row[k] = (float) (row[k] / sum);
+            }
+        }
+    }
+
+    this->planes.resize(channels);
+    this->targets.resize(channels);
+    this->Reset();
+}
+
+void Resampler::Reset() {
+    /* the window initially extends T - 1 frames before the first input
+    frame; those are silence. */
+    for (auto& plane : this->planes) {
+        plane.assign(this->taps - 1, 0.0f);
+    }
+
+    this->head = 0;
+    this->planeStart = -(this->taps - 1);
+
+    /* start at the filter's center, so the output isn't delayed */
+    const int64_t center = ((int64_t) this->upFactor * this->taps) / 2;
+    this->index = center / this->upFactor;
+    this->phase = (int) (center % this->upFactor);
+
+    this->inputFrames = 0;
+    this->outputFrames = 0;
+}
+
+long Resampler::Process(const float* input, long frames, std::vector<float>& output) {
+    if (frames <= 0) {
+        return 0;
+    }
+
+    this->Compact();
+
+    /* once the planes have grown to fit the largest chunk we're given, this
+    (and everything below) runs without allocating. */
+    const size_t offset = this->planes[0].size();
+    for (int c = 0; c < this->channels; c++) {
+        this->planes[c].resize(offset + frames);
+        this->targets[c] = this->planes[c].data() + offset;
+    }
+
+    sampleops::Deinterleave(input, this->channels, frames, this->targets.data());
+
+    this->inputFrames += frames;
+
+    return this->Produce(output, std::numeric_limits<int64_t>::max());
+}
+
+long Resampler::Drain(std::vector<float>& output) {
+    /* pad with enough silence to push the last input frame through the
+    center of the filter, then stop where the input did. */
+    this->Compact();
+
+    for (auto& plane : this->planes) {
+        plane.resize(plane.size() + this->taps, 0.0f);
+    }
+
+    const int64_t total =
+        (this->inputFrames * this->upFactor + this->downFactor - 1) / this->downFactor;
+
+    long produced = this->Produce(output, total);
+    this->Reset();
+    return produced;
+}
+
+long Resampler::Produce(std::vector<float>& output, int64_t limit) {
+    const int L = this->upFactor, M = this->downFactor, T = this->taps;
+    const int64_t available =
+        this->planeStart + (int64_t) (this->planes[0].size() - this->head);
+
+    if (this->index >= available) {
+        return 0;
+    }
+
+    /* an upper bound; we size the output for it up front, write through a
+    pointer, and trim what we didn't use. */
+    const int64_t estimate = ((available - this->index) * L) / M + 1;
+    const size_t base = output.size();
+    output.resize(base + (size_t) (estimate * this->channels));
+    float* dst = output.data() + base;
+
+    long produced = 0;
+
+    while (this->index < available && this->outputFrames < limit) {
+        const float* row = &this->coefficients[(size_t) this->phase * T];
+        const size_t start = this->head + (size_t) (this->index - T + 1 - this->planeStart);
+
+        for (int c = 0; c < this->channels; c++) {
+            *dst++ = sampleops::DotProduct(row, &this->planes[c][start], T);
+        }
+
+        ++produced;
+        ++this->outputFrames;
+
+        this->phase += M;
+        this->index += this->phase / L;
+        this->phase %= L;
+    }
+
+    output.resize(base + (size_t) produced * this->channels);
+
+    /* input that has moved out of the window is skipped over here, and
+    reclaimed by Compact() before the next write. */
+    const int64_t consumed = this->index - (T - 1) - this->planeStart;
+    if (consumed > 0) {
+        const size_t live = this->planes[0].size() - this->head;
+        const size_t count = (size_t) std::min(consumed, (int64_t) live);
+        this->head += count;
+        this->planeStart += (int64_t) count;
+    }
+
+    return produced;
+}
+
+void Resampler::Compact() {
+    /* move the live history (about one window's worth) back to the front,
+    so the planes don't grow. their capacity is kept, so appending after
+    this doesn't allocate either. */
+    if (this->head > 0) {
+        for (auto& plane : this->planes) {
+            std::copy(plane.begin() + this->head, plane.end(), plane.begin());
+            plane.resize(plane.size() - this->head);
+        }
+        this->head = 0;
+    }
+}
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <core/config.h>
+
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* a windowed-sinc polyphase sample rate converter for interleaved float
+    audio. the conversion ratio is reduced to L/M (output/input), and a bank of
+    L filters, one per output phase, is computed up front; each output sample
+    is then a single dot product against the input. it has no dependencies on
+    the rest of the audio pipeline so it can be tested and benchmarked alone. */
+    class Resampler {
+        public:
+            enum class Quality: int {
+                Fast = 0,   /* ~60 dB stopband, wide transition */
+                Normal = 1, /* ~80 dB */
+                High = 2    /* ~90 dB, passband to ~91% of nyquist */
+            };
+
+            Resampler(
+                long inputRate,
+                long outputRate,
+                int channels,
+                Quality quality = Quality::High);
+
+            Resampler(const Resampler&) = delete;
+
+            long InputRate() const { return this->inputRate; }
+            long OutputRate() const { return this->outputRate; }
+            int Channels() const { return this->channels; }
+            int TapsPerPhase() const { return this->taps; }
+            int Phases() const { return this->upFactor; }
+
+            /* appends the resampled version of 'frames' interleaved frames of
+            'input' to 'output', and returns the number of frames appended. the
+            output is aligned with the input: there is no leading delay. */
+            long Process(const float* input, long frames, std::vector<float>& output);
+
+            /* call once the input has ended to flush the filter. the total output
+            is then exactly ceil(inputFrames * outputRate / inputRate) frames. */
+            long Drain(std::vector<float>& output);
+
+            /* forget all buffered input, e.g. after a seek */
+            void Reset();
+
+        private:
+            long Produce(std::vector<float>& output, int64_t limit);
+            void Compact();
+
+            long inputRate, outputRate;
+            int channels;
+            int upFactor, downFactor; /* L and M */
+            int taps;
+
+            std::vector<float> coefficients; /* upFactor rows of taps */
+            std::vector<std::vector<float>> planes; /* per-channel input */
+            std::vector<float*> targets; /* scratch for deinterleaving */
+
+            size_t head; /* first live frame in each plane; before it is spent */
+            int64_t planeStart; /* absolute input frame at planes[c][head] */
+            int64_t index; /* newest input frame of the current window */
+            int phase;
+
+            int64_t inputFrames;
+            int64_t outputFrames;
+    };
+
+} } }
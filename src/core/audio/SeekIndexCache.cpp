@@ -0,0 +1,144 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#include "pch.hpp"
+
+#include <core/audio/SeekIndexCache.h>
+#include <core/debug.h>
+
+#include <sstream>
+
+using namespace musik::core;
+using namespace musik::core::audio;
+
+static const std::string TAG = "SeekIndexCache";
+
+SeekIndexCache& SeekIndexCache::Instance() {
+    /* never destroyed; Streams may be torn down after static destructors
+    have started to run. */
+    static SeekIndexCache* instance = new SeekIndexCache();
+    return *instance;
+}
+
+SeekIndexCache::SeekIndexCache()
+: connected(false) {
+}
+
+void SeekIndexCache::SetDatabase(const std::string& filename) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    if (filename != this->filename) {
+        if (this->connected) {
+            this->db.Close();
+            this->connected = false;
+        }
+        this->filename = filename;
+    }
+}
+
+bool SeekIndexCache::Connect() {
+    /* opened lazily, so libraries that never play anything don't pay for
+    another connection. */
+    if (!this->connected && this->filename.size()) {
+        this->connected = (this->db.Open(this->filename.c_str()) == db::Okay);
+    }
+    return this->connected;
+}
+
+bool SeekIndexCache::Load(
+    const std::string& uri,
+    int64_t size,
+    std::vector<double>& times,
+    std::vector<int64_t>& offsets)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    times.clear();
+    offsets.clear();
+
+    if (!this->Connect()) {
+        return false;
+    }
+
+    db::Statement stmt(
+        "SELECT points FROM seek_indexes WHERE uri=? AND filesize=?",
+        this->db);
+
+    stmt.BindText(0, uri);
+    stmt.BindInt64(1, size);
+
+    if (stmt.Step() == db::Row) {
+        std::istringstream points(stmt.ColumnText(0));
+        double time;
+        int64_t offset;
+        while (points >> time >> offset) {
+            times.push_back(time);
+            offsets.push_back(offset);
+        }
+    }
+
+    return times.size() > 0;
+}
+
+void SeekIndexCache::Save(
+    const std::string& uri,
+    int64_t size,
+    const std::vector<double>& times,
+    const std::vector<int64_t>& offsets)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    if (!this->Connect() || times.size() != offsets.size()) {
+        return;
+    }
+
+    std::ostringstream points;
+    points.precision(17);
+    for (size_t i = 0; i < times.size(); i++) {
+        points << times[i] << " " << offsets[i] << " ";
+    }
+
+    db::Statement stmt(
+        "INSERT OR REPLACE INTO seek_indexes (uri, filesize, points) VALUES (?, ?, ?)",
+        this->db);
+
+    stmt.BindText(0, uri);
+    stmt.BindInt64(1, size);
+    stmt.BindText(2, points.str());
+
+    if (stmt.Step() != db::Done) {
+        musik::debug::warning(TAG, "failed to save seek index for " + uri);
+    }
+}
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <core/config.h>
+#include <core/db/Connection.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* persists decoder seek indexes (see IIndexedDecoder) in the library
+    database, keyed by uri and file size, so a track only ever needs to be
+    scanned once. the library tells us where its database lives when it
+    opens; until then, Load() and Save() are no-ops. */
+    class SeekIndexCache {
+        public:
+            static SeekIndexCache& Instance();
+
+            void SetDatabase(const std::string& filename);
+
+            bool Load(
+                const std::string& uri,
+                int64_t size,
+                std::vector<double>& times,
+                std::vector<int64_t>& offsets);
+
+            void Save(
+                const std::string& uri,
+                int64_t size,
+                const std::vector<double>& times,
+                const std::vector<int64_t>& offsets);
+
+        private:
+            SeekIndexCache();
+
+            bool Connect();
+
+            std::mutex mutex;
+            std::string filename;
+            db::Connection db;
+            bool connected;
+    };
+
+} } }
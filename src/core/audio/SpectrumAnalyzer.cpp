@@ -0,0 +1,268 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#include "pch.hpp"
+
+#include <core/audio/SpectrumAnalyzer.h>
+#include <core/audio/Visualizer.h>
+#include <core/sdk/SampleOps.h>
+
+#include <kiss_fftr.h>
+
+#include <algorithm>
+#include <functional>
+#include <math.h>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+using Tap = SpectrumAnalyzer::Tap;
+
+#define PI 3.14159265358979323846
+#define TAP_BLOCK_COUNT 8
+#define IDLE_WAIT_MS 20
+
+struct SpectrumAnalyzer::Fft {
+    Fft(int size)
+    : cfg(kiss_fftr_alloc(size, false, 0, 0))
+    , window(size)
+    , windowed(size)
+    , bins((size / 2) + 1)
+    , power(size / 2, 0.0f) {
+        for (int i = 0; i < size; i++) {
+            window[i] = 0.54f - 0.46f * (float) cos((2 * PI * i) / (size - 1)); /* hamming */
+        }
+    }
+
+    ~Fft() {
+        kiss_fftr_free(cfg);
+    }
+
+    kiss_fftr_cfg cfg;
+    std::vector<float> window, windowed;
+    std::vector<kiss_fft_cpx> bins;
+    std::vector<float> power; /* summed over every frame since the last publish */
+};
+
+SpectrumAnalyzer& SpectrumAnalyzer::Instance() {
+    /* leaked on purpose: taps held by players that outlive main() still
+    call back into us, and so does the detached analyzer thread. */
+    static SpectrumAnalyzer* instance = new SpectrumAnalyzer();
+    return *instance;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+: fftSize(0)
+, hopSize(0)
+, frames(0) {
+    this->Configure(DefaultFftSize, 0.0f);
+}
+
+void SpectrumAnalyzer::Configure(int fftSize, float overlap) {
+    int size = MinFftSize;
+    while (size < fftSize && size < MaxFftSize) {
+        size <<= 1;
+    }
+
+    overlap = std::max(0.0f, std::min(0.9f, overlap));
+    const int hop = std::max(1, (int)((float) size * (1.0f - overlap)));
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    if (size != this->fftSize) {
+        this->fft.reset(new Fft(size));
+        this->fftSize = size;
+        this->frames = 0;
+        for (Tap* tap : this->taps) {
+            tap->pending.clear();
+        }
+    }
+
+    this->hopSize = hop;
+}
+
+SpectrumAnalyzer::TapPtr SpectrumAnalyzer::CreateTap() {
+    TapPtr tap(new Tap(*this));
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    this->taps.push_back(tap.get());
+
+    if (!this->thread) {
+        this->thread.reset(new std::thread(
+            std::bind(&SpectrumAnalyzer::ThreadLoop, this)));
+        this->thread->detach();
+    }
+
+    return tap;
+}
+
+void SpectrumAnalyzer::Remove(Tap* tap) {
+    /* the worker holds the lock while it's using a tap */
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->taps.remove(tap);
+}
+
+void SpectrumAnalyzer::ThreadLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    while (true) {
+        bool analyzed = false;
+
+        for (Tap* tap : this->taps) {
+            analyzed |= this->Analyze(tap);
+        }
+
+        if (this->frames > 0) {
+            this->Publish();
+        }
+
+        /* taps notify without taking the lock, so we may miss one while
+        we're busy; don't sleep for long. */
+        if (!analyzed) {
+            this->condition.wait_for(lock, std::chrono::milliseconds(IDLE_WAIT_MS));
+        }
+    }
+}
+
+bool SpectrumAnalyzer::Analyze(Tap* tap) {
+    Fft& fft = *this->fft;
+    const int half = this->fftSize / 2;
+    bool analyzed = false;
+    TapQueue::Block* block;
+
+    while (tap->queue.Read(block)) {
+        analyzed = true;
+
+        /* one transform for all channels */
+        const int channels = std::max(1, block->channels);
+        const long frames = block->count / channels;
+        const float scale = 1.0f / (float) channels;
+        const float* src = block->samples.data();
+
+        auto& pending = tap->pending;
+        size_t offset = pending.size();
+        pending.resize(offset + frames);
+
+        for (long i = 0; i < frames; i++) {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; c++) {
+                sum += *src++;
+            }
+            pending[offset + i] = sum * scale;
+        }
+
+        tap->queue.Release(block);
+
+        /* as many windows as we have data for */
+        size_t start = 0;
+        while (pending.size() - start >= (size_t) this->fftSize) {
+            sampleops::Multiply(
+                pending.data() + start, fft.window.data(), fft.windowed.data(), this->fftSize);
+
+            kiss_fftr(fft.cfg, fft.windowed.data(), fft.bins.data());
+
+            for (int i = 0; i < half; i++) {
+                const kiss_fft_cpx& bin = fft.bins[i];
+                fft.power[i] += bin.r * bin.r + bin.i * bin.i;
+            }
+
+            ++this->frames;
+            start += this->hopSize;
+        }
+
+        pending.erase(pending.begin(), pending.begin() + std::min(start, pending.size()));
+    }
+
+    return analyzed;
+}
+
+void SpectrumAnalyzer::Publish() {
+    Fft& fft = *this->fft;
+    const int binsPerBand = (this->fftSize / 2) / Bands;
+
+    /* kiss_fftr isn't normalized, so scale the power to what a 512-point
+    transform would have produced; visualizers are tuned for that. bins are
+    summed into bands, not averaged, so both tones and noise come out at the
+    same level regardless of the fft size. */
+    const float sizeScale = (float) DefaultFftSize / (float) this->fftSize;
+    const float scale = (sizeScale * sizeScale) / (float) this->frames;
+
+    auto bin = fft.power.begin();
+    for (int band = 0; band < Bands; band++) {
+        float sum = 0.0f;
+        for (int i = 0; i < binsPerBand; i++) {
+            sum += *bin++;
+        }
+
+        const float power = sum * scale;
+        this->spectrum[band] = (power < 1.0f) ? 0.0f : 20.0f * log10f(power); /* decibels */
+    }
+
+    std::fill(fft.power.begin(), fft.power.end(), 0.0f);
+    this->frames = 0;
+
+    ISpectrumVisualizer* visualizer = vis::SpectrumVisualizer();
+    if (visualizer && visualizer->Visible()) {
+        visualizer->Write(this->spectrum, Bands);
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+
+Tap::Tap(SpectrumAnalyzer& analyzer)
+: analyzer(analyzer)
+, queue(TAP_BLOCK_COUNT) {
+}
+
+Tap::~Tap() {
+    this->analyzer.Remove(this);
+}
+
+void Tap::Write(IBuffer* buffer) {
+    const long count = buffer->Samples();
+
+    bool queued = this->queue.Write(count, [buffer, count](TapQueue::Block& block) {
+        const float* src = buffer->BufferPointer();
+        std::copy(src, src + count, block.samples.begin());
+        block.count = count;
+        block.channels = buffer->Channels();
+        block.sampleRate = buffer->SampleRate();
+    });
+
+    if (queued) {
+        this->analyzer.condition.notify_one();
+    }
+}
@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <core/config.h>
+#include <core/audio/TapQueue.h>
+#include <core/sdk/IBuffer.h>
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* computes the spectrum for the selected ISpectrumVisualizer on its own
+    thread, so output devices don't have to. every Player writes the audio it
+    plays to a Tap, which copies it and hands it to the analyzer without
+    locking. the analyzer runs overlapping FFTs over everything it receives,
+    and publishes the result once per batch. */
+    class SpectrumAnalyzer {
+        public:
+            static const int Bands = 256; /* what visualizers expect */
+            static const int DefaultFftSize = 512;
+            static const int MinFftSize = 512;
+            static const int MaxFftSize = 16384;
+
+            class Tap {
+                public:
+                    ~Tap();
+
+                    /* called by the output with audio it just played. copies
+                    the buffer and queues it for analysis. never blocks; if
+                    the analyzer falls behind, audio is dropped. */
+                    void Write(musik::core::sdk::IBuffer* buffer);
+
+                private:
+                    friend class SpectrumAnalyzer;
+
+                    Tap(SpectrumAnalyzer& analyzer);
+
+                    SpectrumAnalyzer& analyzer;
+                    TapQueue queue;
+
+                    /* analyzer thread only: downmixed audio not analyzed yet */
+                    std::vector<float> pending;
+            };
+
+            using TapPtr = std::unique_ptr<Tap>;
+
+            static SpectrumAnalyzer& Instance();
+
+            /* fftSize is rounded up to a power of two. overlap is the fraction
+            of each FFT window shared with the previous one, from 0 to 0.9. */
+            void Configure(int fftSize, float overlap);
+
+            TapPtr CreateTap();
+
+        private:
+            struct Fft;
+
+            SpectrumAnalyzer();
+
+            void Remove(Tap* tap);
+            void ThreadLoop();
+            bool Analyze(Tap* tap);
+            void Publish();
+
+            std::mutex mutex;
+            std::condition_variable condition;
+            std::unique_ptr<std::thread> thread;
+            std::list<Tap*> taps;
+            std::unique_ptr<Fft> fft;
+            int fftSize;
+            int hopSize;
+            int frames;
+            float spectrum[Bands];
+    };
+
+} } }
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+namespace musik { namespace core { namespace audio {
+
+    /* a fixed-capacity, single-producer/single-consumer ring. exactly one
+    thread may call Push() and exactly one (other) thread may call Pop();
+    neither call ever blocks or allocates. used to hand buffers between
+    the player thread and the output device thread without a mutex. */
+    template <typename T>
+    class SpscRing {
+        public:
+            SpscRing(size_t capacity) {
+                size_t size = 2;
+                while (size < capacity + 1) {
+                    size <<= 1;
+                }
+                this->items.resize(size);
+                this->mask = size - 1;
+                this->head.store(0);
+                this->tail.store(0);
+            }
+
+            bool Push(const T& item) {
+                const size_t tail = this->tail.load(std::memory_order_relaxed);
+                const size_t next = (tail + 1) & this->mask;
+                if (next == this->head.load(std::memory_order_acquire)) {
+                    return false; /* full */
+                }
+                this->items[tail] = item;
+                this->tail.store(next, std::memory_order_release);
+                return true;
+            }
+
+            bool Pop(T& item) {
+                const size_t head = this->head.load(std::memory_order_relaxed);
+                if (head == this->tail.load(std::memory_order_acquire)) {
+                    return false; /* empty */
+                }
+                item = this->items[head];
+                this->head.store((head + 1) & this->mask, std::memory_order_release);
+                return true;
+            }
+
+            /* approximate when called while the other side is active */
+            size_t Size() const {
+                const size_t head = this->head.load(std::memory_order_acquire);
+                const size_t tail = this->tail.load(std::memory_order_acquire);
+                return (tail - head) & this->mask;
+            }
+
+            size_t Capacity() const {
+                return this->mask;
+            }
+
+            bool Empty() const {
+                return this->Size() == 0;
+            }
+
+        private:
+            std::vector<T> items;
+            size_t mask;
+            std::atomic<size_t> head;
+            std::atomic<size_t> tail;
+    };
+
+} } }
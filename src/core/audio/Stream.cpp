@@ -36,6 +36,10 @@
 
 #include "Stream.h"
 #include "Streams.h"
+#include <core/audio/DecoderPool.h>
+#include <core/audio/SeekIndexCache.h>
+#include <core/sdk/IIndexedDecoder.h>
+#include <core/support/ThreadPriority.h>
 #include <core/debug.h>
 
 using namespace musik::core::audio;
@@ -46,7 +50,15 @@ static std::string TAG = "Stream";
 
 #define MIN_BUFFER_COUNT 30
 
-Stream::Stream(int samplesPerChannel, double bufferLengthSeconds, StreamFlags options)
+/* if the buffer pool is at its memory ceiling we'll make do with fewer
+buffers, but we can't play reliably with less than this. */
+#define REQUIRED_BUFFER_COUNT 8
+
+Stream::Stream(
+    int samplesPerChannel,
+    double bufferLengthSeconds,
+    StreamFlags options,
+    double prerollSeconds)
 : options(options)
 , samplesPerChannel(samplesPerChannel)
 , bufferLengthSeconds(bufferLengthSeconds)
@@ -56,57 +68,142 @@ Stream::Stream(int samplesPerChannel, double bufferLengthSeconds, StreamFlags op
 , decoderPosition(0)
 , decoderSampleOffset(0)
 , decoderSamplesRemain(0)
+, decoderExhausted(false)
+, historyStart(0)
+, historyEnd(0)
+, prerollSeconds(prerollSeconds)
+, prebufferSeconds(0.0)
+, seekIndexPoints(0)
 , done(false)
 , capabilities(0)
-, rawBuffer(nullptr) {
+, directDecoder(nullptr)
+, quit(false)
+, drained(false) {
+    std::vector<streams::NamedDsp> dsps;
     if (((int) this->options & (int) StreamFlags::NoDSP) == 0) {
-        dsps = streams::GetDspPlugins();
+        dsps = streams::GetNamedDspPlugins();
     }
+    this->dsp.reset(new DspPipeline(dsps));
+
+    this->decodeAhead =
+        ((int) this->options & (int) StreamFlags::DecodeAhead) != 0;
 
     this->decoderBuffer = new Buffer();
     this->decoderBuffer->SetSamples(0);
+
+    this->rawBuffer = new Buffer();
+    this->rawBuffer->SetSamples(0);
+
+    this->recycling.clear();
 }
 
 Stream::~Stream() {
-    delete[] rawBuffer;
-    delete this->decoderBuffer;
-
-    for (Buffer* buffer : this->recycledBuffers) {
-        delete buffer;
+    if (this->decodeThread) {
+        {
+            std::unique_lock<std::mutex> lock(this->decoderMutex);
+            this->quit = true;
+        }
+        this->decodeCondition.notify_all();
+        this->decodeThread->join();
     }
 
-    for (Buffer* buffer : this->filledBuffers) {
-        delete buffer;
-    }
+    /* may still be working on one of our buffers */
+    this->dsp.reset();
+
+    this->SaveSeekIndex();
+
+    delete this->decoderBuffer;
+    delete this->rawBuffer;
+
+    BufferPool::Instance().Release(this->allBuffers);
+    BufferPool::Instance().Release(this->historyBuffers);
 }
 
-IStreamPtr Stream::Create(int samplesPerChannel, double bufferLengthSeconds, StreamFlags options) {
-    return IStreamPtr(new Stream(samplesPerChannel, bufferLengthSeconds, options));
+IStreamPtr Stream::Create(
+    int samplesPerChannel,
+    double bufferLengthSeconds,
+    StreamFlags options,
+    double prerollSeconds)
+{
+    return IStreamPtr(new Stream(
+        samplesPerChannel, bufferLengthSeconds, options, prerollSeconds));
 }
 
-IStream* Stream::CreateUnmanaged(int samplesPerChannel, double bufferLengthSeconds, StreamFlags options) {
-    return new Stream(samplesPerChannel, bufferLengthSeconds, options);
+IStream* Stream::CreateUnmanaged(
+    int samplesPerChannel,
+    double bufferLengthSeconds,
+    StreamFlags options,
+    double prerollSeconds)
+{
+    return new Stream(samplesPerChannel, bufferLengthSeconds, options, prerollSeconds);
 }
 
 double Stream::SetPosition(double requestedSeconds) {
-    double actualSeconds = this->decoder->SetPosition(requestedSeconds);
+    std::unique_lock<std::mutex> lock(this->decoderMutex, std::defer_lock);
+    if (this->decodeAhead) {
+        lock.lock();
+    }
+
+    double actualSeconds = -1;
+
+    if (this->SeekWithinHistory(requestedSeconds)) {
+        /* the decoder stays where it is; we'll replay from the history
+        until we catch up with it. */
+        actualSeconds = requestedSeconds;
+    }
+    else {
+        actualSeconds = this->decoder->SetPosition(requestedSeconds);
+
+        if (actualSeconds != -1) {
+            double rate = (double) this->decoderSampleRate;
+
+            /* discard whatever remains of the last decoder buffer */
+            this->decoderSamplesRemain = 0;
+            this->decoderSampleOffset = 0;
+            this->decoderExhausted = false;
+
+            if (this->converter) {
+                this->converter->Reset();
+            }
+
+            this->decoderPosition =
+                (uint64_t)(actualSeconds * rate) * this->decoderChannels;
+
+            /* the history must be contiguous, so start over */
+            this->historyStart = this->historyEnd = this->decoderPosition;
+        }
+    }
 
     if (actualSeconds != -1) {
-        double rate = (double) this->decoderSampleRate;
+        /* anything the worker already processed is stale now */
+        Buffer* ready = nullptr;
+        while (this->readyBuffers && this->readyBuffers->Pop(ready)) {
+            this->reclaimedBuffers.push_back(ready);
+        }
+
+        if (Buffer* pending = this->dsp->Flush()) {
+            this->reclaimedBuffers.push_back(pending);
+        }
 
-        this->decoderPosition =
-            (uint64_t)(actualSeconds * rate) * this->decoderChannels;
+        /* allow decoding to resume if we previously hit the end */
+        this->done = false;
+        this->drained = false;
 
-        /* move all the filled buffers back to the recycled queue */
+        /* move all the filled buffers back to the reclaimed queue. they're
+        ours again, there's no need to go through the recycled ring. */
         auto it = this->filledBuffers.begin();
         while (it != this->filledBuffers.end()) {
-            this->recycledBuffers.push_back(*it);
+            this->reclaimedBuffers.push_back(*it);
             ++it;
         }
 
         this->filledBuffers.clear();
     }
 
+    if (this->decodeAhead) {
+        this->decodeCondition.notify_all();
+    }
+
     return actualSeconds;
 }
 
@@ -121,28 +218,236 @@ int Stream::GetCapabilities() {
 bool Stream::OpenStream(std::string uri) {
     musik::debug::info(TAG, "opening " + uri);
 
-    /* use our file stream abstraction to open the data at the
-    specified URI */
-    this->dataStream = DataStreamFactory::OpenSharedDataStream(uri.c_str(), OpenFlags::Read);
+    /* the PlaybackService may have had this opened ahead of time */
+    if (!DecoderPool::Instance().Take(uri, this->dataStream, this->decoder)) {
+        /* use our file stream abstraction to open the data at the
+        specified URI */
+        this->dataStream = DataStreamFactory::OpenSharedDataStream(uri.c_str(), OpenFlags::Read);
 
-    if (!this->dataStream) {
-        musik::debug::error(TAG, "failed to open " + uri);
-        return false;
-    }
+        if (!this->dataStream) {
+            musik::debug::error(TAG, "failed to open " + uri);
+            return false;
+        }
 
-    this->decoder = streams::GetDecoderForDataStream(this->dataStream);
+        this->decoder = streams::GetDecoderForDataStream(this->dataStream);
+    }
 
     if (this->decoder) {
+        this->uri = uri;
+        this->LoadSeekIndex();
+
+        /* converted audio has to be staged somewhere anyway */
+        if (!this->converter) {
+            this->directDecoder = dynamic_cast<IDirectDecoder*>(this->decoder.get());
+        }
+
         if (this->dataStream->CanPrefetch()) {
             this->capabilities |= (int) musik::core::sdk::Capability::Prebuffer;
             this->RefillInternalBuffers();
         }
+
+        if (this->decodeAhead) {
+            this->StartDecodeAhead();
+        }
+
         return true;
     }
 
     return false;
 }
 
+void Stream::SetOutputFormat(long sampleRate, int channels) {
+    /* must be called before OpenStream(); the format can't change once
+    we've started filling buffers. */
+    if (sampleRate > 0 || channels > 0) {
+        this->converter.reset(new FormatConverter(
+            std::max(0L, sampleRate), std::max(0, channels)));
+    }
+    else {
+        this->converter.reset();
+    }
+}
+
+void Stream::SetPrebufferSeconds(double seconds) {
+    /* must be called before OpenStream(). by default we decode a quarter of
+    our buffers up front; this asks for more, up to all of them. */
+    this->prebufferSeconds = std::max(0.0, seconds);
+}
+
+void Stream::SetMetrics(StreamMetrics::Ptr metrics) {
+    /* must be called before OpenStream() */
+    this->metrics = metrics;
+}
+
+bool Stream::Eof() {
+    /* without readyBuffers the decoder never produced anything, so there's
+    no worker to mark us drained; we're at the end as soon as it gives up. */
+    if (this->decodeAhead && this->readyBuffers) {
+        return this->drained && this->readyBuffers->Empty();
+    }
+    return this->done;
+}
+
+void Stream::StartDecodeAhead() {
+    /* we need at least one decoded buffer to know the stream's format and
+    size our buffers. this is the same work prefetching would've done. */
+    if (this->allBuffers.empty()) {
+        this->RefillInternalBuffers();
+    }
+
+    if (this->allBuffers.size()) {
+        this->readyBuffers.reset(new BufferRing(this->bufferCount));
+        this->EnqueueFilledBuffers();
+
+        this->decodeThread.reset(new std::thread(
+            std::bind(&Stream::DecodeAheadThreadLoop, this)));
+    }
+}
+
+void Stream::DecodeAheadThreadLoop() {
+    musik::core::threads::Configure(musik::core::threads::Role::Audio);
+
+    /* if we run out of buffers we wait until the output returns one. notify
+    is done without holding the lock on the output thread, so also wake up
+    periodically -- every half a buffer's worth of audio. */
+    const long waitMs = std::max(1L,
+        (long)((this->samplesPerChannel * 500.0) / (double) this->decoderSampleRate));
+
+    std::unique_lock<std::mutex> lock(this->decoderMutex);
+
+    while (!this->quit) {
+        bool decoded = false;
+
+        if (!this->done) {
+            this->RefillInternalBuffers();
+            decoded = this->filledBuffers.size() > 0;
+            this->EnqueueFilledBuffers();
+        }
+
+        if (!decoded && !this->quit) {
+            this->decodeCondition.wait_for(lock, std::chrono::milliseconds(waitMs));
+        }
+    }
+}
+
+void Stream::EnqueueFilledBuffers() {
+    while (this->filledBuffers.size()) {
+        Buffer* buffer = this->filledBuffers.front();
+        this->filledBuffers.pop_front();
+
+        /* capacity matches the number of buffers we own; can't fail */
+        if ((buffer = this->ProcessBuffer(buffer))) {
+            this->readyBuffers->Push(buffer);
+        }
+    }
+
+    if (this->done) {
+        if (Buffer* last = this->dsp->Flush()) {
+            this->readyBuffers->Push(last);
+        }
+
+        /* 'done' is set before the last buffers are processed; this tells
+        the player there's really nothing else coming. */
+        this->drained = true;
+    }
+}
+
+bool Stream::SeekWithinHistory(double seconds) {
+    if (this->historyEnd == this->historyStart || seconds < 0.0) {
+        return false;
+    }
+
+    uint64_t position =
+        (uint64_t)(seconds * (double) this->decoderSampleRate) * this->decoderChannels;
+
+    if (position < this->historyStart || position > this->historyEnd) {
+        return false;
+    }
+
+    this->decoderPosition = position;
+    return true;
+}
+
+void Stream::AppendToHistory(const float* samples, long count) {
+    const size_t chunks = this->historyBuffers.size();
+
+    if (!chunks) {
+        this->historyStart = this->historyEnd += count;
+        return;
+    }
+
+    while (count > 0) {
+        size_t chunk = (size_t)((this->historyEnd / this->samplesPerBuffer) % chunks);
+        long offset = (long)(this->historyEnd % this->samplesPerBuffer);
+        long length = std::min(count, this->samplesPerBuffer - offset);
+
+        float* dst = this->historyBuffers[chunk]->BufferPointer() + offset;
+        std::copy(samples, samples + length, dst);
+
+        samples += length;
+        count -= length;
+        this->historyEnd += length;
+    }
+
+    const uint64_t capacity = (uint64_t) chunks * this->samplesPerBuffer;
+    if (this->historyEnd - this->historyStart > capacity) {
+        this->historyStart = this->historyEnd - capacity;
+    }
+}
+
+void Stream::CopyFromHistory(Buffer* target, long targetOffset, long count) {
+    const size_t chunks = this->historyBuffers.size();
+    uint64_t position = this->decoderPosition;
+
+    while (count > 0) {
+        size_t chunk = (size_t)((position / this->samplesPerBuffer) % chunks);
+        long offset = (long)(position % this->samplesPerBuffer);
+        long length = std::min(count, this->samplesPerBuffer - offset);
+
+        float* src = this->historyBuffers[chunk]->BufferPointer() + offset;
+        target->Copy(src, length, targetOffset);
+
+        targetOffset += length;
+        position += length;
+        count -= length;
+    }
+}
+
+void Stream::LoadSeekIndex() {
+    auto indexed = dynamic_cast<IIndexedDecoder*>(this->decoder.get());
+    const long length = this->dataStream->Length();
+
+    if (indexed && length > 0) {
+        std::vector<double> times;
+        std::vector<int64_t> offsets;
+
+        if (SeekIndexCache::Instance().Load(this->uri, length, times, offsets)) {
+            if (indexed->SetSeekIndex(times.data(), offsets.data(), (int) times.size())) {
+                this->seekIndexPoints = (int) times.size();
+            }
+        }
+    }
+}
+
+void Stream::SaveSeekIndex() {
+    auto indexed = dynamic_cast<IIndexedDecoder*>(this->decoder.get());
+    const long length = this->dataStream ? this->dataStream->Length() : 0;
+
+    if (indexed && length > 0) {
+        /* only write it back if we learned something */
+        int total = indexed->GetSeekIndex(nullptr, nullptr, 0);
+
+        if (total > this->seekIndexPoints) {
+            std::vector<double> times(total);
+            std::vector<int64_t> offsets(total);
+            total = indexed->GetSeekIndex(times.data(), offsets.data(), total);
+            times.resize(total);
+            offsets.resize(total);
+            SeekIndexCache::Instance().Save(this->uri, length, times, offsets);
+        }
+    }
+}
+
 void Stream::Interrupt() {
     if (this->dataStream) {
         this->dataStream->Interrupt();
@@ -150,32 +455,107 @@ void Stream::Interrupt() {
 }
 
 void Stream::OnBufferProcessedByPlayer(IBuffer* buffer) {
-    this->recycledBuffers.push_back((Buffer*) buffer);
+    /* usually called from the output's thread, but outputs also hand buffers
+    back from whoever calls Stop(), while their write thread may still be
+    doing the same. the ring only supports one producer at a time, so
+    producers take turns; a push is a couple of stores, so the wait is
+    never more than that. the ring is sized to hold every buffer we own,
+    so the push cannot fail. */
+    while (this->recycling.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    this->recycledBuffers->Push((Buffer*) buffer);
+
+    this->recycling.clear(std::memory_order_release);
+
+    if (this->decodeAhead) {
+        this->decodeCondition.notify_one();
+    }
+}
+
+void Stream::OnBufferDiscardedByPlayer(IBuffer* buffer) {
+    /* called from the same thread that pulls buffers, for buffers that
+    were never handed to the output. */
+    if (this->decodeAhead) {
+        {
+            std::unique_lock<std::mutex> lock(this->decoderMutex);
+            this->reclaimedBuffers.push_back((Buffer*) buffer);
+        }
+        this->decodeCondition.notify_one();
+    }
+    else {
+        this->reclaimedBuffers.push_back((Buffer*) buffer);
+    }
+}
+
+Buffer* Stream::ProcessBuffer(Buffer* buffer) {
+    if (this->metrics) {
+        ++this->metrics->buffersDecoded;
+    }
+
+    metrics::ScopedTimer timer(this->metrics ? &this->metrics->dspMicros : nullptr);
+    return this->dsp->Process(buffer);
 }
 
 bool Stream::GetNextBufferFromDecoder() {
+    metrics::ScopedTimer timer(this->metrics ? &this->metrics->decodeMicros : nullptr);
+
     /* ask the decoder for some data */
-    if (!this->decoder->GetBuffer(this->decoderBuffer)) {
+    if (this->converter) {
+        if (this->decoder->GetBuffer(this->rawBuffer)) {
+            if (this->converter->Passthrough(this->rawBuffer)) {
+                std::swap(this->rawBuffer, this->decoderBuffer);
+            }
+            else {
+                /* may be empty while the resampler fills up; that's fine,
+                the caller will just ask again. */
+                this->converter->Convert(this->rawBuffer, this->decoderBuffer);
+            }
+        }
+        else if (!this->converter->Drain(this->decoderBuffer)) {
+            return false;
+        }
+    }
+    else if (!this->decoder->GetBuffer(this->decoderBuffer)) {
         return false;
     }
 
     /* ensure our internal state is initialized */
-    if (!this->rawBuffer) {
+    if (this->allBuffers.empty()) {
         this->decoderSampleRate = this->decoderBuffer->SampleRate();
         this->decoderChannels = this->decoderBuffer->Channels();
         this->samplesPerBuffer = samplesPerChannel * decoderChannels;
 
-        this->bufferCount = std::max(MIN_BUFFER_COUNT, (int)(this->bufferLengthSeconds *
+        int requested = std::max(MIN_BUFFER_COUNT, (int)(this->bufferLengthSeconds *
             (double)(this->decoderSampleRate / this->samplesPerBuffer)));
 
-        this->rawBuffer = new float[bufferCount * this->samplesPerBuffer];
-        int offset = 0;
-        for (int i = 0; i < bufferCount; i++) {
-            auto buffer = new Buffer(this->rawBuffer + offset, this->samplesPerBuffer);
+        this->bufferCount = (int) BufferPool::Instance().Acquire(
+            this->samplesPerBuffer, requested, REQUIRED_BUFFER_COUNT, this->allBuffers);
+
+        this->recycledBuffers.reset(new BufferRing(bufferCount));
+
+        for (Buffer* buffer : this->allBuffers) {
             buffer->SetSampleRate(this->decoderSampleRate);
             buffer->SetChannels(this->decoderChannels);
-            this->recycledBuffers.push_back(buffer);
-            offset += this->samplesPerBuffer;
+            this->reclaimedBuffers.push_back(buffer);
+        }
+
+        /* the history needs to cover everything we may have buffered, plus
+        the pre-roll. it's optional, so we'll take whatever the pool can
+        spare, and go without if that's not enough to be useful. */
+        if (this->prerollSeconds > 0.0) {
+            const long prerollBuffers = (long)(this->prerollSeconds *
+                (double) this->decoderSampleRate / (double) this->samplesPerChannel) + 1;
+
+            const size_t wanted = this->bufferCount + prerollBuffers;
+
+            BufferPool::Instance().Acquire(
+                this->samplesPerBuffer, wanted, 0, this->historyBuffers);
+
+            if (this->historyBuffers.size() <= (size_t) this->bufferCount) {
+                BufferPool::Instance().Release(this->historyBuffers);
+            }
         }
     }
 
@@ -183,37 +563,57 @@ bool Stream::GetNextBufferFromDecoder() {
 }
 
 inline Buffer* Stream::GetEmptyBuffer() {
-    if (recycledBuffers.size()) {
-        Buffer* target = recycledBuffers.front();
-        recycledBuffers.pop_front();
-        return target;
+    Buffer* target = nullptr;
+    if (reclaimedBuffers.size()) {
+        target = reclaimedBuffers.front();
+        reclaimedBuffers.pop_front();
+    }
+    else if (recycledBuffers) {
+        recycledBuffers->Pop(target);
     }
-    return nullptr;
+    return target;
 }
 
 IBuffer* Stream::GetNextProcessedOutputBuffer() {
+    /* in decode-ahead mode the worker has already done the heavy lifting;
+    all we do here is dequeue. */
+    if (this->decodeAhead) {
+        Buffer* buffer = nullptr;
+        if (this->readyBuffers) {
+            if (this->metrics) {
+                this->metrics->decodeQueueDepth.Record(this->readyBuffers->Size());
+            }
+            this->readyBuffers->Pop(buffer);
+        }
+        return buffer;
+    }
+
     this->RefillInternalBuffers();
 
-    /* in the normal case we have buffers available in the filled queue. */
-    if (this->filledBuffers.size()) {
+    /* in the normal case we have buffers available in the filled queue. if
+    the DSP chain is pipelined the first one just primes it. */
+    while (this->filledBuffers.size()) {
         Buffer* buffer = this->filledBuffers.front();
         this->filledBuffers.pop_front();
 
-        for (std::shared_ptr<IDSP> dsp : this->dsps) {
-            dsp->Process(buffer);
+        if ((buffer = this->ProcessBuffer(buffer))) {
+            return buffer;
         }
-
-        return buffer;
     }
 
-    return nullptr;
+    /* the last buffer may still be in the second half of the chain */
+    return this->done ? this->dsp->Flush() : nullptr;
 }
 
 void Stream::RefillInternalBuffers() {
-    int recycled = this->recycledBuffers.size();
+    int recycled = (int) this->reclaimedBuffers.size();
+    if (this->recycledBuffers) {
+        recycled += (int) this->recycledBuffers->Size();
+    }
+
     int count = 0;
 
-    if (!this->rawBuffer) { /* not initialized */
+    if (this->allBuffers.empty()) { /* not initialized */
         count = -1;
     }
     else {
@@ -228,12 +628,22 @@ void Stream::RefillInternalBuffers() {
     long targetSamplesRemain = 0;
 
     while (!this->done && (count > 0 || count == -1)) {
+        /* after a seek into the history we replay it before going back
+        to the decoder, which was never moved. */
+        const bool replaying = this->decoderPosition < this->historyEnd;
+
+        /* once we know the format, decoders that support it write directly
+        to our buffers. anything left in decoderBuffer goes first. */
+        const bool direct = this->directDecoder && !replaying &&
+            this->decoderSamplesRemain <= 0 && !this->allBuffers.empty();
+
         /* get the next buffer, if the last one has been consumed... */
-        if (this->decoderSamplesRemain <= 0) {
-            if (!GetNextBufferFromDecoder()) {
+        if (!replaying && !direct && this->decoderSamplesRemain <= 0) {
+            if (this->decoderExhausted || !GetNextBufferFromDecoder()) {
                 if (target) { /* very last buffer for this stream. */
                     target->SetSamples(targetSampleOffset);
                 }
+                this->decoderExhausted = true;
                 this->done = true;
                 break;
             }
@@ -247,9 +657,18 @@ void Stream::RefillInternalBuffers() {
         }
 
         /* count will be < 0 on the very first pass through. let's try to
-        fill 1/4 of our buffers */
+        fill 1/4 of our buffers, or however many we were asked to */
         if (count < 0) {
             count = bufferCount / 4;
+
+            if (this->prebufferSeconds > 0.0) {
+                const double samples = this->prebufferSeconds *
+                    (double) this->decoderSampleRate * (double) this->decoderChannels;
+
+                const int wanted = (int) ceil(samples / (double) this->samplesPerBuffer);
+
+                count = std::max(count, std::min(wanted, this->bufferCount - 1));
+            }
         }
 
         /* we're going to write to this guy... */
@@ -275,14 +694,54 @@ void Stream::RefillInternalBuffers() {
         empty. we'll go through the loop again... */
         targetSamplesRemain = this->samplesPerBuffer - targetSampleOffset;
         if (targetSamplesRemain > 0) {
-            long samplesToCopy = std::min(this->decoderSamplesRemain, targetSamplesRemain);
-            if (samplesToCopy > 0) {
-                float* src = this->decoderBuffer->BufferPointer() + this->decoderSampleOffset;
-                target->Copy(src, samplesToCopy, targetSampleOffset);
+            long samplesToCopy = 0;
+
+            if (replaying) {
+                samplesToCopy = (long) std::min(
+                    this->historyEnd - this->decoderPosition, (uint64_t) targetSamplesRemain);
+
+                this->CopyFromHistory(target, targetSampleOffset, samplesToCopy);
+            }
+            else if (direct) {
+                float* dst = target->BufferPointer() + targetSampleOffset;
 
+                {
+                    metrics::ScopedTimer timer(this->metrics ? &this->metrics->decodeMicros : nullptr);
+                    samplesToCopy = this->directDecoder->Decode(dst, targetSamplesRemain);
+                }
+
+                if (samplesToCopy <= 0) {
+                    if (targetSampleOffset == 0) {
+                        /* nothing was written, don't hand it to the player */
+                        this->filledBuffers.pop_back();
+                        this->reclaimedBuffers.push_back(target);
+                    }
+                    else {
+                        target->SetSamples(targetSampleOffset);
+                    }
+                    this->decoderExhausted = true;
+                    this->done = true;
+                    break;
+                }
+
+                target->SetSamples(targetSampleOffset + samplesToCopy);
+                this->AppendToHistory(dst, samplesToCopy);
+            }
+            else {
+                samplesToCopy = std::min(this->decoderSamplesRemain, targetSamplesRemain);
+
+                if (samplesToCopy > 0) {
+                    float* src = this->decoderBuffer->BufferPointer() + this->decoderSampleOffset;
+                    target->Copy(src, samplesToCopy, targetSampleOffset);
+                    this->AppendToHistory(src, samplesToCopy);
+
+                    this->decoderSampleOffset += samplesToCopy;
+                    this->decoderSamplesRemain -= samplesToCopy;
+                }
+            }
+
+            if (samplesToCopy > 0) {
                 this->decoderPosition += samplesToCopy;
-                this->decoderSampleOffset += samplesToCopy;
-                this->decoderSamplesRemain -= samplesToCopy;
 
                 targetSampleOffset += samplesToCopy;
 
@@ -37,87 +37,152 @@
 #include <core/config.h>
 #include <core/io/DataStreamFactory.h>
 #include <core/audio/Buffer.h>
+#include <core/audio/DspPipeline.h>
+#include <core/audio/FormatConverter.h>
 #include <core/audio/IStream.h>
+#include <core/audio/SpscRing.h>
 #include <core/sdk/IDecoder.h>
+#include <core/sdk/IDirectDecoder.h>
 #include <core/sdk/IDSP.h>
 #include <core/sdk/constants.h>
 
 #include <deque>
 #include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 namespace musik { namespace core { namespace audio {
 
     class Stream : public IStream {
-        using IDSP = musik::core::sdk::IDSP;
         using IDecoder = musik::core::sdk::IDecoder;
         using IBuffer = musik::core::sdk::IBuffer;
         using StreamFlags = musik::core::sdk::StreamFlags;
 
         public:
+            /* prerollSeconds: how much already-played audio to keep around
+            so short seeks can be served without touching the decoder. */
             static IStreamPtr Create(
                 int samplesPerChannel = 2048,
                 double bufferLengthSeconds = 5,
-                StreamFlags options = StreamFlags::None);
+                StreamFlags options = StreamFlags::None,
+                double prerollSeconds = 0.0);
 
             static IStream* CreateUnmanaged(
                 int samplesPerChannel = 2048,
                 double bufferLengthSeconds = 5,
-                StreamFlags options = StreamFlags::None);
+                StreamFlags options = StreamFlags::None,
+                double prerollSeconds = 0.0);
 
         private:
             Stream(
                 int samplesPerChannel,
                 double bufferLengthSeconds,
-                StreamFlags options);
+                StreamFlags options,
+                double prerollSeconds);
 
         public:
             virtual ~Stream();
 
             virtual IBuffer* GetNextProcessedOutputBuffer() override;
             virtual void OnBufferProcessedByPlayer(IBuffer* buffer) override;
+            virtual void OnBufferDiscardedByPlayer(IBuffer* buffer) override;
             virtual double SetPosition(double seconds) override;
             virtual double GetDuration() override;
             virtual bool OpenStream(std::string uri) override;
+            virtual void SetOutputFormat(long sampleRate, int channels) override;
+            virtual void SetPrebufferSeconds(double seconds) override;
+            virtual void SetMetrics(StreamMetrics::Ptr metrics) override;
             virtual void Interrupt() override;
             virtual int GetCapabilities() override;
-            virtual bool Eof() override { return this->done; }
+            virtual bool Eof() override;
             virtual void Release() override { delete this; }
 
         private:
             bool GetNextBufferFromDecoder();
             Buffer* GetEmptyBuffer();
             void RefillInternalBuffers();
+            void StartDecodeAhead();
+            void DecodeAheadThreadLoop();
+            void EnqueueFilledBuffers();
+            Buffer* ProcessBuffer(Buffer* buffer);
+            void AppendToHistory(const float* samples, long count);
+            void CopyFromHistory(Buffer* target, long targetOffset, long count);
+            bool SeekWithinHistory(double seconds);
+            void LoadSeekIndex();
+            void SaveSeekIndex();
 
             typedef std::deque<Buffer*> BufferList;
+            typedef SpscRing<Buffer*> BufferRing;
             typedef std::shared_ptr<IDecoder> DecoderPtr;
-            typedef std::shared_ptr<IDSP> DspPtr;
-            typedef std::vector<DspPtr> Dsps;
 
             long decoderSampleRate;
             long decoderChannels;
             std::string uri;
             musik::core::io::DataStreamFactory::DataStreamPtr dataStream;
 
-            BufferList recycledBuffers;
+            /* buffers are handed back by the output via a lock-free ring;
+            recycling serializes the output's threads pushing to it.
+            everything else is only ever touched by the thread that drives
+            GetNextProcessedOutputBuffer() */
+            std::unique_ptr<BufferRing> recycledBuffers;
+            std::atomic_flag recycling;
+            std::vector<Buffer*> allBuffers;
+            BufferList reclaimedBuffers;
             BufferList filledBuffers;
 
+            /* decode-ahead mode only: a worker thread decodes and runs the
+            DSP chain, then hands buffers to the player through readyBuffers.
+            decoderMutex serializes the worker against seeks and discards;
+            it is never taken when the player thread dequeues. */
+            std::unique_ptr<BufferRing> readyBuffers;
+            std::unique_ptr<std::thread> decodeThread;
+            std::mutex decoderMutex;
+            std::condition_variable decodeCondition;
+            std::atomic<bool> quit;
+            std::atomic<bool> drained; /* done, and everything is in readyBuffers */
+            bool decodeAhead;
+
             Buffer* decoderBuffer;
             long decoderSampleOffset;
             long decoderSamplesRemain;
             uint64_t decoderPosition;
+            bool decoderExhausted;
+
+            /* set if the output wants a fixed format. the decoder then writes
+            to rawBuffer, and decoderBuffer holds the converted audio; from
+            here on everything (positions, history) is in the output format */
+            std::unique_ptr<FormatConverter> converter;
+            Buffer* rawBuffer;
+
+            /* a ring of every sample we've recently taken from the decoder,
+            covering [historyStart, historyEnd). it spans everything that's
+            buffered but not yet played, plus the pre-roll. while replaying
+            after a seek into it, decoderPosition < historyEnd. */
+            std::vector<Buffer*> historyBuffers;
+            uint64_t historyStart;
+            uint64_t historyEnd;
+            double prerollSeconds;
+            double prebufferSeconds; /* decoded up front by OpenStream() */
+
+            int seekIndexPoints;
 
             musik::core::sdk::StreamFlags options;
             int samplesPerChannel;
             long samplesPerBuffer;
             int bufferCount;
-            bool done;
+            std::atomic<bool> done;
             double bufferLengthSeconds;
             int capabilities;
 
-            float* rawBuffer;
-
             DecoderPtr decoder;
-            Dsps dsps;
+            std::unique_ptr<DspPipeline> dsp;
+            StreamMetrics::Ptr metrics; /* optional */
+
+            /* non-null if the decoder can write straight into our buffers,
+            and we don't need to convert its output first. */
+            musik::core::sdk::IDirectDecoder* directDecoder;
     };
 
 } } }
@@ -0,0 +1,200 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <core/audio/StreamMetrics.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+static const int BucketCount = PlaybackHistogram::BucketCount;
+
+static std::mutex registryMutex;
+static std::vector<StreamMetrics*> live;
+static PlaybackMetrics retired = { 0 };
+static std::map<IOutputDiagnostics*, uint64_t> outputBaselines;
+static std::atomic<uint64_t> nextId(1);
+
+static inline int bucketFor(uint64_t value) {
+    int bucket = 0;
+    while (value && bucket < BucketCount - 1) {
+        value >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+static void accumulate(PlaybackHistogram& target, const PlaybackHistogram& source) {
+    target.count += source.count;
+    target.sum += source.sum;
+    target.max = std::max(target.max, source.max);
+    for (int i = 0; i < BucketCount; i++) {
+        target.buckets[i] += source.buckets[i];
+    }
+}
+
+static void accumulate(PlaybackMetrics& target, const PlaybackMetrics& source) {
+    target.buffersDecoded += source.buffersDecoded;
+    target.buffersPlayed += source.buffersPlayed;
+    target.starved += source.starved;
+    target.outputUnderruns += source.outputUnderruns;
+    target.transitions += source.transitions;
+    accumulate(target.decodeMicros, source.decodeMicros);
+    accumulate(target.dspMicros, source.dspMicros);
+    accumulate(target.outputMicros, source.outputMicros);
+    accumulate(target.decodeQueueDepth, source.decodeQueueDepth);
+    accumulate(target.outputQueueDepth, source.outputQueueDepth);
+    accumulate(target.transitionGapMicros, source.transitionGapMicros);
+}
+
+/* ------------------------------------------------------------------------ */
+
+Histogram::Histogram()
+: count(0)
+, sum(0)
+, max(0) {
+    for (int i = 0; i < BucketCount; i++) {
+        this->buckets[i].store(0);
+    }
+}
+
+void Histogram::Record(uint64_t value) {
+    this->count.fetch_add(1, std::memory_order_relaxed);
+    this->sum.fetch_add(value, std::memory_order_relaxed);
+    this->buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t current = this->max.load(std::memory_order_relaxed);
+    while (value > current && !this->max.compare_exchange_weak(current, value)) {
+        /* 'current' was reloaded; try again */
+    }
+}
+
+void Histogram::Snapshot(PlaybackHistogram& target) const {
+    /* fields are read individually, so a snapshot taken mid-update may be
+    off by one here and there. that's fine for what this is used for. */
+    target.count = this->count.load(std::memory_order_relaxed);
+    target.sum = this->sum.load(std::memory_order_relaxed);
+    target.max = this->max.load(std::memory_order_relaxed);
+    for (int i = 0; i < BucketCount; i++) {
+        target.buckets[i] = this->buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+
+StreamMetrics::Ptr StreamMetrics::Create() {
+    Ptr result(new StreamMetrics());
+    std::unique_lock<std::mutex> lock(registryMutex);
+    live.push_back(result.get());
+    return result;
+}
+
+StreamMetrics::StreamMetrics()
+: buffersDecoded(0)
+, buffersPlayed(0)
+, starved(0)
+, outputUnderruns(0)
+, transitions(0)
+, id(nextId.fetch_add(1)) {
+}
+
+StreamMetrics::~StreamMetrics() {
+    PlaybackMetrics final;
+    this->Snapshot(final);
+
+    std::unique_lock<std::mutex> lock(registryMutex);
+    live.erase(std::remove(live.begin(), live.end(), this), live.end());
+    accumulate(retired, final);
+}
+
+void StreamMetrics::Snapshot(PlaybackMetrics& target) const {
+    target.id = this->id;
+    target.buffersDecoded = this->buffersDecoded.load();
+    target.buffersPlayed = this->buffersPlayed.load();
+    target.starved = this->starved.load();
+    target.outputUnderruns = this->outputUnderruns.load();
+    target.transitions = this->transitions.load();
+    this->decodeMicros.Snapshot(target.decodeMicros);
+    this->dspMicros.Snapshot(target.dspMicros);
+    this->outputMicros.Snapshot(target.outputMicros);
+    this->decodeQueueDepth.Snapshot(target.decodeQueueDepth);
+    this->outputQueueDepth.Snapshot(target.outputQueueDepth);
+    this->transitionGapMicros.Snapshot(target.transitionGapMicros);
+}
+
+/* ------------------------------------------------------------------------ */
+
+namespace musik { namespace core { namespace audio { namespace metrics {
+
+    void GetSnapshot(std::vector<PlaybackMetrics>& target) {
+        std::unique_lock<std::mutex> lock(registryMutex);
+
+        target.resize(live.size() + 1);
+
+        PlaybackMetrics& totals = target[0];
+        totals = retired;
+        totals.id = 0;
+
+        for (size_t i = 0; i < live.size(); i++) {
+            live[i]->Snapshot(target[i + 1]);
+            accumulate(totals, target[i + 1]);
+        }
+    }
+
+    void ObserveOutput(IOutputDiagnostics* output, StreamMetrics& metrics) {
+        const uint64_t underruns = output->Underruns();
+
+        std::unique_lock<std::mutex> lock(registryMutex);
+
+        /* the first time we see an output we only take a baseline; whatever
+        happened before isn't ours. if the count went backwards this is a new
+        output that happens to live at the same address. */
+        auto it = outputBaselines.find(output);
+        if (it == outputBaselines.end()) {
+            outputBaselines[output] = underruns;
+        }
+        else {
+            if (underruns > it->second) {
+                metrics.outputUnderruns += (underruns - it->second);
+            }
+            it->second = underruns;
+        }
+    }
+
+} } } }
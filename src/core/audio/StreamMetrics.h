@@ -0,0 +1,129 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <core/config.h>
+#include <core/sdk/IOutputDiagnostics.h>
+#include <core/sdk/PlaybackMetrics.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* lock-free, so it can be updated from the decode, player and output
+    threads while someone else takes a snapshot. */
+    class Histogram {
+        public:
+            Histogram();
+
+            void Record(uint64_t value);
+            void Snapshot(musik::core::sdk::PlaybackHistogram& target) const;
+
+        private:
+            std::atomic<uint64_t> count, sum, max;
+            std::atomic<uint64_t> buckets[musik::core::sdk::PlaybackHistogram::BucketCount];
+    };
+
+    /* counters and histograms for one Stream and the Player feeding it to the
+    output. every live instance is tracked, and folded into the process-wide
+    totals when it's destroyed. see metrics::GetSnapshot(). */
+    class StreamMetrics {
+        public:
+            using Ptr = std::shared_ptr<StreamMetrics>;
+
+            static Ptr Create();
+
+            ~StreamMetrics();
+
+            uint64_t Id() const { return this->id; }
+            void Snapshot(musik::core::sdk::PlaybackMetrics& target) const;
+
+            std::atomic<uint64_t> buffersDecoded;
+            std::atomic<uint64_t> buffersPlayed;
+            std::atomic<uint64_t> starved;
+            std::atomic<uint64_t> outputUnderruns;
+            std::atomic<uint64_t> transitions;
+
+            Histogram decodeMicros;
+            Histogram dspMicros;
+            Histogram outputMicros;
+            Histogram decodeQueueDepth;
+            Histogram outputQueueDepth;
+            Histogram transitionGapMicros;
+
+        private:
+            StreamMetrics();
+
+            uint64_t id;
+    };
+
+    namespace metrics {
+        /* records the time between construction and destruction into
+        'target'; does nothing if 'target' is null. */
+        class ScopedTimer {
+            public:
+                ScopedTimer(Histogram* target)
+                : target(target) {
+                    if (target) {
+                        this->start = std::chrono::steady_clock::now();
+                    }
+                }
+
+                ~ScopedTimer() {
+                    if (this->target) {
+                        this->target->Record((uint64_t)
+                            std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - this->start).count());
+                    }
+                }
+
+            private:
+                Histogram* target;
+                std::chrono::steady_clock::time_point start;
+        };
+
+        /* entry 0 is the total of everything played since startup, live
+        streams included; the rest are the live streams, oldest first. */
+        void GetSnapshot(std::vector<musik::core::sdk::PlaybackMetrics>& target);
+
+        /* outputs are shared between players, so underruns are counted per
+        output, and new ones charged to whichever stream noticed them. */
+        void ObserveOutput(musik::core::sdk::IOutputDiagnostics* output, StreamMetrics& metrics);
+    }
+
+} } }
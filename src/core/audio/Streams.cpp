@@ -39,6 +39,7 @@
 #include <core/sdk/IDecoderFactory.h>
 #include <core/sdk/IEncoderFactory.h>
 #include <core/plugin/PluginFactory.h>
+#include <chrono>
 #include <mutex>
 
 #define TAG "Streams"
@@ -54,26 +55,62 @@ using DspList = std::vector<std::shared_ptr<IDSP>>;
 using Deleter = PluginFactory::ReleaseDeleter<IDecoder>;
 using DecoderPtr = std::shared_ptr<IDecoder>;
 
+typedef IDSP* STDCALL(GetDsp); /* same convention PluginFactory::QueryInterface uses */
+
+struct DspFactory {
+    std::string name;
+    GetDsp create;
+};
+
 static std::mutex initLock;
+static bool initialized = false;
 static DecoderFactoryList decoders;
 static EncoderFactoryList encoders;
 
+/* every Stream needs its own DSP instances, but there's no need to walk
+all the plugins looking for them each time. resolve the exported function
+once and call it directly. */
+static std::vector<DspFactory> dspFactories;
+
 static void init() {
     std::unique_lock<std::mutex> lock(initLock);
 
-    if (!decoders.size()) {
+    if (initialized) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    {
         using Deleter = PluginFactory::ReleaseDeleter<IDecoderFactory>;
 
         decoders = PluginFactory::Instance()
             .QueryInterface<IDecoderFactory, Deleter>("GetDecoderFactory");
     }
 
-    if (!encoders.size()) {
+    {
         using Deleter = PluginFactory::ReleaseDeleter<IEncoderFactory>;
 
         encoders = PluginFactory::Instance()
             .QueryInterface<IEncoderFactory, Deleter>("GetEncoderFactory");
     }
+
+    PluginFactory::Instance().QueryFunction<GetDsp>(
+        "GetDSP",
+        [](IPlugin* plugin, GetDsp func) {
+            dspFactories.push_back({ plugin ? plugin->Name() : "unknown", func });
+        });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    musik::debug::info(TAG,
+        "resolved " + std::to_string(decoders.size()) + " decoders, " +
+        std::to_string(encoders.size()) + " encoders and " +
+        std::to_string(dspFactories.size()) + " dsps in " +
+        std::to_string(elapsed) + "us");
+
+    initialized = true;
 }
 
 namespace musik { namespace core { namespace audio {
@@ -141,8 +178,29 @@ namespace musik { namespace core { namespace audio {
         }
 
         DspList GetDspPlugins() {
+            DspList result;
+            for (auto& dsp : GetNamedDspPlugins()) {
+                result.push_back(dsp.second);
+            }
+            return result;
+        }
+
+        std::vector<NamedDsp> GetNamedDspPlugins() {
             typedef PluginFactory::ReleaseDeleter<IDSP> Deleter;
-            return PluginFactory::Instance().QueryInterface<IDSP, Deleter>("GetDSP");
+
+            init();
+
+            /* note plugins enabled or disabled after we first looked won't
+            be picked up; like decoders, that needs a restart. */
+            std::vector<NamedDsp> result;
+            for (auto& factory : dspFactories) {
+                IDSP* dsp = factory.create();
+                if (dsp) {
+                    result.push_back(NamedDsp(factory.name, std::shared_ptr<IDSP>(dsp, Deleter())));
+                }
+            }
+
+            return result;
         }
     };
 
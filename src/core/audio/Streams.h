@@ -42,6 +42,8 @@
 #include <core/sdk/IDecoderFactory.h>
 
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace musik { namespace core { namespace audio {
@@ -56,6 +58,10 @@ namespace musik { namespace core { namespace audio {
         musik::core::sdk::IEncoder* GetEncoderForType(const char* type);
 
         std::vector<std::shared_ptr<musik::core::sdk::IDSP > > GetDspPlugins();
+
+        /* as above, paired with the name of the plugin that provided each one */
+        using NamedDsp = std::pair<std::string, std::shared_ptr<musik::core::sdk::IDSP>>;
+        std::vector<NamedDsp> GetNamedDspPlugins();
     };
 
 } } }
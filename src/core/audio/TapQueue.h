@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <core/audio/SpscRing.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* hands copies of played audio from an output to a visualizer worker
+    without locking. a fixed set of blocks circulates between two rings: the
+    writer takes a free one, fills it, and queues it; the worker reads it and
+    gives it back. if the worker falls behind there are no free blocks, and
+    the writer drops the audio rather than waiting. */
+    class TapQueue {
+        public:
+            struct Block {
+                std::vector<float> samples;
+                long count;
+                int channels;
+                long sampleRate;
+            };
+
+            TapQueue(size_t blockCount)
+            : freeBlocks(blockCount)
+            , filledBlocks(blockCount) {
+                this->writing.clear();
+
+                for (size_t i = 0; i < blockCount; i++) {
+                    this->blocks.push_back(std::unique_ptr<Block>(new Block()));
+                    this->freeBlocks.Push(this->blocks.back().get());
+                }
+            }
+
+            /* calls fill(block) with a free block that has room for at least
+            maxSamples, then queues it. fill sets the block's count, channels
+            and sample rate. returns false if the audio was dropped. */
+            template <typename Fill>
+            bool Write(long maxSamples, Fill fill) {
+                /* the rings only allow one writer. outputs almost always call
+                us from one thread, but if two overlap the second one just
+                skips this buffer. */
+                if (this->writing.test_and_set(std::memory_order_acquire)) {
+                    return false;
+                }
+
+                Block* block = nullptr;
+                const bool queued = this->freeBlocks.Pop(block);
+
+                if (queued) {
+                    /* only allocates the first few times through */
+                    if ((long) block->samples.size() < maxSamples) {
+                        block->samples.resize(maxSamples);
+                    }
+
+                    fill(*block);
+
+                    /* holds every block we own; can't fail */
+                    this->filledBlocks.Push(block);
+                }
+
+                this->writing.clear(std::memory_order_release);
+                return queued;
+            }
+
+            /* worker thread only. every block read must be released. */
+            bool Read(Block*& block) {
+                return this->filledBlocks.Pop(block);
+            }
+
+            void Release(Block* block) {
+                this->freeBlocks.Push(block);
+            }
+
+        private:
+            std::vector<std::unique_ptr<Block>> blocks;
+            SpscRing<Block*> freeBlocks, filledBlocks;
+            std::atomic_flag writing;
+    };
+
+} } }
@@ -502,6 +502,41 @@ mcsdk_export mcsdk_track_list mcsdk_svc_playback_clone(mcsdk_svc_playback pb) {
     return mcsdk_track_list { PLAYBACK(pb)->Clone() };
 }
 
+static void copy_histogram(const PlaybackHistogram& src, mcsdk_playback_histogram& dst) {
+    dst.count = src.count;
+    dst.sum = src.sum;
+    dst.max = src.max;
+    for (int i = 0; i < PlaybackHistogram::BucketCount; i++) {
+        dst.buckets[i] = src.buckets[i];
+    }
+}
+
+mcsdk_export size_t mcsdk_svc_playback_get_metrics(mcsdk_svc_playback pb, mcsdk_playback_metrics* target, size_t count) {
+    static_assert(PlaybackHistogram::BucketCount == 24, "update mcsdk_playback_histogram");
+
+    std::vector<PlaybackMetrics> metrics(count);
+    size_t available = PLAYBACK(pb)->GetPlaybackMetrics(metrics.data(), count);
+
+    for (size_t i = 0; target && i < std::min(count, available); i++) {
+        const PlaybackMetrics& src = metrics[i];
+        mcsdk_playback_metrics& dst = target[i];
+        dst.id = src.id;
+        dst.buffers_decoded = src.buffersDecoded;
+        dst.buffers_played = src.buffersPlayed;
+        dst.starved = src.starved;
+        dst.output_underruns = src.outputUnderruns;
+        dst.transitions = src.transitions;
+        copy_histogram(src.decodeMicros, dst.decode_micros);
+        copy_histogram(src.dspMicros, dst.dsp_micros);
+        copy_histogram(src.outputMicros, dst.output_micros);
+        copy_histogram(src.decodeQueueDepth, dst.decode_queue_depth);
+        copy_histogram(src.outputQueueDepth, dst.output_queue_depth);
+        copy_histogram(src.transitionGapMicros, dst.transition_gap_micros);
+    }
+
+    return available;
+}
+
 /*
  * IPreferences
  */
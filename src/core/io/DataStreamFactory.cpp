@@ -38,7 +38,11 @@
 #include <core/config.h>
 #include <core/plugin/PluginFactory.h>
 #include <core/io/LocalFileStream.h>
+#include <core/io/MappedFileStream.h>
+#include <core/support/Preferences.h>
+#include <core/support/PreferenceKeys.h>
 
+using namespace musik::core;
 using namespace musik::core::io;
 using namespace musik::core::sdk;
 
@@ -51,6 +55,9 @@ DataStreamFactory::DataStreamFactory() {
 
     this->dataStreamFactories = musik::core::PluginFactory::Instance()
         .QueryInterface<PluginType, Deleter>("GetDataStreamFactory");
+
+    auto prefs = Preferences::ForComponent(prefs::components::Settings);
+    this->mapFiles = prefs->GetBool(prefs::keys::MemoryMappedFiles, false);
 }
 
 DataStreamFactory* DataStreamFactory::Instance() {
@@ -81,7 +88,17 @@ IDataStream* DataStreamFactory::OpenDataStream(const char* uri, OpenFlags flags)
             }
         }
 
-        /* no plugins accepted it? try to open as a local file */
+        /* no plugins accepted it? try to open as a local file. if we're just
+        reading, and the user has opted in, map it; if that doesn't work (e.g.
+        it's empty, or there's not enough address space) use plain old stdio. */
+        if (flags == OpenFlags::Read && DataStreamFactory::Instance()->mapFiles) {
+            IDataStream* mappedFile = new MappedFileStream();
+            if (mappedFile->Open(uri, flags)) {
+                return mappedFile;
+            }
+            mappedFile->Release();
+        }
+
         IDataStream* regularFile = new LocalFileStream();
         if (regularFile->Open(uri, flags)) {
             return regularFile;
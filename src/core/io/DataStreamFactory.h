@@ -55,6 +55,7 @@ namespace musik { namespace core { namespace io {
             static DataStreamFactory* Instance();
 
             DataStreamFactoryVector dataStreamFactories;
+            bool mapFiles;
     };
 
 } } }
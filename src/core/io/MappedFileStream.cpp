@@ -0,0 +1,280 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <core/debug.h>
+#include <core/io/MappedFileStream.h>
+#include <core/support/Common.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#ifndef WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static const std::string TAG = "MappedFileStream";
+
+/* how far ahead of the read position we ask the kernel to have the file in
+memory. we ask again each time we're half way through the last window, so
+there's always at least half of this in flight. */
+#define READ_AHEAD_BYTES (2 * 1024 * 1024)
+
+using namespace musik::core::io;
+using namespace musik::core::sdk;
+
+MappedFileStream::MappedFileStream()
+: data(nullptr)
+, filesize(-1)
+, position(0)
+, adviseAt(0)
+#ifdef WIN32
+, mapping(nullptr)
+#endif
+{
+}
+
+MappedFileStream::~MappedFileStream() {
+    this->Close();
+}
+
+bool MappedFileStream::Open(const char *filename, OpenFlags flags) {
+    if (flags != OpenFlags::Read) {
+        return false; /* read-only, by design */
+    }
+
+    this->uri = filename;
+
+    try {
+        boost::filesystem::path path(filename);
+        this->extension = path.extension().string();
+    }
+    catch (...) {
+        return false;
+    }
+
+#ifdef WIN32
+    HANDLE file = CreateFileW(
+        u8to16(this->uri).c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || size.QuadPart > LONG_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file); /* the mapping keeps its own reference */
+
+    if (!mapping) {
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    this->mapping = mapping;
+    this->data = (const char*) view;
+    this->filesize = (long) size.QuadPart;
+#else
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || (uint64_t) st.st_size > (uint64_t) LONG_MAX)
+    {
+        /* empty files can't be mapped; LocalFileStream can have those */
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); /* the mapping keeps its own reference */
+
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    /* we'll mostly read front to back, so more aggressive read-ahead, and
+    pages behind us can be dropped early. AdviseReadAhead() does the rest */
+    madvise(view, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    this->data = (const char*) view;
+    this->filesize = (long) st.st_size;
+#endif
+
+    this->position = 0;
+    this->adviseAt = 0;
+    this->AdviseReadAhead();
+
+    debug::info(TAG, "mapped " + this->uri);
+    return true;
+}
+
+void MappedFileStream::AdviseReadAhead() {
+    if (this->position < this->adviseAt) {
+        return;
+    }
+
+#ifndef WIN32
+    static const long pageSize = std::max(1L, sysconf(_SC_PAGESIZE));
+
+    /* madvise() wants a page aligned address */
+    const long start = (this->position / pageSize) * pageSize;
+    const long end = std::min(this->filesize, this->position + READ_AHEAD_BYTES);
+
+    if (end > start) {
+        madvise((void*) (this->data + start), (size_t) (end - start), MADV_WILLNEED);
+    }
+#endif
+    /* on windows FILE_FLAG_SEQUENTIAL_SCAN covers the common case */
+
+    this->adviseAt = this->position + (READ_AHEAD_BYTES / 2);
+}
+
+void MappedFileStream::Interrupt() {
+
+}
+
+bool MappedFileStream::Close() {
+    if (!this->data) {
+        return false;
+    }
+
+#ifdef WIN32
+    UnmapViewOfFile(this->data);
+    CloseHandle(this->mapping);
+    this->mapping = nullptr;
+#else
+    munmap((void*) this->data, (size_t) this->filesize);
+#endif
+
+    this->data = nullptr;
+    return true;
+}
+
+void MappedFileStream::Release() {
+    delete this;
+}
+
+PositionType MappedFileStream::Read(void* buffer, PositionType readBytes) {
+    if (!this->data || readBytes <= 0 || this->position >= this->filesize) {
+        return 0;
+    }
+
+    const long count = std::min((long) readBytes, this->filesize - this->position);
+    memcpy(buffer, this->data + this->position, (size_t) count);
+    this->position += count;
+
+    this->AdviseReadAhead();
+
+    return (PositionType) count;
+}
+
+PositionType MappedFileStream::View(const void** data, PositionType maxBytes) {
+    if (!this->data || maxBytes <= 0 || this->position >= this->filesize) {
+        return 0;
+    }
+
+    const long count = std::min((long) maxBytes, this->filesize - this->position);
+    *data = this->data + this->position;
+    this->position += count;
+
+    this->AdviseReadAhead();
+
+    return (PositionType) count;
+}
+
+PositionType MappedFileStream::Write(void* buffer, PositionType writeBytes) {
+    return 0;
+}
+
+bool MappedFileStream::SetPosition(PositionType position) {
+    if (!this->data || position < 0 || position > this->filesize) {
+        return false;
+    }
+
+    this->position = position;
+
+    /* a seek: whatever we asked for last time is probably no use now */
+    this->adviseAt = 0;
+    this->AdviseReadAhead();
+
+    return true;
+}
+
+PositionType MappedFileStream::Position() {
+    return this->data ? this->position : -1;
+}
+
+bool MappedFileStream::Eof() {
+    return !this->data || this->position >= this->filesize;
+}
+
+long MappedFileStream::Length() {
+    return this->filesize;
+}
+
+bool MappedFileStream::Seekable() {
+    return true;
+}
+
+const char* MappedFileStream::Type() {
+    return this->extension.c_str();
+}
+
+const char* MappedFileStream::Uri() {
+    return this->uri.c_str();
+}
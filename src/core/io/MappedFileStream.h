@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <core/config.h>
+#include <core/sdk/IDataStream.h>
+#include <core/sdk/IDataStreamView.h>
+#include <string>
+
+namespace musik { namespace core { namespace io {
+
+    /* a read-only local file, mapped into memory in its entirety. reads are
+    a memcpy out of the mapping, so decoders that pull data in small chunks
+    don't cost a syscall each, and the kernel is told how we're going to
+    read the file so it can fetch it ahead of us in big requests. the
+    DataStreamFactory only uses this, instead of LocalFileStream, for files
+    opened for reading when the MemoryMappedFiles preference is turned on.
+
+    it's off by default because if the file is truncated while it's mapped
+    (e.g. re-tagged in place by another program, or on a removable or
+    network drive that goes away) the next access past the new end of the
+    file raises SIGBUS and takes the process down. */
+    class MappedFileStream :
+        public musik::core::sdk::IDataStream,
+        public musik::core::sdk::IDataStreamView
+    {
+        public:
+            using PositionType = musik::core::sdk::PositionType;
+            using OpenFlags = musik::core::sdk::OpenFlags;
+
+            MappedFileStream();
+            virtual ~MappedFileStream();
+
+            virtual bool Open(const char *filename, OpenFlags flags);
+            virtual bool Close();
+            virtual void Interrupt();
+            virtual void Release();
+            virtual bool Readable() { return this->data != nullptr; }
+            virtual bool Writable() { return false; }
+            virtual PositionType Read(void* buffer, PositionType readBytes);
+            virtual PositionType Write(void* buffer, PositionType writeBytes);
+            virtual bool SetPosition(PositionType position);
+            virtual PositionType Position();
+            virtual bool Eof();
+            virtual long Length();
+            virtual bool Seekable();
+            virtual const char* Type();
+            virtual const char* Uri();
+            virtual bool CanPrefetch() { return true; }
+
+            /* IDataStreamView */
+            virtual PositionType View(const void** data, PositionType maxBytes);
+
+            /* the whole file, for callers in core that can use it in place.
+            valid until Close() */
+            const char* Data() const { return this->data; }
+
+        private:
+            void AdviseReadAhead();
+
+            std::string extension;
+            std::string uri;
+            const char* data;
+            long filesize;
+            long position;
+            long adviseAt;
+#ifdef WIN32
+            void* mapping;
+#endif
+    };
+
+} } }
@@ -48,6 +48,7 @@
 #include <core/support/Common.h>
 #include <core/support/Preferences.h>
 #include <core/support/PreferenceKeys.h>
+#include <core/support/ThreadPriority.h>
 #include <core/sdk/IAnalyzer.h>
 #include <core/sdk/IIndexerSource.h>
 #include <core/audio/Stream.h>
@@ -566,6 +567,8 @@ ScanResult Indexer::SyncSource(
 }
 
 void Indexer::ThreadLoop() {
+    threads::Configure(threads::Role::Indexer);
+
     boost::filesystem::path thumbPath(this->libraryPath + "thumbs/");
 
     if (!boost::filesystem::exists(thumbPath)) {
@@ -603,7 +606,10 @@ void Indexer::ThreadLoop() {
         /* initialize the thread pool -- we'll use this to index tracks in parallel. */
         int threadCount = prefs->GetInt(prefs::keys::MaxTagReadThreads, MAX_THREADS);
         for (int i = 0; i < threadCount; i++) {
-            threadPool.create_thread(boost::bind(&boost::asio::io_service::run, &io));
+            threadPool.create_thread([&io] {
+                threads::Configure(threads::Role::Indexer);
+                io.run();
+            });
         }
 
         this->Synchronize(context, &io);
@@ -40,6 +40,7 @@
 #include <core/support/Common.h>
 #include <core/support/Preferences.h>
 #include <core/library/Indexer.h>
+#include <core/audio/SeekIndexCache.h>
 #include <core/runtime/Message.h>
 #include <core/debug.h>
 
@@ -87,6 +88,8 @@ LocalLibrary::LocalLibrary(std::string name,int id)
     this->db.Open(this->GetDatabaseFilename().c_str());
     LocalLibrary::CreateDatabase(this->db);
 
+    audio::SeekIndexCache::Instance().SetDatabase(this->GetDatabaseFilename());
+
     this->indexer = new core::Indexer(
         this->GetLibraryDirectory(),
         this->GetDatabaseFilename());
@@ -571,6 +574,13 @@ void LocalLibrary::CreateDatabase(db::Connection &db){
             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
             "track_id INTEGER)");
 
+    /* decoder seek indexes, see audio::SeekIndexCache */
+    db.Execute(
+        "CREATE TABLE IF NOT EXISTS seek_indexes ( "
+            "uri TEXT PRIMARY KEY, "
+            "filesize INTEGER DEFAULT 0, "
+            "points TEXT DEFAULT '')");
+
     /* upgrade playlist tracks table */
     if (lastVersion == 1) {
         upgradeV1toV2(db);
@@ -54,7 +54,7 @@
  * version
  */
 
-static const int mcsdk_version = 18;
+static const int mcsdk_version = 19;
 
 /*
  * constants
@@ -139,7 +139,8 @@ typedef enum mcsdk_replay_gain_mode {
 
 typedef enum mcsdk_transport_type {
     mcsdk_transport_type_gapless = 0,
-    mcsdk_transport_type_crossfade = 1
+    mcsdk_transport_type_crossfade = 1,
+    mcsdk_transport_type_mixing = 2
 } mcsdk_transport_type;
 
 typedef enum mcsdk_stream_open_flags {
@@ -150,7 +151,8 @@ typedef enum mcsdk_stream_open_flags {
 
 typedef enum mcsdk_audio_stream_flags {
     mcsdk_audio_stream_flags_none = 0,
-    mcsdk_audio_stream_flags_no_dsp = 1
+    mcsdk_audio_stream_flags_no_dsp = 1,
+    mcsdk_audio_stream_flags_decode_ahead = 2
 } mcsdk_audio_stream_flags;
 
 typedef enum mcsdk_resource_class {
@@ -182,6 +184,8 @@ static const size_t mcsdk_equalizer_bands[] = {
     2093, 2960, 4186, 5920, 8372, 11840, 16744, 22000
 };
 
+static const size_t mcsdk_playback_histogram_bucket_count = 24;
+
 static const int mcsdk_no_offset = 0;
 static const int mcsdk_no_limit = -1;
 
@@ -281,6 +285,32 @@ typedef struct mcsdk_audio_player_gain {
     float peakValid;
 } mcsdk_audio_player_gain;
 
+/* bucket 0 counts zeros, bucket n counts values in [2^(n-1), 2^n). the
+last bucket also counts anything larger. */
+typedef struct mcsdk_playback_histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[24]; /* mcsdk_playback_histogram_bucket_count */
+} mcsdk_playback_histogram;
+
+/* id 0 is the process-wide total. times are microseconds, queue depths
+are buffer counts. */
+typedef struct mcsdk_playback_metrics {
+    uint64_t id;
+    uint64_t buffers_decoded;
+    uint64_t buffers_played;
+    uint64_t starved;
+    uint64_t output_underruns;
+    uint64_t transitions;
+    mcsdk_playback_histogram decode_micros;
+    mcsdk_playback_histogram dsp_micros;
+    mcsdk_playback_histogram output_micros;
+    mcsdk_playback_histogram decode_queue_depth;
+    mcsdk_playback_histogram output_queue_depth;
+    mcsdk_playback_histogram transition_gap_micros;
+} mcsdk_playback_metrics;
+
 typedef bool (*mcsdk_svc_library_run_query_callback)(mcsdk_svc_library l, mcsdk_db_connection db, void* user_context);
 
 typedef bool (*mcsdk_audio_buffer_provider_processed_callback)(mcsdk_audio_buffer buffer);
@@ -451,6 +481,7 @@ mcsdk_export mcsdk_time_change_mode mcsdk_svc_playback_get_time_change_mode(mcsd
 mcsdk_export void mcsdk_svc_playback_set_time_change_mode(mcsdk_svc_playback pb, mcsdk_time_change_mode mode);
 mcsdk_export void mcsdk_svc_playback_reload_output(mcsdk_svc_playback pb);
 mcsdk_export mcsdk_track_list mcsdk_svc_playback_clone(mcsdk_svc_playback pb);
+mcsdk_export size_t mcsdk_svc_playback_get_metrics(mcsdk_svc_playback pb, mcsdk_playback_metrics* target, size_t count);
 
 /*
  * IPreferences
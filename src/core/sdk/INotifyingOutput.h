@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "IOutput.h"
+
+namespace musik { namespace core { namespace sdk {
+
+    class IOutputReadyListener {
+        public:
+            virtual void OnOutputReady() = 0;
+    };
+
+    /* an IOutput that can tell its callers exactly when it's able to accept
+    more data. the contract for IOutput::Play() return values is:
+
+      - OutputBufferFull: the output is holding at least one buffer from this
+        provider, and will call IBufferProvider::OnBufferProcessed() when it's
+        done with it. callers should wait for that instead of polling.
+      - a positive value: the output has no way of knowing when it will have
+        capacity, and the caller should try again in that many milliseconds.
+
+    outputs that implement this interface may do better in both cases: after
+    Play() fails, callers register with NotifyWhenReady(), and the output calls
+    OnOutputReady() once, as soon as it has room. */
+    class INotifyingOutput : public IOutput {
+        public:
+            /* returns false if the output has capacity right now, in which case
+            the listener will not be called and the caller should retry. */
+            virtual bool NotifyWhenReady(IOutputReadyListener* listener) = 0;
+
+            /* once this returns the listener will not be called (again). */
+            virtual void CancelNotify(IOutputReadyListener* listener) = 0;
+    };
+
+} } }
@@ -38,6 +38,7 @@
 #include "ITrack.h"
 #include "ITrackList.h"
 #include "ITrackListEditor.h"
+#include "PlaybackMetrics.h"
 
 namespace musik { namespace core { namespace sdk {
 
@@ -89,6 +90,11 @@ namespace musik { namespace core { namespace sdk {
             /* sdk v13 */
             virtual void ReloadOutput() = 0;
             virtual ITrackList* Clone() = 0;
+
+            /* sdk v19 */
+            /* writes the process-wide totals followed by one entry per live
+            stream, up to 'count'. returns the number of entries available. */
+            virtual size_t GetPlaybackMetrics(PlaybackMetrics* target, size_t count) = 0;
     };
 
 } } }
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+namespace musik { namespace core { namespace sdk {
+
+    /* a power-of-two histogram. bucket 0 counts zeros, and bucket n counts
+    values in [2^(n-1), 2^n); the last bucket also counts anything larger. */
+    struct PlaybackHistogram {
+        static const int BucketCount = 24;
+
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        uint64_t buckets[BucketCount];
+    };
+
+    /* a snapshot of playback pipeline health, for a single stream or (if
+    'id' is 0) for everything played since startup. times are microseconds,
+    queue depths are buffer counts. */
+    struct PlaybackMetrics {
+        uint64_t id;
+        uint64_t buffersDecoded;
+        uint64_t buffersPlayed;
+        uint64_t starved;           /* nothing ready for the output mid-stream */
+        uint64_t outputUnderruns;   /* only for outputs implementing IOutputDiagnostics */
+        uint64_t transitions;       /* gapless handoffs into this stream */
+        PlaybackHistogram decodeMicros;
+        PlaybackHistogram dspMicros;
+        PlaybackHistogram outputMicros;         /* time spent in IOutput::Play() */
+        PlaybackHistogram decodeQueueDepth;     /* decoded buffers waiting, decode-ahead only */
+        PlaybackHistogram outputQueueDepth;     /* buffers handed to the output */
+        PlaybackHistogram transitionGapMicros;  /* silence before the stream started */
+    };
+
+} } }
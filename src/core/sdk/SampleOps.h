@@ -0,0 +1,916 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+
+/* vectorized implementations of the per-sample loops that run for every
+buffer: volume/gain, integer to/from float conversion, (de)interleaving,
+window functions, and the dot products at the heart of FIR filters.
+header-only so plugins can use it without linking against core. the best
+implementation supported by the host cpu is selected the first time any of
+these functions is called. */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MCSDK_SAMPLEOPS_SSE2 1
+    #include <emmintrin.h>
+    #if defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__)
+        #define MCSDK_SAMPLEOPS_AVX2 1
+        #include <immintrin.h>
+        #if defined(_MSC_VER) && !defined(__clang__)
+            #include <intrin.h>
+            #define MCSDK_SAMPLEOPS_AVX2_TARGET
+        #else
+            #define MCSDK_SAMPLEOPS_AVX2_TARGET __attribute__((target("avx2")))
+        #endif
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define MCSDK_SAMPLEOPS_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace musik { namespace core { namespace sdk { namespace sampleops {
+
+    namespace detail {
+        static const float S16_SCALE = 1.0f / 32768.0f;
+        static const float S24_SCALE = 1.0f / 8388608.0f;
+
+        /* scalar; used for tails, and if no vector unit is available */
+
+        inline void ScaleScalar(float* samples, long count, float gain) {
+            for (long i = 0; i < count; i++) {
+                samples[i] *= gain;
+            }
+        }
+
+        inline void ScaleAndClipScalar(float* samples, long count, float gain) {
+            for (long i = 0; i < count; i++) {
+                samples[i] = std::max(-1.0f, std::min(1.0f, samples[i] * gain));
+            }
+        }
+
+        inline void S16ToF32Scalar(const int16_t* src, float* dst, long count) {
+            for (long i = 0; i < count; i++) {
+                dst[i] = (float) src[i] * S16_SCALE;
+            }
+        }
+
+        inline void S32ToF32Scalar(const int32_t* src, float* dst, long count, float scale) {
+            for (long i = 0; i < count; i++) {
+                dst[i] = (float) src[i] * scale;
+            }
+        }
+
+        inline void Interleave2Scalar(const float* l, const float* r, float* dst, long frames) {
+            for (long i = 0; i < frames; i++) {
+                dst[0] = l[i];
+                dst[1] = r[i];
+                dst += 2;
+            }
+        }
+
+        inline void InterleaveS32x2Scalar(
+            const int32_t* l, const int32_t* r, float* dst, long frames, float scale)
+        {
+            for (long i = 0; i < frames; i++) {
+                dst[0] = (float) l[i] * scale;
+                dst[1] = (float) r[i] * scale;
+                dst += 2;
+            }
+        }
+
+        inline void Deinterleave2Scalar(const float* src, float* l, float* r, long frames) {
+            for (long i = 0; i < frames; i++) {
+                l[i] = src[0];
+                r[i] = src[1];
+                src += 2;
+            }
+        }
+
+        inline void MultiplyScalar(const float* a, const float* b, float* dst, long count) {
+            for (long i = 0; i < count; i++) {
+                dst[i] = a[i] * b[i];
+            }
+        }
+
+        inline float DotProductScalar(const float* a, const float* b, long count) {
+            float sum = 0.0f;
+            for (long i = 0; i < count; i++) {
+                sum += a[i] * b[i];
+            }
+            return sum;
+        }
+
+        inline void ScaleAddScalar(const float* src, float* dst, long count, float gain) {
+            for (long i = 0; i < count; i++) {
+                dst[i] += src[i] * gain;
+            }
+        }
+
+        inline void MaxAbsScalar(const float* src, float* dst, long count) {
+            for (long i = 0; i < count; i++) {
+                dst[i] = std::max(dst[i], std::fabs(src[i]));
+            }
+        }
+
+        /* float to integer. 'dither' is null, or the state of one xorshift32
+        generator per vector lane; the difference of two uniform values gives
+        triangular noise of +/- 1 lsb. */
+
+        inline float UniformScalar(uint32_t& x) { /* [0, 1) */
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            return (float) (x >> 8) * (1.0f / 16777216.0f);
+        }
+
+        inline float IntScale(int bits) {
+            return (float) (1u << (bits - 1));
+        }
+
+        inline float IntMax(int bits) {
+            /* INT32_MAX isn't representable, and would overflow when rounded */
+            return bits >= 32 ? 2147483520.0f : IntScale(bits) - 1.0f;
+        }
+
+        inline void F32ToS32Scalar(const float* src, int32_t* dst, long count, int bits, uint32_t* dither) {
+            const float scale = IntScale(bits), hi = IntMax(bits);
+            for (long i = 0; i < count; i++) {
+                float v = src[i] * scale;
+                if (dither) {
+                    v += UniformScalar(dither[0]) - UniformScalar(dither[0]);
+                }
+                dst[i] = (int32_t) lrintf(std::max(-scale, std::min(hi, v)));
+            }
+        }
+
+        inline void F32ToS16Scalar(const float* src, int16_t* dst, long count, uint32_t* dither) {
+            for (long i = 0; i < count; i++) {
+                float v = src[i] * 32768.0f;
+                if (dither) {
+                    v += UniformScalar(dither[0]) - UniformScalar(dither[0]);
+                }
+                dst[i] = (int16_t) lrintf(std::max(-32768.0f, std::min(32767.0f, v)));
+            }
+        }
+
+#ifdef MCSDK_SAMPLEOPS_SSE2
+        inline void ScaleSse2(float* samples, long count, float gain) {
+            const __m128 g = _mm_set1_ps(gain);
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+            }
+            ScaleScalar(samples + i, count - i, gain);
+        }
+
+        inline void ScaleAndClipSse2(float* samples, long count, float gain) {
+            const __m128 g = _mm_set1_ps(gain);
+            const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 v = _mm_mul_ps(_mm_loadu_ps(samples + i), g);
+                _mm_storeu_ps(samples + i, _mm_max_ps(lo, _mm_min_ps(hi, v)));
+            }
+            ScaleAndClipScalar(samples + i, count - i, gain);
+        }
+
+        inline void S16ToF32Sse2(const int16_t* src, float* dst, long count) {
+            const __m128 s = _mm_set1_ps(S16_SCALE);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+                /* sign extend by unpacking into the high half, then shifting down */
+                const __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                const __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), s));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), s));
+            }
+            S16ToF32Scalar(src + i, dst + i, count - i);
+        }
+
+        inline void S32ToF32Sse2(const int32_t* src, float* dst, long count, float scale) {
+            const __m128 s = _mm_set1_ps(scale);
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), s));
+            }
+            S32ToF32Scalar(src + i, dst + i, count - i, scale);
+        }
+
+        inline void Interleave2Sse2(const float* l, const float* r, float* dst, long frames) {
+            long i = 0;
+            for (; i + 4 <= frames; i += 4) {
+                const __m128 a = _mm_loadu_ps(l + i), b = _mm_loadu_ps(r + i);
+                _mm_storeu_ps(dst + (i * 2), _mm_unpacklo_ps(a, b));
+                _mm_storeu_ps(dst + (i * 2) + 4, _mm_unpackhi_ps(a, b));
+            }
+            Interleave2Scalar(l + i, r + i, dst + (i * 2), frames - i);
+        }
+
+        inline void InterleaveS32x2Sse2(
+            const int32_t* l, const int32_t* r, float* dst, long frames, float scale)
+        {
+            const __m128 s = _mm_set1_ps(scale);
+            long i = 0;
+            for (; i + 4 <= frames; i += 4) {
+                const __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (l + i))), s);
+                const __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (r + i))), s);
+                _mm_storeu_ps(dst + (i * 2), _mm_unpacklo_ps(a, b));
+                _mm_storeu_ps(dst + (i * 2) + 4, _mm_unpackhi_ps(a, b));
+            }
+            InterleaveS32x2Scalar(l + i, r + i, dst + (i * 2), frames - i, scale);
+        }
+
+        inline void Deinterleave2Sse2(const float* src, float* l, float* r, long frames) {
+            long i = 0;
+            for (; i + 4 <= frames; i += 4) {
+                const __m128 a = _mm_loadu_ps(src + (i * 2));
+                const __m128 b = _mm_loadu_ps(src + (i * 2) + 4);
+                _mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+            Deinterleave2Scalar(src + (i * 2), l + i, r + i, frames - i);
+        }
+
+        inline void MultiplySse2(const float* a, const float* b, float* dst, long count) {
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            }
+            MultiplyScalar(a + i, b + i, dst + i, count - i);
+        }
+
+        inline float DotProductSse2(const float* a, const float* b, long count) {
+            __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+                sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+            }
+            sum0 = _mm_add_ps(sum0, sum1);
+            sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+            sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+            return _mm_cvtss_f32(sum0) + DotProductScalar(a + i, b + i, count - i);
+        }
+
+        inline void ScaleAddSse2(const float* src, float* dst, long count, float gain) {
+            const __m128 g = _mm_set1_ps(gain);
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const __m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+                _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), v));
+            }
+            ScaleAddScalar(src + i, dst + i, count - i, gain);
+        }
+
+        inline void MaxAbsSse2(const float* src, float* dst, long count) {
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const __m128 v = _mm_andnot_ps(sign, _mm_loadu_ps(src + i));
+                _mm_storeu_ps(dst + i, _mm_max_ps(_mm_loadu_ps(dst + i), v));
+            }
+            MaxAbsScalar(src + i, dst + i, count - i);
+        }
+
+        inline __m128 UniformSse2(__m128i& x) {
+            x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+            x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+            return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+        }
+
+        inline void F32ToS32Sse2(const float* src, int32_t* dst, long count, int bits, uint32_t* dither) {
+            const __m128 s = _mm_set1_ps(IntScale(bits));
+            const __m128 lo = _mm_set1_ps(-IntScale(bits)), hi = _mm_set1_ps(IntMax(bits));
+            __m128i x = dither ? _mm_loadu_si128((const __m128i*) dither) : _mm_setzero_si128();
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), s);
+                if (dither) {
+                    v = _mm_add_ps(v, _mm_sub_ps(UniformSse2(x), UniformSse2(x)));
+                }
+                v = _mm_max_ps(lo, _mm_min_ps(hi, v));
+                _mm_storeu_si128((__m128i*) (dst + i), _mm_cvtps_epi32(v));
+            }
+            if (dither) {
+                _mm_storeu_si128((__m128i*) dither, x);
+            }
+            F32ToS32Scalar(src + i, dst + i, count - i, bits, dither);
+        }
+
+        inline void F32ToS16Sse2(const float* src, int16_t* dst, long count, uint32_t* dither) {
+            const __m128 s = _mm_set1_ps(32768.0f);
+            __m128i x = dither ? _mm_loadu_si128((const __m128i*) dither) : _mm_setzero_si128();
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), s);
+                __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), s);
+                if (dither) {
+                    a = _mm_add_ps(a, _mm_sub_ps(UniformSse2(x), UniformSse2(x)));
+                    b = _mm_add_ps(b, _mm_sub_ps(UniformSse2(x), UniformSse2(x)));
+                }
+                /* packs saturates, so no need to clip first */
+                const __m128i v = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+                _mm_storeu_si128((__m128i*) (dst + i), v);
+            }
+            if (dither) {
+                _mm_storeu_si128((__m128i*) dither, x);
+            }
+            F32ToS16Scalar(src + i, dst + i, count - i, dither);
+        }
+#endif
+
+#ifdef MCSDK_SAMPLEOPS_AVX2
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void ScaleAvx2(float* samples, long count, float gain) {
+            const __m256 g = _mm256_set1_ps(gain);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), g));
+            }
+            ScaleScalar(samples + i, count - i, gain);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void ScaleAndClipAvx2(float* samples, long count, float gain) {
+            const __m256 g = _mm256_set1_ps(gain);
+            const __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 v = _mm256_mul_ps(_mm256_loadu_ps(samples + i), g);
+                _mm256_storeu_ps(samples + i, _mm256_max_ps(lo, _mm256_min_ps(hi, v)));
+            }
+            ScaleAndClipScalar(samples + i, count - i, gain);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void S16ToF32Avx2(const int16_t* src, float* dst, long count) {
+            const __m256 s = _mm256_set1_ps(S16_SCALE);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+                const __m256i w = _mm256_cvtepi16_epi32(v);
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(w), s));
+            }
+            S16ToF32Scalar(src + i, dst + i, count - i);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void S32ToF32Avx2(const int32_t* src, float* dst, long count, float scale) {
+            const __m256 s = _mm256_set1_ps(scale);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m256i v = _mm256_loadu_si256((const __m256i*) (src + i));
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), s));
+            }
+            S32ToF32Scalar(src + i, dst + i, count - i, scale);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void MultiplyAvx2(const float* a, const float* b, float* dst, long count) {
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            }
+            MultiplyScalar(a + i, b + i, dst + i, count - i);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline float DotProductAvx2(const float* a, const float* b, long count) {
+            __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+            long i = 0;
+            for (; i + 16 <= count; i += 16) {
+                sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+                sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+            }
+            sum0 = _mm256_add_ps(sum0, sum1);
+            __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+            return _mm_cvtss_f32(sum) + DotProductScalar(a + i, b + i, count - i);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void ScaleAddAvx2(const float* src, float* dst, long count, float gain) {
+            const __m256 g = _mm256_set1_ps(gain);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + i), g);
+                _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), v));
+            }
+            ScaleAddScalar(src + i, dst + i, count - i, gain);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void MaxAbsAvx2(const float* src, float* dst, long count) {
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m256 v = _mm256_andnot_ps(sign, _mm256_loadu_ps(src + i));
+                _mm256_storeu_ps(dst + i, _mm256_max_ps(_mm256_loadu_ps(dst + i), v));
+            }
+            MaxAbsScalar(src + i, dst + i, count - i);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline __m256 UniformAvx2(__m256i& x) {
+            x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+            x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void F32ToS32Avx2(const float* src, int32_t* dst, long count, int bits, uint32_t* dither) {
+            const __m256 s = _mm256_set1_ps(IntScale(bits));
+            const __m256 lo = _mm256_set1_ps(-IntScale(bits)), hi = _mm256_set1_ps(IntMax(bits));
+            __m256i x = dither ? _mm256_loadu_si256((const __m256i*) dither) : _mm256_setzero_si256();
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + i), s);
+                if (dither) {
+                    v = _mm256_add_ps(v, _mm256_sub_ps(UniformAvx2(x), UniformAvx2(x)));
+                }
+                v = _mm256_max_ps(lo, _mm256_min_ps(hi, v));
+                _mm256_storeu_si256((__m256i*) (dst + i), _mm256_cvtps_epi32(v));
+            }
+            if (dither) {
+                _mm256_storeu_si256((__m256i*) dither, x);
+            }
+            F32ToS32Scalar(src + i, dst + i, count - i, bits, dither);
+        }
+
+        MCSDK_SAMPLEOPS_AVX2_TARGET
+        inline void F32ToS16Avx2(const float* src, int16_t* dst, long count, uint32_t* dither) {
+            const __m256 s = _mm256_set1_ps(32768.0f);
+            __m256i x = dither ? _mm256_loadu_si256((const __m256i*) dither) : _mm256_setzero_si256();
+            long i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), s);
+                __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), s);
+                if (dither) {
+                    a = _mm256_add_ps(a, _mm256_sub_ps(UniformAvx2(x), UniformAvx2(x)));
+                    b = _mm256_add_ps(b, _mm256_sub_ps(UniformAvx2(x), UniformAvx2(x)));
+                }
+                /* packs works within 128-bit lanes; put the halves back in order */
+                __m256i v = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+                v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256((__m256i*) (dst + i), v);
+            }
+            if (dither) {
+                _mm256_storeu_si256((__m256i*) dither, x);
+            }
+            F32ToS16Scalar(src + i, dst + i, count - i, dither);
+        }
+#endif
+
+#ifdef MCSDK_SAMPLEOPS_NEON
+        inline void ScaleNeon(float* samples, long count, float gain) {
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                vst1q_f32(samples + i, vmulq_n_f32(vld1q_f32(samples + i), gain));
+            }
+            ScaleScalar(samples + i, count - i, gain);
+        }
+
+        inline void ScaleAndClipNeon(float* samples, long count, float gain) {
+            const float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                float32x4_t v = vmulq_n_f32(vld1q_f32(samples + i), gain);
+                vst1q_f32(samples + i, vmaxq_f32(lo, vminq_f32(hi, v)));
+            }
+            ScaleAndClipScalar(samples + i, count - i, gain);
+        }
+
+        inline void S16ToF32Neon(const int16_t* src, float* dst, long count) {
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const int16x8_t v = vld1q_s16(src + i);
+                const float32x4_t a = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+                const float32x4_t b = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+                vst1q_f32(dst + i, vmulq_n_f32(a, S16_SCALE));
+                vst1q_f32(dst + i + 4, vmulq_n_f32(b, S16_SCALE));
+            }
+            S16ToF32Scalar(src + i, dst + i, count - i);
+        }
+
+        inline void S32ToF32Neon(const int32_t* src, float* dst, long count, float scale) {
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), scale));
+            }
+            S32ToF32Scalar(src + i, dst + i, count - i, scale);
+        }
+
+        inline void Interleave2Neon(const float* l, const float* r, float* dst, long frames) {
+            long i = 0;
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x2_t v;
+                v.val[0] = vld1q_f32(l + i);
+                v.val[1] = vld1q_f32(r + i);
+                vst2q_f32(dst + (i * 2), v);
+            }
+            Interleave2Scalar(l + i, r + i, dst + (i * 2), frames - i);
+        }
+
+        inline void InterleaveS32x2Neon(
+            const int32_t* l, const int32_t* r, float* dst, long frames, float scale)
+        {
+            long i = 0;
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x2_t v;
+                v.val[0] = vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(l + i)), scale);
+                v.val[1] = vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(r + i)), scale);
+                vst2q_f32(dst + (i * 2), v);
+            }
+            InterleaveS32x2Scalar(l + i, r + i, dst + (i * 2), frames - i, scale);
+        }
+
+        inline void Deinterleave2Neon(const float* src, float* l, float* r, long frames) {
+            long i = 0;
+            for (; i + 4 <= frames; i += 4) {
+                const float32x4x2_t v = vld2q_f32(src + (i * 2));
+                vst1q_f32(l + i, v.val[0]);
+                vst1q_f32(r + i, v.val[1]);
+            }
+            Deinterleave2Scalar(src + (i * 2), l + i, r + i, frames - i);
+        }
+
+        inline void MultiplyNeon(const float* a, const float* b, float* dst, long count) {
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                vst1q_f32(dst + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+            }
+            MultiplyScalar(a + i, b + i, dst + i, count - i);
+        }
+
+        inline float DotProductNeon(const float* a, const float* b, long count) {
+            float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = vdupq_n_f32(0.0f);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+                sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+            }
+            sum0 = vaddq_f32(sum0, sum1);
+            float32x2_t sum = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+            return vget_lane_f32(vpadd_f32(sum, sum), 0) + DotProductScalar(a + i, b + i, count - i);
+        }
+
+        inline void ScaleAddNeon(const float* src, float* dst, long count, float gain) {
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+            }
+            ScaleAddScalar(src + i, dst + i, count - i, gain);
+        }
+
+        inline void MaxAbsNeon(const float* src, float* dst, long count) {
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                vst1q_f32(dst + i, vmaxq_f32(vld1q_f32(dst + i), vabsq_f32(vld1q_f32(src + i))));
+            }
+            MaxAbsScalar(src + i, dst + i, count - i);
+        }
+
+        inline float32x4_t UniformNeon(uint32x4_t& x) {
+            x = veorq_u32(x, vshlq_n_u32(x, 13));
+            x = veorq_u32(x, vshrq_n_u32(x, 17));
+            x = veorq_u32(x, vshlq_n_u32(x, 5));
+            return vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(x, 8)), 1.0f / 16777216.0f);
+        }
+
+        inline int32x4_t RoundNeon(float32x4_t v) {
+            /* armv7 can only truncate, so round half away from zero */
+            const float32x4_t half = vbslq_f32(
+                vcltq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+            return vcvtq_s32_f32(vaddq_f32(v, half));
+        }
+
+        inline void F32ToS32Neon(const float* src, int32_t* dst, long count, int bits, uint32_t* dither) {
+            const float32x4_t lo = vdupq_n_f32(-IntScale(bits)), hi = vdupq_n_f32(IntMax(bits));
+            const float scale = IntScale(bits);
+            uint32x4_t x = dither ? vld1q_u32(dither) : vdupq_n_u32(0);
+            long i = 0;
+            for (; i + 4 <= count; i += 4) {
+                float32x4_t v = vmulq_n_f32(vld1q_f32(src + i), scale);
+                if (dither) {
+                    v = vaddq_f32(v, vsubq_f32(UniformNeon(x), UniformNeon(x)));
+                }
+                vst1q_s32(dst + i, RoundNeon(vmaxq_f32(lo, vminq_f32(hi, v))));
+            }
+            if (dither) {
+                vst1q_u32(dither, x);
+            }
+            F32ToS32Scalar(src + i, dst + i, count - i, bits, dither);
+        }
+
+        inline void F32ToS16Neon(const float* src, int16_t* dst, long count, uint32_t* dither) {
+            uint32x4_t x = dither ? vld1q_u32(dither) : vdupq_n_u32(0);
+            long i = 0;
+            for (; i + 8 <= count; i += 8) {
+                float32x4_t a = vmulq_n_f32(vld1q_f32(src + i), 32768.0f);
+                float32x4_t b = vmulq_n_f32(vld1q_f32(src + i + 4), 32768.0f);
+                if (dither) {
+                    a = vaddq_f32(a, vsubq_f32(UniformNeon(x), UniformNeon(x)));
+                    b = vaddq_f32(b, vsubq_f32(UniformNeon(x), UniformNeon(x)));
+                }
+                /* vqmovn saturates, so no need to clip first */
+                vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(RoundNeon(a)), vqmovn_s32(RoundNeon(b))));
+            }
+            if (dither) {
+                vst1q_u32(dither, x);
+            }
+            F32ToS16Scalar(src + i, dst + i, count - i, dither);
+        }
+#endif
+
+        struct Kernels {
+            const char* name;
+            void (*scale)(float*, long, float);
+            void (*scaleAndClip)(float*, long, float);
+            void (*s16ToF32)(const int16_t*, float*, long);
+            void (*s32ToF32)(const int32_t*, float*, long, float);
+            void (*interleave2)(const float*, const float*, float*, long);
+            void (*interleaveS32x2)(const int32_t*, const int32_t*, float*, long, float);
+            void (*deinterleave2)(const float*, float*, float*, long);
+            void (*multiply)(const float*, const float*, float*, long);
+            float (*dotProduct)(const float*, const float*, long);
+            void (*scaleAdd)(const float*, float*, long, float);
+            void (*maxAbs)(const float*, float*, long);
+            void (*f32ToS32)(const float*, int32_t*, long, int, uint32_t*);
+            void (*f32ToS16)(const float*, int16_t*, long, uint32_t*);
+        };
+
+        inline bool HasAvx2() {
+#if defined(MCSDK_SAMPLEOPS_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+                return false; /* the os doesn't save ymm registers */
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#elif defined(MCSDK_SAMPLEOPS_AVX2)
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#else
+            return false;
+#endif
+        }
+
+        inline const Kernels& Select() {
+#if defined(MCSDK_SAMPLEOPS_SSE2)
+            static const Kernels sse2 = {
+                "sse2",
+                ScaleSse2, ScaleAndClipSse2, S16ToF32Sse2, S32ToF32Sse2,
+                Interleave2Sse2, InterleaveS32x2Sse2, Deinterleave2Sse2,
+                MultiplySse2, DotProductSse2,
+                ScaleAddSse2, MaxAbsSse2, F32ToS32Sse2, F32ToS16Sse2
+            };
+    #if defined(MCSDK_SAMPLEOPS_AVX2)
+            /* (de)interleaving crosses 128-bit lanes, sse2 is as good as it gets */
+            static const Kernels avx2 = {
+                "avx2",
+                ScaleAvx2, ScaleAndClipAvx2, S16ToF32Avx2, S32ToF32Avx2,
+                Interleave2Sse2, InterleaveS32x2Sse2, Deinterleave2Sse2,
+                MultiplyAvx2, DotProductAvx2,
+                ScaleAddAvx2, MaxAbsAvx2, F32ToS32Avx2, F32ToS16Avx2
+            };
+            if (HasAvx2()) {
+                return avx2;
+            }
+    #endif
+            return sse2;
+#elif defined(MCSDK_SAMPLEOPS_NEON)
+            static const Kernels neon = {
+                "neon",
+                ScaleNeon, ScaleAndClipNeon, S16ToF32Neon, S32ToF32Neon,
+                Interleave2Neon, InterleaveS32x2Neon, Deinterleave2Neon,
+                MultiplyNeon, DotProductNeon,
+                ScaleAddNeon, MaxAbsNeon, F32ToS32Neon, F32ToS16Neon
+            };
+            return neon;
+#else
+            static const Kernels scalar = {
+                "scalar",
+                ScaleScalar, ScaleAndClipScalar, S16ToF32Scalar, S32ToF32Scalar,
+                Interleave2Scalar, InterleaveS32x2Scalar, Deinterleave2Scalar,
+                MultiplyScalar, DotProductScalar,
+                ScaleAddScalar, MaxAbsScalar, F32ToS32Scalar, F32ToS16Scalar
+            };
+            return scalar;
+#endif
+        }
+
+        inline const Kernels& Get() {
+            static const Kernels& kernels = Select();
+            return kernels;
+        }
+    }
+
+    /* state for the triangular dither added when reducing the word length.
+    keep one per stream of audio, so its noise isn't correlated with another's */
+    struct Dither {
+        Dither(uint32_t seed = 0x9e3779b9u) {
+            for (int i = 0; i < 8; i++) {
+                seed = seed * 1664525u + 1013904223u;
+                this->state[i] = seed | 1u; /* xorshift must never be zero */
+            }
+        }
+
+        uint32_t state[8];
+    };
+
+    /* the name of the implementation in use: "avx2", "sse2", "neon" or "scalar" */
+    inline const char* Implementation() {
+        return detail::Get().name;
+    }
+
+    /* samples[i] *= gain */
+    inline void Scale(float* samples, long count, float gain) {
+        detail::Get().scale(samples, count, gain);
+    }
+
+    /* samples[i] = clamp(samples[i] * gain, -1.0, 1.0) */
+    inline void ScaleAndClip(float* samples, long count, float gain) {
+        detail::Get().scaleAndClip(samples, count, gain);
+    }
+
+    /* signed 16-bit to [-1.0, 1.0) */
+    inline void S16ToF32(const int16_t* src, float* dst, long count) {
+        detail::Get().s16ToF32(src, dst, count);
+    }
+
+    /* packed, little-endian signed 24-bit (3 bytes per sample) to [-1.0, 1.0).
+    there's no vector path; the unaligned 3-byte stride makes it a wash. */
+    inline void S24ToF32(const uint8_t* src, float* dst, long count) {
+        for (long i = 0; i < count; i++) {
+            const int32_t value = (int32_t) (
+                ((uint32_t) src[0] << 8) |
+                ((uint32_t) src[1] << 16) |
+                ((uint32_t) src[2] << 24)) >> 8;
+            dst[i] = (float) value * detail::S24_SCALE;
+            src += 3;
+        }
+    }
+
+    /* signed 32-bit to float; dst[i] = src[i] * scale. use a scale of
+    1.0 / (1 << (bitsPerSample - 1)) for data that is not full width */
+    inline void S32ToF32(const int32_t* src, float* dst, long count, float scale) {
+        detail::Get().s32ToF32(src, dst, count, scale);
+    }
+
+    /* planar to interleaved. 'planes' is indexed by output channel, so
+    callers can re-order channels by re-ordering the pointers. */
+    inline void Interleave(const float* const* planes, int channels, long frames, float* dst) {
+        if (channels == 2) {
+            detail::Get().interleave2(planes[0], planes[1], dst, frames);
+        }
+        else if (channels == 1) {
+            std::copy(planes[0], planes[0] + frames, dst);
+        }
+        else {
+            for (long i = 0; i < frames; i++) {
+                for (int c = 0; c < channels; c++) {
+                    *dst++ = planes[c][i];
+                }
+            }
+        }
+    }
+
+    /* planar signed 32-bit to interleaved float, scaled as S32ToF32() */
+    inline void Interleave(
+        const int32_t* const* planes, int channels, long frames, float scale, float* dst)
+    {
+        if (channels == 2) {
+            detail::Get().interleaveS32x2(planes[0], planes[1], dst, frames, scale);
+        }
+        else if (channels == 1) {
+            detail::Get().s32ToF32(planes[0], dst, frames, scale);
+        }
+        else {
+            for (long i = 0; i < frames; i++) {
+                for (int c = 0; c < channels; c++) {
+                    *dst++ = (float) planes[c][i] * scale;
+                }
+            }
+        }
+    }
+
+    /* [-1.0, 1.0] to signed integers with 'bits' significant bits (16 to 32),
+    right-aligned in 32-bit words: 32 for S32, or 24 for ALSA's S24_LE. out of
+    range samples are clipped. if 'dither' is non-null, triangular noise of
+    +/- 1 lsb is added first, which is worth doing for anything under 32 bits. */
+    inline void F32ToS32(const float* src, int32_t* dst, long count, int bits, Dither* dither = nullptr) {
+        detail::Get().f32ToS32(src, dst, count, bits, dither ? dither->state : nullptr);
+    }
+
+    /* [-1.0, 1.0] to signed 16-bit, clipped, and optionally dithered */
+    inline void F32ToS16(const float* src, int16_t* dst, long count, Dither* dither = nullptr) {
+        detail::Get().f32ToS16(src, dst, count, dither ? dither->state : nullptr);
+    }
+
+    /* [-1.0, 1.0] to packed, little-endian signed 24-bit (3 bytes per sample),
+    clipped, and optionally dithered. */
+    inline void F32ToS24(const float* src, uint8_t* dst, long count, Dither* dither = nullptr) {
+        int32_t chunk[256];
+        while (count > 0) {
+            const long n = std::min(count, 256L);
+            F32ToS32(src, chunk, n, 24, dither);
+            for (long i = 0; i < n; i++) {
+                const uint32_t value = (uint32_t) chunk[i];
+                dst[0] = (uint8_t) value;
+                dst[1] = (uint8_t) (value >> 8);
+                dst[2] = (uint8_t) (value >> 16);
+                dst += 3;
+            }
+            src += n;
+            count -= n;
+        }
+    }
+
+    /* dst[i] = a[i] * b[i]; dst may be the same as a or b */
+    inline void Multiply(const float* a, const float* b, float* dst, long count) {
+        detail::Get().multiply(a, b, dst, count);
+    }
+
+    /* sum(a[i] * b[i]). the order of summation depends on the implementation,
+    so results may differ in the last few bits between machines. */
+    inline float DotProduct(const float* a, const float* b, long count) {
+        return detail::Get().dotProduct(a, b, count);
+    }
+
+    /* dst[i] += src[i] * gain; the building block of FIR filters that are
+    evaluated a tap at a time across a whole block, rather than a sample
+    at a time. */
+    inline void ScaleAdd(const float* src, float* dst, long count, float gain) {
+        detail::Get().scaleAdd(src, dst, count, gain);
+    }
+
+    /* dst[i] = max(dst[i], abs(src[i])); a running peak */
+    inline void MaxAbs(const float* src, float* dst, long count) {
+        detail::Get().maxAbs(src, dst, count);
+    }
+
+    /* interleaved to planar */
+    inline void Deinterleave(const float* src, int channels, long frames, float* const* planes) {
+        if (channels == 2) {
+            detail::Get().deinterleave2(src, planes[0], planes[1], frames);
+        }
+        else if (channels == 1) {
+            std::copy(src, src + frames, planes[0]);
+        }
+        else {
+            for (long i = 0; i < frames; i++) {
+                for (int c = 0; c < channels; c++) {
+                    planes[c][i] = *src++;
+                }
+            }
+        }
+    }
+
+} } } }
@@ -100,7 +100,8 @@ namespace musik {
 
             enum class TransportType : int {
                 Gapless = 0,
-                Crossfade = 1
+                Crossfade = 1,
+                Mixing = 2
             };
 
             enum OpenFlags {
@@ -111,7 +112,8 @@ namespace musik {
 
             enum class StreamFlags: int {
                 None = 0,
-                NoDSP = 1
+                NoDSP = 1,
+                DecodeAhead = 2
             };
 
             static const size_t EqualizerBandCount = 18;
@@ -153,5 +155,5 @@ namespace musik {
                 static const char* ExternalId = "external_id";
             }
 
-            static const int SdkVersion = 18;
+            static const int SdkVersion = 19;
 } } }
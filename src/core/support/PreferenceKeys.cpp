@@ -56,6 +56,8 @@ namespace musik { namespace core { namespace prefs {
     const std::string keys::IndexerLogEnabled = "IndexerLogEnabled";
     const std::string keys::ReplayGainMode = "ReplayGainMode";
     const std::string keys::PreampDecibels = "PreampDecibels";
+    const std::string keys::ReplayGainLimiter = "ReplayGainLimiter";
+    const std::string keys::TruePeakCeilingDecibels = "TruePeakCeilingDecibels";
     const std::string keys::SaveSessionOnExit = "SaveSessionOnExit";
     const std::string keys::LastPlayQueueIndex = "LastPlayQueueIndex";
     const std::string keys::LastPlayQueueTime = "LastPlayQueueTime";
@@ -64,6 +66,23 @@ namespace musik { namespace core { namespace prefs {
     const std::string keys::LastFmUsername = "LastFmUsername";
     const std::string keys::DisableAlbumArtistFallback = "DisableAlbumArtistFallback";
     const std::string keys::AuddioApiToken = "AuddioApiToken";
+    const std::string keys::DecodeAheadSeconds = "DecodeAheadSeconds";
+    const std::string keys::CrossfadeCurve = "CrossfadeCurve";
+    const std::string keys::MaxBufferPoolMegabytes = "MaxBufferPoolMegabytes";
+    const std::string keys::SeekPrerollSeconds = "SeekPrerollSeconds";
+    const std::string keys::SpectrumFftSize = "SpectrumFftSize";
+    const std::string keys::SpectrumOverlap = "SpectrumOverlap";
+    const std::string keys::PcmVisualizerDecimation = "PcmVisualizerDecimation";
+    const std::string keys::PcmVisualizerFps = "PcmVisualizerFps";
+    const std::string keys::GaplessLookaheadSeconds = "GaplessLookaheadSeconds";
+    const std::string keys::GaplessPrebufferSeconds = "GaplessPrebufferSeconds";
+    const std::string keys::AudioThreadScheduler = "AudioThreadScheduler";
+    const std::string keys::AudioThreadPriority = "AudioThreadPriority";
+    const std::string keys::AudioThreadCpus = "AudioThreadCpus";
+    const std::string keys::IndexerThreadCpus = "IndexerThreadCpus";
+    const std::string keys::MemoryMappedFiles = "MemoryMappedFiles";
+    const std::string keys::DecoderPoolSize = "DecoderPoolSize";
+    const std::string keys::DecoderPoolMaxFileMegabytes = "DecoderPoolMaxFileMegabytes";
 
 } } }
 
@@ -60,6 +60,8 @@ namespace musik { namespace core { namespace prefs {
         extern const std::string IndexerLogEnabled;
         extern const std::string ReplayGainMode;
         extern const std::string PreampDecibels;
+        extern const std::string ReplayGainLimiter;
+        extern const std::string TruePeakCeilingDecibels;
         extern const std::string SaveSessionOnExit;
         extern const std::string LastPlayQueueIndex;
         extern const std::string LastPlayQueueTime;
@@ -68,6 +70,23 @@ namespace musik { namespace core { namespace prefs {
         extern const std::string LastFmUsername;
         extern const std::string DisableAlbumArtistFallback;
         extern const std::string AuddioApiToken;
+        extern const std::string DecodeAheadSeconds;
+        extern const std::string CrossfadeCurve;
+        extern const std::string MaxBufferPoolMegabytes;
+        extern const std::string SeekPrerollSeconds;
+        extern const std::string SpectrumFftSize;
+        extern const std::string SpectrumOverlap;
+        extern const std::string PcmVisualizerDecimation;
+        extern const std::string PcmVisualizerFps;
+        extern const std::string GaplessLookaheadSeconds;
+        extern const std::string GaplessPrebufferSeconds;
+        extern const std::string AudioThreadScheduler;
+        extern const std::string AudioThreadPriority;
+        extern const std::string AudioThreadCpus;
+        extern const std::string IndexerThreadCpus;
+        extern const std::string MemoryMappedFiles;
+        extern const std::string DecoderPoolSize;
+        extern const std::string DecoderPoolMaxFileMegabytes;
     }
 
 } } }
@@ -0,0 +1,212 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <core/support/ThreadPriority.h>
+#include <core/support/Common.h>
+#include <core/support/Preferences.h>
+#include <core/support/PreferenceKeys.h>
+#include <core/debug.h>
+
+#include <atomic>
+
+#if !defined(WIN32) && !defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+#ifdef __FreeBSD__
+#include <sys/param.h>
+#include <sys/cpuset.h>
+#include <pthread_np.h>
+#endif
+
+#define TAG "ThreadPriority"
+#define DEFAULT_RT_PRIORITY 10
+
+using namespace musik::core;
+
+static std::atomic<bool> warnedScheduling(false);
+static std::atomic<bool> warnedAffinity(false);
+
+static void warnOnce(std::atomic<bool>& warned, const std::string& message) {
+    if (!warned.exchange(true)) {
+        musik::debug::warning(TAG, message);
+    }
+}
+
+#ifdef WIN32
+static void applyAffinity(const std::vector<int>& cpus) {
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu < (int) (sizeof(DWORD_PTR) * 8)) {
+            mask |= ((DWORD_PTR) 1 << cpu);
+        }
+    }
+
+    if (mask && !SetThreadAffinityMask(GetCurrentThread(), mask)) {
+        warnOnce(warnedAffinity, "SetThreadAffinityMask failed");
+    }
+}
+#elif defined(__linux__) || defined(__FreeBSD__)
+static void applyAffinity(const std::vector<int>& cpus) {
+#ifdef __FreeBSD__
+    cpuset_t set;
+#else
+    cpu_set_t set;
+#endif
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err) {
+        warnOnce(warnedAffinity, std::string("couldn't set cpu affinity: ") + strerror(err));
+    }
+}
+#else
+static void applyAffinity(const std::vector<int>& cpus) {
+    /* e.g. openbsd, which doesn't let us pin threads at all */
+    warnOnce(warnedAffinity, "cpu affinity isn't supported on this platform, ignoring");
+}
+#endif
+
+#if !defined(WIN32) && !defined(__APPLE__)
+static void applyScheduling(const std::string& scheduler, int priority) {
+    int policy;
+    if (scheduler == "fifo") {
+        policy = SCHED_FIFO;
+    }
+    else if (scheduler == "rr") {
+        policy = SCHED_RR;
+    }
+    else {
+        return; /* "default", or something we don't understand */
+    }
+
+    sched_param param = { 0 };
+    param.sched_priority = std::max(
+        sched_get_priority_min(policy),
+        std::min(sched_get_priority_max(policy), priority));
+
+    int err = pthread_setschedparam(pthread_self(), policy, &param);
+    if (err) {
+        warnOnce(warnedScheduling,
+            "couldn't enable real-time scheduling (" + std::string(strerror(err)) +
+            "); audio threads will run at the default priority. raise RLIMIT_RTPRIO "
+            "(e.g. via /etc/security/limits.conf) to allow it.");
+    }
+}
+#endif
+
+namespace musik { namespace core { namespace threads {
+
+    void Configure(Role role) {
+        std::string cpuList;
+
+        if (role == Role::Audio) {
+            auto prefs = Preferences::ForComponent(prefs::components::Playback);
+            cpuList = prefs->GetString(prefs::keys::AudioThreadCpus, "");
+
+#ifdef WIN32
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#elif !defined(__APPLE__)
+            applyScheduling(
+                prefs->GetString(prefs::keys::AudioThreadScheduler, "default"),
+                prefs->GetInt(prefs::keys::AudioThreadPriority, DEFAULT_RT_PRIORITY));
+#endif
+        }
+        else {
+            auto prefs = Preferences::ForComponent(prefs::components::Settings);
+            cpuList = prefs->GetString(prefs::keys::IndexerThreadCpus, "");
+        }
+
+        std::vector<int> cpus;
+        if (!ParseCpuList(cpuList, cpus)) {
+            warnOnce(warnedAffinity, "invalid cpu list '" + cpuList + "', ignoring");
+            return;
+        }
+
+#ifndef __APPLE__ /* macOS only offers affinity hints; not worth it */
+        if (cpus.size()) {
+            applyAffinity(cpus);
+        }
+#endif
+    }
+
+    bool ParseCpuList(const std::string& list, std::vector<int>& cpus) {
+        cpus.clear();
+
+        if (Trim(list).empty()) {
+            return true;
+        }
+
+        try {
+            for (auto& part : Split(list, ",")) {
+                std::string range = Trim(part);
+                size_t dash = range.find('-');
+                int first, last;
+                if (dash == std::string::npos) {
+                    first = last = std::stoi(range);
+                }
+                else {
+                    first = std::stoi(range.substr(0, dash));
+                    last = std::stoi(range.substr(dash + 1));
+                }
+
+                if (first < 0 || last < first) {
+                    cpus.clear();
+                    return false;
+                }
+
+                for (int i = first; i <= last; i++) {
+                    cpus.push_back(i);
+                }
+            }
+        }
+        catch (...) {
+            cpus.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+} } }
@@ -663,10 +663,18 @@ void SettingsLayout::LoadPreferences() {
     this->replayGainDropdown->SetText(arrow + _TSTR("settings_preamp"));
 
     /* transport type */
-    std::string transportName =
-        getTransportType() == MasterTransport::Type::Gapless
-            ? _TSTR("settings_transport_type_gapless")
-            : _TSTR("settings_transport_type_crossfade");
+    std::string transportName;
+    switch (getTransportType()) {
+        case MasterTransport::Type::Crossfade:
+            transportName = _TSTR("settings_transport_type_crossfade");
+            break;
+        case MasterTransport::Type::Mixing:
+            transportName = _TSTR("settings_transport_type_mixing");
+            break;
+        default:
+            transportName = _TSTR("settings_transport_type_gapless");
+            break;
+    }
 
     this->transportDropdown->SetText(arrow + _TSTR("settings_transport_type") + transportName);
 }
@@ -229,9 +229,10 @@ void PlaybackOverlays::ShowTransportOverlay(
     std::shared_ptr<Adapter> adapter(new Adapter());
     adapter->AddEntry(_TSTR("settings_transport_type_gapless"));
     adapter->AddEntry(_TSTR("settings_transport_type_crossfade"));
+    adapter->AddEntry(_TSTR("settings_transport_type_mixing"));
     adapter->SetSelectable(true);
 
-    size_t selectedIndex = (transportType == MasterTransport::Type::Gapless) ? 0 : 1;
+    size_t selectedIndex = (size_t) transportType;
 
     std::shared_ptr<ListOverlay> dialog(new ListOverlay());
 
@@ -240,9 +241,7 @@ void PlaybackOverlays::ShowTransportOverlay(
         .SetSelectedIndex(selectedIndex)
         .SetItemSelectedCallback(
             [callback](ListOverlay* overlay, IScrollAdapterPtr adapter, size_t index) {
-                auto result = (index == 0)
-                    ? MasterTransport::Type::Gapless
-                    : MasterTransport::Type::Crossfade;
+                auto result = (MasterTransport::Type) index;
 
                 std::string output = outputs::SelectedOutput()->Name();
 
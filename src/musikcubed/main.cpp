@@ -11,6 +11,7 @@
 #include <core/audio/MasterTransport.h>
 #include <core/debug.h>
 #include <core/library/LibraryFactory.h>
+#include <core/plugin/PluginFactory.h>
 #include <core/plugin/Plugins.h>
 #include <core/runtime/MessageQueue.h>
 #include <core/runtime/Message.h>
@@ -33,6 +34,13 @@ static const short EVENT_QUIT = 2;
 static const pid_t NOT_RUNNING = (pid_t) -1;
 static int pipeFd[2] = { 0 };
 static bool foreground = false;
+static bool transcode = false;
+static std::string transcodeFormat, transcodeDirectory;
+static int transcodeBitrate = 0;
+
+/* exported by the server plugin */
+typedef void(*DisableRemote)();
+typedef int(*TranscodeLibrary)(const char*, int, const char*, char*, int);
 
 static void printHelp();
 static void handleCommandLine(int argc, char** argv);
@@ -43,6 +51,7 @@ static void initDaemon();
 static void stopDaemon();
 static void initUtf8();
 static void run();
+static int transcodeLibrary();
 
 class EvMessageQueue: public MessageQueue {
     public:
@@ -108,6 +117,7 @@ static void printHelp() {
     std::cout << "    --foreground: start the in the foreground\n";
     std::cout << "    --stop: shut down the daemon\n";
     std::cout << "    --running: check if the daemon is running\n";
+    std::cout << "    --transcode <format> <bitrate> <directory>: transcode the library into directory\n";
     std::cout << "    --version: print the version\n";
     std::cout << "    --help: show this message\n\n";
 }
@@ -123,6 +133,13 @@ static void handleCommandLine(int argc, char** argv) {
             ::foreground = true;
             return;
         }
+        else if (command == "--transcode" && argc >= 5) {
+            ::transcode = true;
+            ::transcodeFormat = argv[2];
+            ::transcodeBitrate = atoi(argv[3]);
+            ::transcodeDirectory = argv[4];
+            return;
+        }
         else if (command == "--stop") {
             stopDaemon();
         }
@@ -250,6 +267,59 @@ static void initForeground() {
     });
 }
 
+static int transcodeLibrary() {
+    /* the daemon would be sharing the library, and the server's ports */
+    if (getDaemonPid() != NOT_RUNNING) {
+        std::cerr << "\n  musikcubed is running, stop it before transcoding\n\n";
+        return EXIT_FAILURE;
+    }
+
+    debug::Start({
+        new debug::ConsoleBackend()
+    });
+
+    MessageQueue messageQueue;
+    auto library = LibraryFactory::Default();
+    library->SetMessageQueue(messageQueue);
+
+    int failed = -1;
+    char summary[1024] = { 0 };
+
+    /* we need the server plugin's transcoder, but not its servers */
+    PluginFactory::Instance().QueryFunction<DisableRemote>(
+        "DisableRemote",
+        [](musik::core::sdk::IPlugin* plugin, DisableRemote func) {
+            func();
+        });
+
+    {
+        PlaybackService playback(messageQueue, library);
+
+        plugin::Init(&messageQueue, &playback, library);
+
+        PluginFactory::Instance().QueryFunction<TranscodeLibrary>(
+            "TranscodeLibrary",
+            [&failed, &summary](musik::core::sdk::IPlugin* plugin, TranscodeLibrary func) {
+                failed = func(
+                    transcodeFormat.c_str(),
+                    transcodeBitrate,
+                    transcodeDirectory.c_str(),
+                    summary,
+                    sizeof(summary));
+            });
+    }
+
+    plugin::Deinit();
+
+    if (failed < 0) {
+        std::cerr << "\n  transcoding failed. is the server plugin enabled?\n\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "\n  " << summary << "\n\n";
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 static void initUtf8() {
     std::locale locale = std::locale();
     std::locale utf8Locale(locale, new boost::filesystem::detail::utf8_codecvt_facet);
@@ -259,6 +329,11 @@ static void initUtf8() {
 int main(int argc, char** argv) {
     initUtf8();
     handleCommandLine(argc, argv);
+
+    if (::transcode) {
+        exit(transcodeLibrary());
+    }
+
     exitIfRunning();
 
     ::foreground ? initForeground() : initDaemon();
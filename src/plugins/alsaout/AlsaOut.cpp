@@ -36,13 +36,21 @@
 
 #include <core/sdk/constants.h>
 #include <core/sdk/IPreferences.h>
+#include <core/sdk/SampleOps.h>
+#include <algorithm>
 
 static musik::core::sdk::IPreferences* prefs;
 
 #define BUFFER_COUNT 16
-#define PCM_ACCESS_TYPE SND_PCM_ACCESS_RW_INTERLEAVED
-#define PCM_FORMAT SND_PCM_FORMAT_FLOAT_LE
+#define MMAP_WAIT_MS 100
+#define DEFAULT_LATENCY_MS 500
 #define PREF_DEVICE_ID "device_id"
+#define PREF_FIXED_SAMPLE_RATE "fixed_sample_rate"
+#define PREF_FIXED_CHANNELS "fixed_channels"
+#define PREF_SAMPLE_FORMAT "sample_format"
+#define PREF_DITHER "dither"
+#define PREF_MMAP "mmap"
+#define PREF_LATENCY_MS "latency_ms"
 
 #define LOCK(x) \
     /*std::cerr << "locking " << x << "\n";*/ \
@@ -54,10 +62,20 @@ static musik::core::sdk::IPreferences* prefs;
 #define CHECK_QUIT() if (this->quit) { return; }
 #define PRINT_ERROR(x) std::cerr << "AlsaOut: error! " << snd_strerror(x) << std::endl;
 
-#define WRITE_BUFFER(handle, context, samples) \
-    err = snd_pcm_writei(handle, context->buffer->BufferPointer(), samples); \
+#define WRITE_BUFFER(handle, buffer, format) \
+    err = (this->pcmType == SND_PCM_ACCESS_MMAP_INTERLEAVED) \
+        ? this->WriteMmap(handle, buffer, format) \
+        : this->WriteInterleaved(handle, buffer, format); \
     if (err < 0) { PRINT_ERROR(err); }
 
+static inline size_t bytesPerSample(snd_pcm_format_t format) {
+    switch (format) {
+        case SND_PCM_FORMAT_S16_LE: return 2;
+        case SND_PCM_FORMAT_S24_3LE: return 3;
+        default: return 4;
+    }
+}
+
 static inline bool playable(snd_pcm_t* pcm) {
     if (!pcm) {
         return false;
@@ -125,6 +143,12 @@ class AlsaDeviceList : public musik::core::sdk::IDeviceList {
 extern "C" void SetPreferences(musik::core::sdk::IPreferences* prefs) {
     ::prefs = prefs;
     prefs->GetString(PREF_DEVICE_ID, nullptr, 0, "");
+    prefs->GetInt(PREF_FIXED_SAMPLE_RATE, 0);
+    prefs->GetInt(PREF_FIXED_CHANNELS, 0);
+    prefs->GetString(PREF_SAMPLE_FORMAT, nullptr, 0, "auto");
+    prefs->GetBool(PREF_DITHER, true);
+    prefs->GetBool(PREF_MMAP, false);
+    prefs->GetInt(PREF_LATENCY_MS, DEFAULT_LATENCY_MS);
     prefs->Save();
 }
 
@@ -141,7 +165,14 @@ AlsaOut::AlsaOut()
 , quit(false)
 , paused(false)
 , latency(0)
-, initialized(false) {
+, initialized(false)
+, writing(false)
+, closePending(false)
+, pcmFormat(SND_PCM_FORMAT_FLOAT_LE)
+, pcmType(SND_PCM_ACCESS_RW_INTERLEAVED)
+, latencyMs(DEFAULT_LATENCY_MS)
+, ditherEnabled(true)
+, underruns(0) {
     std::cerr << "AlsaOut::AlsaOut() called" << std::endl;
     this->writeThread.reset(new boost::thread(boost::bind(&AlsaOut::WriteLoop, this)));
 }
@@ -164,6 +195,26 @@ AlsaOut::~AlsaOut() {
     std::cerr << "AlsaOut: destroyed.\n";
 }
 
+void AlsaOut::WaitForWriter(boost::recursive_mutex::scoped_lock& lock) {
+    /* the write thread uses the pcm handle without holding the lock (it
+    would otherwise block Play() for as long as the device does), so before
+    the handle can be closed we kick it out of any blocking call and wait
+    for it to let go. must be called with the lock held exactly once. */
+    if (this->writing) {
+        this->closePending = true;
+
+        if (this->pcmHandle) {
+            snd_pcm_drop(this->pcmHandle);
+        }
+
+        while (this->writing) {
+            WAIT();
+        }
+
+        this->closePending = false;
+    }
+}
+
 void AlsaOut::CloseDevice() {
     if (this->pcmHandle) {
         std::cerr << "AlsaOut: closing PCM handle\n";
@@ -181,6 +232,18 @@ bool AlsaOut::SetDefaultDevice(const char* deviceId) {
     return setDefaultDevice<IPreferences, AlsaDevice, IOutput>(prefs, this, PREF_DEVICE_ID, deviceId);
 }
 
+bool AlsaOut::GetFixedFormat(long* sampleRate, int* channels) {
+    /* off by default: the device follows the stream, so playback stays
+    bit-perfect. setting either of these has the player convert instead,
+    which avoids re-opening the device between tracks. */
+    if (prefs) {
+        *sampleRate = std::max(0, prefs->GetInt(PREF_FIXED_SAMPLE_RATE, 0));
+        *channels = std::max(0, prefs->GetInt(PREF_FIXED_CHANNELS, 0));
+        return *sampleRate > 0 || *channels > 0;
+    }
+    return false;
+}
+
 IDeviceList* AlsaOut::GetDeviceList() {
     AlsaDeviceList* result = new AlsaDeviceList();
 
@@ -228,6 +291,153 @@ std::string AlsaOut::GetPreferredDeviceId() {
     return result;
 }
 
+snd_pcm_format_t AlsaOut::NegotiateFormat() {
+    /* "auto" takes floats if the device (or plugin) will, otherwise the
+    widest integer format it supports. hw: devices usually only do the
+    latter; we do the conversion so alsa's plug layer doesn't have to. */
+    static const std::vector<std::pair<std::string, snd_pcm_format_t>> FORMATS = {
+        { "float32", SND_PCM_FORMAT_FLOAT_LE },
+        { "s32", SND_PCM_FORMAT_S32_LE },
+        { "s24", SND_PCM_FORMAT_S24_LE },
+        { "s24_3", SND_PCM_FORMAT_S24_3LE },
+        { "s16", SND_PCM_FORMAT_S16_LE },
+    };
+
+    std::string preferred = getPreferenceString<std::string>(prefs, PREF_SAMPLE_FORMAT, "auto");
+
+    for (auto& format : FORMATS) {
+        if (preferred == format.first &&
+            snd_pcm_hw_params_test_format(pcmHandle, hardware, format.second) == 0)
+        {
+            return format.second;
+        }
+    }
+
+    if (preferred.size() && preferred != "auto") {
+        std::cerr << "AlsaOut: device doesn't support " << preferred << ", negotiating\n";
+    }
+
+    for (auto& format : FORMATS) {
+        if (snd_pcm_hw_params_test_format(pcmHandle, hardware, format.second) == 0) {
+            return format.second;
+        }
+    }
+
+    return SND_PCM_FORMAT_UNKNOWN;
+}
+
+void AlsaOut::Convert(const float* src, long samples, snd_pcm_format_t format, void* dst) {
+    using namespace musik::core::sdk::sampleops;
+
+    Dither* dither = this->ditherEnabled ? &this->dither : nullptr;
+
+    switch (format) {
+        case SND_PCM_FORMAT_S16_LE:
+            F32ToS16(src, (int16_t*) dst, samples, dither);
+            break;
+        case SND_PCM_FORMAT_S24_3LE:
+            F32ToS24(src, (uint8_t*) dst, samples, dither);
+            break;
+        case SND_PCM_FORMAT_S24_LE:
+            F32ToS32(src, (int32_t*) dst, samples, 24, dither);
+            break;
+        case SND_PCM_FORMAT_S32_LE:
+            /* floats only have 24 bits of precision; nothing to dither */
+            F32ToS32(src, (int32_t*) dst, samples, 32);
+            break;
+        default:
+            std::copy(src, src + samples, (float*) dst);
+            break;
+    }
+}
+
+int AlsaOut::WriteInterleaved(snd_pcm_t* pcm, IBuffer* buffer, snd_pcm_format_t format) {
+    const void* data = buffer->BufferPointer();
+
+    if (format != SND_PCM_FORMAT_FLOAT_LE) {
+        this->converted.resize(buffer->Samples() * bytesPerSample(format));
+        this->Convert(buffer->BufferPointer(), buffer->Samples(), format, this->converted.data());
+        data = this->converted.data();
+    }
+
+    return (int) snd_pcm_writei(pcm, data, buffer->Samples() / buffer->Channels());
+}
+
+int AlsaOut::WriteMmap(snd_pcm_t* pcm, IBuffer* buffer, snd_pcm_format_t format) {
+    /* convert (or copy) straight into the device's ring buffer, as much
+    as it has room for at a time, waiting on its poll descriptors between
+    chunks. returns the number of frames written, or an error. */
+    const int channels = buffer->Channels();
+    const snd_pcm_uframes_t frames = buffer->Samples() / channels;
+    const float* src = buffer->BufferPointer();
+    snd_pcm_uframes_t written = 0;
+
+    while (written < frames) {
+        {
+            LOCK("mmap");
+            if (this->quit || this->closePending || this->pcmHandle != pcm) {
+                break; /* being stopped or re-opened; let CloseDevice() proceed */
+            }
+        }
+
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+
+        if (avail < 0) {
+            return (int) avail; /* xrun or suspend; the caller recovers */
+        }
+
+        if (avail == 0) {
+            /* the ring is full. mmap writes don't start the stream on their
+            own once it's been prepared, so kick it off now. */
+            if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED) {
+                int err = snd_pcm_start(pcm);
+                if (err < 0) {
+                    return err;
+                }
+            }
+
+            int err = snd_pcm_wait(pcm, MMAP_WAIT_MS);
+            if (err < 0) {
+                return err;
+            }
+
+            continue;
+        }
+
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t count = std::min((snd_pcm_uframes_t) avail, frames - written);
+
+        int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &count);
+        if (err < 0) {
+            return err;
+        }
+
+        /* interleaved, so one area describes every channel */
+        uint8_t* dst = (uint8_t*) areas[0].addr + (areas[0].first / 8) + (offset * (areas[0].step / 8));
+        this->Convert(src + (written * channels), (long) (count * channels), format, dst);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm, offset, count);
+        if (committed < 0) {
+            return (int) committed;
+        }
+
+        written += (snd_pcm_uframes_t) committed;
+
+        {
+            LOCK("mmap committed");
+            this->NotifyIfReady();
+        }
+    }
+
+    /* the last buffer of a track may not fill the ring */
+    if (written > 0 && snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED) {
+        snd_pcm_start(pcm);
+    }
+
+    return (int) written;
+}
+
 void AlsaOut::InitDevice() {
     int err, dir;
     unsigned int rate = (unsigned int) this->rate;
@@ -259,16 +469,37 @@ void AlsaOut::InitDevice() {
         goto error;
     }
 
-    if ((err = snd_pcm_hw_params_set_access(pcmHandle, hardware, PCM_ACCESS_TYPE)) < 0) {
+    /* mmap access lets us write straight into the device's ring buffer, but
+    not every plugin in the alsa graph supports it. */
+    this->pcmType = SND_PCM_ACCESS_RW_INTERLEAVED;
+    if (prefs && prefs->GetBool(PREF_MMAP, false)) {
+        if (snd_pcm_hw_params_test_access(pcmHandle, hardware, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0) {
+            this->pcmType = SND_PCM_ACCESS_MMAP_INTERLEAVED;
+        }
+        else {
+            std::cerr << "AlsaOut: device doesn't support mmap access, using read/write\n";
+        }
+    }
+
+    this->latencyMs = prefs
+        ? (unsigned int) std::max(1, prefs->GetInt(PREF_LATENCY_MS, DEFAULT_LATENCY_MS))
+        : DEFAULT_LATENCY_MS;
+
+    if ((err = snd_pcm_hw_params_set_access(pcmHandle, hardware, this->pcmType)) < 0) {
         std::cerr << "AlsaOut: cannot set access type " << snd_strerror(err) << std::endl;
         goto error;
     }
 
-    if ((err = snd_pcm_hw_params_set_format(pcmHandle, hardware, PCM_FORMAT)) < 0) {
+    this->pcmFormat = this->NegotiateFormat();
+    this->ditherEnabled = !prefs || prefs->GetBool(PREF_DITHER, true);
+
+    if ((err = snd_pcm_hw_params_set_format(pcmHandle, hardware, this->pcmFormat)) < 0) {
         std::cerr << "AlsaOut: cannot set sample format " << snd_strerror(err) << std::endl;
         goto error;
     }
 
+    std::cerr << "AlsaOut: sample format " << snd_pcm_format_name(this->pcmFormat) << std::endl;
+
     if ((err = snd_pcm_hw_params_set_rate_near(pcmHandle, hardware, &rate, 0)) < 0) {
         std::cerr << "AlsaOut: cannot set sample rate " << snd_strerror(err) << std::endl;
         goto error;
@@ -315,9 +546,8 @@ double AlsaOut::Latency() {
             snd_pcm_get_params(this->pcmHandle, &bufferSize, &periodSize);
 
             if (bufferSize) {
-                this->latency =
-                (double) bufferSize /
-                (double) (this->rate * this->channels * sizeof(float));
+                /* buffer size is in frames */
+                this->latency = (double) bufferSize / (double) this->rate;
             }
         }
     }
@@ -325,13 +555,29 @@ double AlsaOut::Latency() {
     return this->latency;
 }
 
+double AlsaOut::GetDelay() {
+    LOCK("delay");
+
+    /* frames between what we've written and what the DAC is playing */
+    snd_pcm_sframes_t frames = 0;
+    if (this->pcmHandle && this->rate && snd_pcm_delay(this->pcmHandle, &frames) == 0) {
+        return (double) std::max((snd_pcm_sframes_t) 0, frames) / (double) this->rate;
+    }
+
+    return -1.0;
+}
+
 void AlsaOut::Stop() {
     std::list<std::shared_ptr<BufferContext> > toNotify;
 
     {
         LOCK("stop");
 
+        this->WaitForWriter(lock);
+
         std::swap(this->buffers, toNotify);
+        this->bufferCounts.clear();
+        this->NotifyIfReady();
 
         if (this->pcmHandle) {
             snd_pcm_drop(this->pcmHandle);
@@ -346,6 +592,44 @@ void AlsaOut::Stop() {
     }
 }
 
+bool AlsaOut::HasCapacity() {
+    /* Play() limits each provider to BUFFER_COUNT; if that's more than we
+    have in total, whoever is asking has room. */
+    return !this->paused && this->buffers.size() < BUFFER_COUNT;
+}
+
+void AlsaOut::NotifyIfReady() {
+    /* called with the lock held; that's what lets CancelNotify() guarantee
+    a listener won't be called once it returns. */
+    if (this->readyListeners.size() && this->HasCapacity()) {
+        for (IOutputReadyListener* listener : this->readyListeners) {
+            listener->OnOutputReady();
+        }
+        this->readyListeners.clear();
+    }
+}
+
+bool AlsaOut::NotifyWhenReady(IOutputReadyListener* listener) {
+    LOCK("notify when ready");
+
+    if (this->HasCapacity()) {
+        return false;
+    }
+
+    auto& listeners = this->readyListeners;
+    if (std::find(listeners.begin(), listeners.end(), listener) == listeners.end()) {
+        listeners.push_back(listener);
+    }
+
+    return true;
+}
+
+void AlsaOut::CancelNotify(IOutputReadyListener* listener) {
+    LOCK("cancel notify");
+    auto& listeners = this->readyListeners;
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
+
 void AlsaOut::Pause() {
     LOCK("pause");
 
@@ -361,6 +645,7 @@ void AlsaOut::Resume() {
     if (this->pcmHandle) {
         snd_pcm_pause(this->pcmHandle, 0);
         this->paused = false;
+        this->NotifyIfReady();
         NOTIFY();
     }
 }
@@ -385,10 +670,12 @@ void AlsaOut::WriteLoop() {
     {
         while (!quit) {
             std::shared_ptr<BufferContext> next;
+            snd_pcm_format_t format;
+            snd_pcm_t* pcm;
 
             {
                 LOCK("thread: waiting for buffer");
-                while (!quit && (!playable(this->pcmHandle) || !this->buffers.size())) {
+                while (!quit && (this->closePending || !playable(this->pcmHandle) || !this->buffers.size())) {
                     WAIT();
                 }
 
@@ -396,6 +683,10 @@ void AlsaOut::WriteLoop() {
 
                 next = this->buffers.front();
                 this->buffers.pop_front();
+                --this->bufferCounts[next->provider];
+                format = this->pcmFormat;
+                pcm = this->pcmHandle;
+                this->writing = true; /* pcm stays open until we clear this */
             }
 
             int err;
@@ -410,19 +701,19 @@ void AlsaOut::WriteLoop() {
                 as terrible as an algorithm can be -- it's just a linear ramp. */
                 //std::cerr << "volume=" << volume << std::endl;
                 if (volume != 1.0f) {
-                    float *buffer = next->buffer->BufferPointer();
-                    for (size_t i = 0; i < samples; i++) {
-                        (*buffer) *= volume;
-                        ++buffer;
-                    }
+                    sampleops::Scale(next->buffer->BufferPointer(), (long) samples, volume);
                 }
 
-                WRITE_BUFFER(this->pcmHandle, next, samplesPerChannel); /* sets 'err' */
+                WRITE_BUFFER(pcm, next->buffer, format); /* sets 'err' */
+
+                if (err == -EPIPE) {
+                    ++this->underruns;
+                }
 
-                if (err == -EINTR || err == -EPIPE || err == -ESTRPIPE) {
-                    if (!snd_pcm_recover(this->pcmHandle, err, 1)) {
+                if (!this->closePending && (err == -EINTR || err == -EPIPE || err == -ESTRPIPE)) {
+                    if (!snd_pcm_recover(pcm, err, 1)) {
                         /* try one more time... */
-                        WRITE_BUFFER(this->pcmHandle, next, samplesPerChannel);
+                        WRITE_BUFFER(pcm, next->buffer, format);
                     }
                 }
 
@@ -430,6 +721,13 @@ void AlsaOut::WriteLoop() {
                     std::cerr << "AlsaOut: short write. expected=" << samplesPerChannel << ", actual=" << err << std::endl;
                 }
 
+                {
+                    LOCK("thread: write finished");
+                    this->writing = false;
+                    this->NotifyIfReady();
+                    NOTIFY();
+                }
+
                 next->provider->OnBufferProcessed(next->buffer);
             }
         }
@@ -448,10 +746,13 @@ int AlsaOut::Play(IBuffer *buffer, IBufferProvider* provider) {
             return OutputInvalidState;
         }
 
-        if (this->CountBuffersWithProvider(provider) >= BUFFER_COUNT) {
+        size_t& count = this->bufferCounts[provider];
+        if (count >= BUFFER_COUNT) {
             return OutputBufferFull;
         }
 
+        ++count;
+
         std::shared_ptr<BufferContext> context(new BufferContext());
         context->buffer = buffer;
         context->provider = provider;
@@ -489,18 +790,21 @@ void AlsaOut::SetFormat(IBuffer *buffer) {
         this->channels = buffer->Channels();
         this->rate = buffer->SampleRate();
 
+        /* only when we're really re-opening; kicking the writer drops
+        whatever is still in the device's buffer. */
+        this->WaitForWriter(lock);
         this->CloseDevice();
 
         this->InitDevice();
 
         int err = snd_pcm_set_params(
             this->pcmHandle,
-            PCM_FORMAT,
-            PCM_ACCESS_TYPE,
+            this->pcmFormat,
+            this->pcmType,
             this->channels,
             this->rate,
             1, /* allow resampling */
-            500000); /* 0.5s latency */
+            this->latencyMs * 1000); /* smaller values mean smaller periods */
 
         if (err > 0) {
             std::cerr << "AlsaOut: set format error: " << snd_strerror(err) << std::endl;
@@ -512,18 +816,3 @@ void AlsaOut::SetFormat(IBuffer *buffer) {
         std::cerr << "AlsaOut: device format initialized from buffer\n";
     }
 }
-
-size_t AlsaOut::CountBuffersWithProvider(IBufferProvider* provider) {
-    LOCK("count");
-
-    size_t count = 0;
-    auto it = this->buffers.begin();
-    while (it != this->buffers.end()) {
-        if ((*it)->provider == provider) {
-            ++count;
-        }
-        ++it;
-    }
-
-    return count;
-}
@@ -40,12 +40,25 @@
 
 #include <core/sdk/IOutput.h>
 #include <core/sdk/IDevice.h>
+#include <core/sdk/IFixedFormatOutput.h>
+#include <core/sdk/IOutputDiagnostics.h>
+#include <core/sdk/IDelayReportingOutput.h>
+#include <core/sdk/INotifyingOutput.h>
+#include <core/sdk/SampleOps.h>
 
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/thread/condition.hpp>
+#include <atomic>
 #include <list>
+#include <unordered_map>
+#include <vector>
 
-class AlsaOut : public musik::core::sdk::IOutput {
+class AlsaOut :
+    public musik::core::sdk::INotifyingOutput,
+    public musik::core::sdk::IFixedFormatOutput,
+    public musik::core::sdk::IOutputDiagnostics,
+    public musik::core::sdk::IDelayReportingOutput
+{
     public:
         AlsaOut();
         virtual ~AlsaOut();
@@ -71,35 +84,65 @@ class AlsaOut : public musik::core::sdk::IOutput {
         virtual bool SetDefaultDevice(const char* deviceId) override;
         virtual musik::core::sdk::IDevice* GetDefaultDevice() override;
 
+        /* IFixedFormatOutput */
+        virtual bool GetFixedFormat(long* sampleRate, int* channels) override;
+
+        /* IOutputDiagnostics */
+        virtual uint64_t Underruns() override { return this->underruns.load(); }
+
+        /* IDelayReportingOutput */
+        virtual double GetDelay() override;
+
+        /* INotifyingOutput */
+        virtual bool NotifyWhenReady(musik::core::sdk::IOutputReadyListener* listener) override;
+        virtual void CancelNotify(musik::core::sdk::IOutputReadyListener* listener) override;
+
     private:
         struct BufferContext {
             musik::core::sdk::IBuffer *buffer;
             musik::core::sdk::IBufferProvider *provider;
         };
 
-        size_t CountBuffersWithProvider(musik::core::sdk::IBufferProvider* provider);
         void SetFormat(musik::core::sdk::IBuffer *buffer);
         void InitDevice();
         void CloseDevice();
+        void WaitForWriter(boost::recursive_mutex::scoped_lock& lock);
         void WriteLoop();
+        bool HasCapacity();
+        void NotifyIfReady();
         std::string GetPreferredDeviceId();
+        snd_pcm_format_t NegotiateFormat();
+        void Convert(const float* src, long samples, snd_pcm_format_t format, void* dst);
+        int WriteInterleaved(snd_pcm_t* pcm, musik::core::sdk::IBuffer* buffer, snd_pcm_format_t format);
+        int WriteMmap(snd_pcm_t* pcm, musik::core::sdk::IBuffer* buffer, snd_pcm_format_t format);
 
         std::string device;
         snd_pcm_t* pcmHandle;
         snd_pcm_hw_params_t* hardware;
         snd_pcm_format_t pcmFormat;
         snd_pcm_access_t pcmType;
+        unsigned int latencyMs;
 
         size_t channels;
         size_t rate;
         double volume;
         double latency;
         volatile bool quit, paused, initialized;
+        volatile bool writing, closePending; /* guarded by stateMutex */
+
+        /* for devices that don't take floats; only used by the write thread */
+        std::vector<uint8_t> converted;
+        musik::core::sdk::sampleops::Dither dither;
+        bool ditherEnabled;
+
+        std::atomic<uint64_t> underruns; /* xruns we've recovered from */
 
         std::unique_ptr<boost::thread> writeThread;
         boost::recursive_mutex stateMutex;
         boost::condition threadEvent;
 
         std::list<std::shared_ptr<BufferContext> > buffers;
+        std::unordered_map<musik::core::sdk::IBufferProvider*, size_t> bufferCounts;
+        std::vector<musik::core::sdk::IOutputReadyListener*> readyListeners;
         boost::mutex mutex;
 };
@@ -34,8 +34,13 @@
 
 #include "FfmpegDecoder.h"
 #include <core/sdk/IDebug.h>
+#include <core/sdk/IPreferences.h>
+#include <core/sdk/ISchema.h>
 #include <algorithm>
+#include <list>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #ifdef WIN32
 #define DLLEXPORT __declspec(dllexport)
@@ -44,18 +49,213 @@
 #endif
 
 #define DEFAULT_FRAME_SIZE 4096
-#define BUFFER_SIZE 4096
-#define PROBE_SIZE 32768
+
+/* sizes are in kilobytes. the buffer is what the avio context reads into,
+and how much it asks the data stream for at a time; the probe is how much
+we look at to guess the container format; the analysis limit caps how much
+avformat_find_stream_info() may read before it gives up (zero leaves it at
+ffmpeg's default). streams that come in over the network get smaller
+values, so they start playing sooner. */
+static const char* KEY_LOCAL_BUFFER_SIZE = "local_buffer_size_kb";
+static const char* KEY_LOCAL_PROBE_SIZE = "local_probe_size_kb";
+static const char* KEY_LOCAL_ANALYZE_SIZE = "local_analyze_size_kb";
+static const char* KEY_REMOTE_BUFFER_SIZE = "remote_buffer_size_kb";
+static const char* KEY_REMOTE_PROBE_SIZE = "remote_probe_size_kb";
+static const char* KEY_REMOTE_ANALYZE_SIZE = "remote_analyze_size_kb";
+static const char* KEY_PROBE_CACHE_SIZE = "probe_cache_size";
+
+static const int DEFAULT_LOCAL_BUFFER_SIZE = 64;
+static const int DEFAULT_LOCAL_PROBE_SIZE = 32;
+static const int DEFAULT_LOCAL_ANALYZE_SIZE = 0;
+static const int DEFAULT_REMOTE_BUFFER_SIZE = 32;
+static const int DEFAULT_REMOTE_PROBE_SIZE = 16;
+static const int DEFAULT_REMOTE_ANALYZE_SIZE = 256;
+static const int DEFAULT_PROBE_CACHE_SIZE = 64;
 
 using namespace musik::core::sdk;
 
 static const char* TAG = "ffmpegdecoder";
 static IDebug* debug = nullptr;
+static IPreferences* prefs = nullptr;
 
 extern "C" DLLEXPORT void SetDebug(IDebug* debug) {
     ::debug = debug;
 }
 
+extern "C" DLLEXPORT void SetPreferences(IPreferences* prefs) {
+    ::prefs = prefs;
+    prefs->GetInt(KEY_LOCAL_BUFFER_SIZE, DEFAULT_LOCAL_BUFFER_SIZE);
+    prefs->GetInt(KEY_LOCAL_PROBE_SIZE, DEFAULT_LOCAL_PROBE_SIZE);
+    prefs->GetInt(KEY_LOCAL_ANALYZE_SIZE, DEFAULT_LOCAL_ANALYZE_SIZE);
+    prefs->GetInt(KEY_REMOTE_BUFFER_SIZE, DEFAULT_REMOTE_BUFFER_SIZE);
+    prefs->GetInt(KEY_REMOTE_PROBE_SIZE, DEFAULT_REMOTE_PROBE_SIZE);
+    prefs->GetInt(KEY_REMOTE_ANALYZE_SIZE, DEFAULT_REMOTE_ANALYZE_SIZE);
+    prefs->GetInt(KEY_PROBE_CACHE_SIZE, DEFAULT_PROBE_CACHE_SIZE);
+    prefs->Save();
+}
+
+extern "C" DLLEXPORT ISchema* GetSchema() {
+    auto schema = new TSchema<>();
+    schema->AddInt(KEY_LOCAL_BUFFER_SIZE, DEFAULT_LOCAL_BUFFER_SIZE, 4, 4096);
+    schema->AddInt(KEY_LOCAL_PROBE_SIZE, DEFAULT_LOCAL_PROBE_SIZE, 4, 1024);
+    schema->AddInt(KEY_LOCAL_ANALYZE_SIZE, DEFAULT_LOCAL_ANALYZE_SIZE, 0, 65536);
+    schema->AddInt(KEY_REMOTE_BUFFER_SIZE, DEFAULT_REMOTE_BUFFER_SIZE, 4, 4096);
+    schema->AddInt(KEY_REMOTE_PROBE_SIZE, DEFAULT_REMOTE_PROBE_SIZE, 4, 1024);
+    schema->AddInt(KEY_REMOTE_ANALYZE_SIZE, DEFAULT_REMOTE_ANALYZE_SIZE, 0, 65536);
+    schema->AddInt(KEY_PROBE_CACHE_SIZE, DEFAULT_PROBE_CACHE_SIZE, 0, 4096);
+    return schema;
+}
+
+struct IoSettings {
+    int bufferSize, probeSize, analyzeSize; /* bytes */
+};
+
+static int getKilobytes(const char* key, int defaultValue, int minimum) {
+    const int value = prefs ? prefs->GetInt(key, defaultValue) : defaultValue;
+    return std::max(minimum, value) * 1024;
+}
+
+static IoSettings getIoSettings(IDataStream* stream) {
+    const std::string uri = stream->Uri() ? stream->Uri() : "";
+    const bool remote = uri.find("http://") == 0 || uri.find("https://") == 0;
+
+    IoSettings result;
+    if (remote) {
+        result.bufferSize = getKilobytes(KEY_REMOTE_BUFFER_SIZE, DEFAULT_REMOTE_BUFFER_SIZE, 4);
+        result.probeSize = getKilobytes(KEY_REMOTE_PROBE_SIZE, DEFAULT_REMOTE_PROBE_SIZE, 4);
+        result.analyzeSize = getKilobytes(KEY_REMOTE_ANALYZE_SIZE, DEFAULT_REMOTE_ANALYZE_SIZE, 0);
+    }
+    else {
+        result.bufferSize = getKilobytes(KEY_LOCAL_BUFFER_SIZE, DEFAULT_LOCAL_BUFFER_SIZE, 4);
+        result.probeSize = getKilobytes(KEY_LOCAL_PROBE_SIZE, DEFAULT_LOCAL_PROBE_SIZE, 4);
+        result.analyzeSize = getKilobytes(KEY_LOCAL_ANALYZE_SIZE, DEFAULT_LOCAL_ANALYZE_SIZE, 0);
+    }
+
+    return result;
+}
+
+/* what avformat_find_stream_info() found the last time we opened a file.
+most tracks are opened more than once in quick succession (prefetched as
+the next track, then played; replayed; seeked in a new player) and the
+analysis is the slowest part of opening them, especially over the network.
+keyed by uri and length, most recently used first. */
+struct ProbeResult {
+    std::string key;
+    AVInputFormat* format;
+    int streamId;
+    int64_t duration;
+    AVCodecParameters* parameters;
+};
+
+static std::mutex probeCacheMutex;
+static std::list<ProbeResult> probeCache;
+
+static std::string probeCacheKey(IDataStream* stream) {
+    return std::string(stream->Uri() ? stream->Uri() : "") + ":" + std::to_string(stream->Length());
+}
+
+static std::list<ProbeResult>::iterator findProbeResult(const std::string& key) {
+    auto it = std::find_if(probeCache.begin(), probeCache.end(),
+        [&key](const ProbeResult& result) { return result.key == key; });
+
+    if (it != probeCache.end() && it != probeCache.begin()) {
+        probeCache.splice(probeCache.begin(), probeCache, it);
+        it = probeCache.begin();
+    }
+
+    return it;
+}
+
+static AVInputFormat* getCachedFormat(const std::string& key) {
+    std::unique_lock<std::mutex> lock(probeCacheMutex);
+    auto it = findProbeResult(key);
+    return it != probeCache.end() ? it->format : nullptr;
+}
+
+static bool applyCachedProbe(const std::string& key, AVFormatContext* context, int& streamId) {
+    std::unique_lock<std::mutex> lock(probeCacheMutex);
+
+    auto it = findProbeResult(key);
+    if (it == probeCache.end() || it->format != context->iformat) {
+        return false;
+    }
+
+    /* make sure the headers agree with what we saw last time */
+    if (it->streamId < 0 || it->streamId >= (int) context->nb_streams) {
+        return false;
+    }
+
+    AVCodecParameters* current = context->streams[it->streamId]->codecpar;
+    if (current->codec_type != AVMEDIA_TYPE_AUDIO ||
+        (current->codec_id != AV_CODEC_ID_NONE && current->codec_id != it->parameters->codec_id))
+    {
+        return false;
+    }
+
+    if (avcodec_parameters_copy(current, it->parameters) < 0) {
+        return false;
+    }
+
+    if (context->duration == AV_NOPTS_VALUE || context->duration <= 0) {
+        context->duration = it->duration;
+    }
+
+    streamId = it->streamId;
+    return true;
+}
+
+static void cacheProbeResult(const std::string& key, AVFormatContext* context, int streamId) {
+    const int capacity = prefs
+        ? prefs->GetInt(KEY_PROBE_CACHE_SIZE, DEFAULT_PROBE_CACHE_SIZE)
+        : DEFAULT_PROBE_CACHE_SIZE;
+
+    if (capacity <= 0) {
+        return;
+    }
+
+    ProbeResult result;
+    result.key = key;
+    result.format = context->iformat;
+    result.streamId = streamId;
+    result.duration = context->duration;
+    result.parameters = avcodec_parameters_alloc();
+
+    if (!result.parameters ||
+        avcodec_parameters_copy(result.parameters, context->streams[streamId]->codecpar) < 0)
+    {
+        avcodec_parameters_free(&result.parameters);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(probeCacheMutex);
+
+    auto it = findProbeResult(key);
+    if (it != probeCache.end()) {
+        avcodec_parameters_free(&it->parameters);
+        probeCache.erase(it);
+    }
+
+    probeCache.push_front(result);
+
+    while ((int) probeCache.size() > capacity) {
+        avcodec_parameters_free(&probeCache.back().parameters);
+        probeCache.pop_back();
+    }
+}
+
+static int readFully(IDataStream* stream, unsigned char* buffer, int count) {
+    /* network streams return whatever they have, which may not be much */
+    int total = 0;
+    while (total < count) {
+        const PositionType read = stream->Read(buffer + total, count - total);
+        if (read <= 0) {
+            break;
+        }
+        total += (int) read;
+    }
+    return total;
+}
+
 static std::string getAvError(int errnum) {
     char buffer[AV_ERROR_MAX_STRING_SIZE];
     buffer[0] = '\0';
@@ -76,9 +276,19 @@ static void logError(const std::string& message) {
 
 static int readCallback(void* opaque, uint8_t* buffer, int bufferSize) {
     FfmpegDecoder* decoder = static_cast<FfmpegDecoder*>(opaque);
+    if (decoder && decoder->StreamView()) {
+        const void* data = nullptr;
+        auto count = decoder->StreamView()->View(&data, (PositionType) bufferSize);
+        if (count <= 0) {
+            return AVERROR_EOF;
+        }
+        memcpy(buffer, data, (size_t) count);
+        return (int) count;
+    }
     if (decoder && decoder->Stream()) {
+        /* a short read isn't the end; network streams hand over what they have */
         auto count = decoder->Stream()->Read(buffer, (PositionType) bufferSize);
-        return (count == bufferSize) ? count : AVERROR_EOF;
+        return (count > 0) ? (int) count : AVERROR_EOF;
     }
     return 0;
 }
@@ -124,6 +334,7 @@ static int64_t seekCallback(void* opaque, int64_t offset, int whence) {
 
 FfmpegDecoder::FfmpegDecoder() {
     this->stream = nullptr;
+    this->streamView = nullptr;
     this->streamId = -1;
     this->duration = -1.0f;
     this->ioContext = nullptr;
@@ -132,16 +343,11 @@ FfmpegDecoder::FfmpegDecoder() {
     this->decodedFrame = nullptr;
     this->resampledFrame = nullptr;
     this->resampler = nullptr;
-    this->bufferSize = AV_INPUT_BUFFER_PADDING_SIZE + BUFFER_SIZE;
-    this->buffer = new unsigned char[this->bufferSize];
 }
 
 FfmpegDecoder::~FfmpegDecoder() {
     this->Reset();
 
-    delete[] this->buffer;
-    this->buffer = nullptr;
-
     if (this->decodedFrame) {
         av_frame_free(&this->decodedFrame);
         this->decodedFrame = nullptr;
@@ -211,10 +417,6 @@ double FfmpegDecoder::GetDuration() {
 }
 
 void FfmpegDecoder::Reset() {
-    if (this->ioContext) {
-        av_free(this->ioContext);
-        this->ioContext = nullptr;
-    }
     if (this->codecContext) {
         // avcodec_flush_buffers(this->codecContext);
         auto stream = this->formatContext->streams[this->streamId];
@@ -229,6 +431,13 @@ void FfmpegDecoder::Reset() {
         avformat_free_context(this->formatContext);
         this->formatContext = nullptr;
     }
+    if (this->ioContext) {
+        /* ffmpeg may have replaced the buffer we gave it; free whatever
+        it's using now. */
+        av_freep(&this->ioContext->buffer);
+        av_free(this->ioContext);
+        this->ioContext = nullptr;
+    }
     if (this->outputFifo) {
         av_audio_fifo_free(this->outputFifo);
         this->outputFifo = nullptr;
@@ -262,38 +471,70 @@ bool FfmpegDecoder::Open(musik::core::sdk::IDataStream *stream) {
         ::debug->Info(TAG, "parsing data stream...");
 
         this->stream = stream;
-
-        this->ioContext = avio_alloc_context(
-            this->buffer,
-            (int) this->bufferSize,
-            0,
-            this,
-            readCallback,
-            writeCallback,
-            seekCallback);
+        this->streamView = dynamic_cast<IDataStreamView*>(stream);
+
+        const IoSettings io = getIoSettings(stream);
+        const std::string cacheKey = probeCacheKey(stream);
+
+        unsigned char* buffer = (unsigned char*) av_malloc(io.bufferSize);
+        if (buffer) {
+            this->ioContext = avio_alloc_context(
+                buffer,
+                io.bufferSize,
+                0,
+                this,
+                readCallback,
+                writeCallback,
+                seekCallback);
+
+            if (!this->ioContext) {
+                av_free(buffer);
+            }
+        }
 
         if (this->ioContext != nullptr) {
+            /* if the stream is already in memory, reading from it is cheap,
+            so let avio_read() go straight to readCallback instead of staging
+            everything in our buffer; packet data is then copied once, from
+            the stream's storage into the packet. */
+            if (this->streamView) {
+                this->ioContext->direct = 1;
+            }
+
             this->streamId = -1;
             this->formatContext = avformat_alloc_context();
             this->formatContext->pb = this->ioContext;
             this->formatContext->flags = AVFMT_FLAG_CUSTOM_IO;
 
-            unsigned char probe[PROBE_SIZE];
-            memset(probe, 0, PROBE_SIZE);
-            int count = stream->Read(probe, PROBE_SIZE - AVPROBE_PADDING_SIZE);
-            stream->SetPosition(0);
+            if (io.analyzeSize > 0) {
+                this->formatContext->probesize = io.analyzeSize;
+            }
+
+            /* if we've opened this file before we know what it is already */
+            this->formatContext->iformat = getCachedFormat(cacheKey);
 
-            AVProbeData probeData = { 0 };
-            probeData.buf = probe;
-            probeData.buf_size = count;
-            probeData.filename = "";
+            if (!this->formatContext->iformat) {
+                std::vector<unsigned char> probe(io.probeSize + AVPROBE_PADDING_SIZE, 0);
+                int count = readFully(stream, probe.data(), io.probeSize);
+                stream->SetPosition(0);
 
-            this->formatContext->iformat = av_probe_input_format(&probeData, 1);
+                AVProbeData probeData = { 0 };
+                probeData.buf = probe.data();
+                probeData.buf_size = count;
+                probeData.filename = "";
+
+                this->formatContext->iformat = av_probe_input_format(&probeData, 1);
+            }
 
             if (this->formatContext->iformat) {
                 if (avformat_open_input(&this->formatContext, "", nullptr, nullptr) == 0) {
                     AVCodec* codec = nullptr;
-                    if (avformat_find_stream_info(this->formatContext, nullptr) >= 0) {
+                    if (applyCachedProbe(cacheKey, this->formatContext, this->streamId)) {
+                        ::debug->Info(TAG, "using cached stream info");
+                        codec = avcodec_find_decoder(
+                            this->formatContext->streams[this->streamId]->codecpar->codec_id);
+                    }
+                    else if (avformat_find_stream_info(this->formatContext, nullptr) >= 0) {
                         this->streamId = av_find_best_stream(
                             this->formatContext,
                             AVMEDIA_TYPE_AUDIO,
@@ -301,9 +542,13 @@ bool FfmpegDecoder::Open(musik::core::sdk::IDataStream *stream) {
                             -1,
                             &codec,
                             0);
+
+                        if (this->streamId >= 0 && codec != nullptr) {
+                            cacheProbeResult(cacheKey, this->formatContext, this->streamId);
+                        }
                     }
 
-                    if (this->streamId != -1 && codec != nullptr) {
+                    if (this->streamId >= 0 && codec != nullptr) {
                         ::debug->Info(TAG, "found audio stream!");
                         this->codecContext = avcodec_alloc_context3(codec);
                         if (codecContext) {
@@ -37,6 +37,7 @@
 #include <core/sdk/constants.h>
 #include <core/sdk/IDecoder.h>
 #include <core/sdk/IDataStream.h>
+#include <core/sdk/IDataStreamView.h>
 
 extern "C" {
     #include <libavformat/avio.h>
@@ -64,6 +65,7 @@ class FfmpegDecoder: public musik::core::sdk::IDecoder {
         virtual bool Exhausted() override;
 
         IDataStream* Stream() { return this->stream; }
+        IDataStreamView* StreamView() { return this->streamView; }
 
     private:
         void Reset();
@@ -76,6 +78,7 @@ class FfmpegDecoder: public musik::core::sdk::IDecoder {
         void FlushAndFinalizeDecoder();
 
         musik::core::sdk::IDataStream* stream;
+        musik::core::sdk::IDataStreamView* streamView;
         AVIOContext* ioContext;
         AVAudioFifo* outputFifo;
         AVFormatContext* formatContext;
@@ -83,8 +86,6 @@ class FfmpegDecoder: public musik::core::sdk::IDecoder {
         AVFrame* decodedFrame;
         AVFrame* resampledFrame;
         SwrContext* resampler;
-        unsigned char* buffer;
-        int bufferSize;
         int rate, channels;
         int streamId;
         int preferredFrameSize;
@@ -34,15 +34,20 @@
 
 #include "stdafx.h"
 #include "FlacDecoder.h"
+#include <core/sdk/SampleOps.h>
 #include <complex>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 FlacDecoder::FlacDecoder()
 : decoder(nullptr)
 , outputBufferSize(0)
 , outputBufferUsed(0)
+, outputBufferOffset(0)
 , outputBuffer(nullptr)
+, directTarget(nullptr)
+, directSamples(0)
 , channels(0)
 , sampleRate(0)
 , bitsPerSample(0)
@@ -183,27 +188,56 @@ FLAC__StreamDecoderWriteStatus FlacDecoder::FlacWrite(
     void *clientData)
 {
     FlacDecoder *fdec = (FlacDecoder*) clientData;
-    unsigned sampleCount = (unsigned) fdec->channels * frame->header.blocksize;
-
-    /* initialize the output buffer if it doesn't exist */
-    if (sampleCount > fdec->outputBufferSize) {
-        delete fdec->outputBuffer;
-        fdec->outputBuffer = nullptr;
-        fdec->outputBufferSize = sampleCount;
-        fdec->outputBuffer = new float[sampleCount];
-    }
+
+    const long channels = (long) fdec->channels;
+    const long blockSize = (long) frame->header.blocksize;
 
     /* we need to convert the fixed point samples to floating point samples. figure
     out the maximum amplitude of the fixed point samples based on the resolution */
-    float maxAmplitude = pow(2.0f, (fdec->bitsPerSample - 1));
-
-    /* run the conversion */
-    fdec->outputBufferUsed = 0;
-	for (unsigned int i = 0; i < frame->header.blocksize; ++i) {
-        for (int j = 0; j < fdec->channels; ++j) {
-            fdec->outputBuffer[fdec->outputBufferUsed] = (((float) buffer[j][i]) / maxAmplitude);
-            fdec->outputBufferUsed++;
+    const float scale = 1.0f / pow(2.0f, (fdec->bitsPerSample - 1));
+
+    /* if we're decoding directly to the caller's memory, as much of the frame
+    as fits goes straight there; only the rest goes through our own buffer. */
+    long directFrames = 0;
+    if (fdec->directTarget) {
+        directFrames = std::min(blockSize, fdec->directSamples / channels);
+
+        sampleops::Interleave(
+            (const int32_t* const*) buffer,
+            fdec->channels,
+            directFrames,
+            scale,
+            fdec->directTarget);
+
+        fdec->directTarget += directFrames * channels;
+        fdec->directSamples -= directFrames * channels;
+    }
+
+    if (directFrames < blockSize) {
+        const unsigned long sampleCount = (unsigned long) ((blockSize - directFrames) * channels);
+
+        /* initialize the output buffer if it doesn't exist */
+        if (sampleCount > fdec->outputBufferSize) {
+            delete fdec->outputBuffer;
+            fdec->outputBuffer = nullptr;
+            fdec->outputBufferSize = sampleCount;
+            fdec->outputBuffer = new float[sampleCount];
+        }
+
+        const int32_t* remainder[FLAC__MAX_CHANNELS];
+        for (long i = 0; i < channels; i++) {
+            remainder[i] = (const int32_t*) buffer[i] + directFrames;
         }
+
+        sampleops::Interleave(
+            remainder,
+            fdec->channels,
+            blockSize - directFrames,
+            scale,
+            fdec->outputBuffer);
+
+        fdec->outputBufferUsed = sampleCount;
+        fdec->outputBufferOffset = 0;
     }
 
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
@@ -216,6 +250,10 @@ void FlacDecoder::Release() {
 double FlacDecoder::SetPosition(double seconds) {
     FLAC__uint64 seekToSample = (FLAC__uint64)((double) this->sampleRate * seconds);
 
+    /* libFLAC hands us the frame containing the target sample while seeking,
+    so anything buffered from before is stale. */
+    this->outputBufferUsed = this->outputBufferOffset = 0;
+
     if (FLAC__stream_decoder_seek_absolute(this->decoder, seekToSample)) {
         return seconds;
     }
@@ -239,12 +277,15 @@ bool FlacDecoder::GetBuffer(IBuffer *buffer) {
     buffer->SetSampleRate(this->sampleRate);
     buffer->SetChannels(this->channels);
 
-    /* read the next chunk */
-    if (FLAC__stream_decoder_process_single(this->decoder)) {
-        if (this->outputBuffer && this->outputBufferUsed > 0) {
-            buffer->SetSamples(this->outputBufferUsed);
-            memcpy(buffer->BufferPointer(), this->outputBuffer, this->outputBufferUsed * sizeof(float));
-            this->outputBufferUsed = 0; /* mark consumed */
+    /* read the next chunk, unless we're still holding one */
+    if (this->outputBufferUsed > this->outputBufferOffset ||
+        FLAC__stream_decoder_process_single(this->decoder))
+    {
+        if (this->outputBuffer && this->outputBufferUsed > this->outputBufferOffset) {
+            const unsigned long count = this->outputBufferUsed - this->outputBufferOffset;
+            buffer->SetSamples(count);
+            memcpy(buffer->BufferPointer(), this->outputBuffer + this->outputBufferOffset, count * sizeof(float));
+            this->outputBufferUsed = this->outputBufferOffset = 0; /* mark consumed */
             return true;
         }
     }
@@ -252,3 +293,40 @@ bool FlacDecoder::GetBuffer(IBuffer *buffer) {
     this->exhausted = true;
     return false;
 }
+
+long FlacDecoder::Decode(float* target, long samples) {
+    long written = 0;
+
+    while (written < samples) {
+        /* whatever didn't fit last time goes first */
+        if (this->outputBufferUsed > this->outputBufferOffset) {
+            const long count = std::min(
+                samples - written,
+                (long)(this->outputBufferUsed - this->outputBufferOffset));
+
+            memcpy(target + written, this->outputBuffer + this->outputBufferOffset, count * sizeof(float));
+            this->outputBufferOffset += count;
+            written += count;
+            continue;
+        }
+
+        this->directTarget = target + written;
+        this->directSamples = samples - written;
+
+        const bool decoded = FLAC__stream_decoder_process_single(this->decoder) != 0;
+        const long direct = (samples - written) - this->directSamples;
+
+        this->directTarget = nullptr;
+        this->directSamples = 0;
+        written += direct;
+
+        if (!decoded || FLAC__stream_decoder_get_state(this->decoder) == FLAC__STREAM_DECODER_END_OF_STREAM) {
+            if (this->outputBufferUsed <= this->outputBufferOffset) {
+                this->exhausted = true;
+                break;
+            }
+        }
+    }
+
+    return written;
+}
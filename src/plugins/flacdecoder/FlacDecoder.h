@@ -36,13 +36,17 @@
 
 #include <core/sdk/constants.h>
 #include <core/sdk/IDecoder.h>
+#include <core/sdk/IDirectDecoder.h>
 #include <core/sdk/IDataStream.h>
 #include <FLAC/stream_decoder.h>
 #include <stddef.h>
 
 using namespace musik::core::sdk;
 
-class FlacDecoder: public musik::core::sdk::IDecoder {
+class FlacDecoder:
+    public musik::core::sdk::IDecoder,
+    public musik::core::sdk::IDirectDecoder
+{
     public:
         FlacDecoder();
         ~FlacDecoder();
@@ -53,6 +57,7 @@ class FlacDecoder: public musik::core::sdk::IDecoder {
         virtual double GetDuration() override;
         virtual bool Open(musik::core::sdk::IDataStream *stream) override;
         virtual bool Exhausted() override { return this->exhausted; }
+        virtual long Decode(float* target, long samples) override;
 
     private:
         static FLAC__StreamDecoderReadStatus FlacRead(
@@ -110,4 +115,10 @@ class FlacDecoder: public musik::core::sdk::IDecoder {
         float *outputBuffer;
         unsigned long outputBufferSize;
         unsigned long outputBufferUsed;
+        unsigned long outputBufferOffset;
+
+        /* set during Decode(); frames that fit are written here directly,
+        instead of to outputBuffer */
+        float *directTarget;
+        long directSamples;
 };
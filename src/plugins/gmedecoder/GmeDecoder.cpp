@@ -36,6 +36,7 @@
 #include "GmeDecoder.h"
 #include <core/sdk/IPreferences.h>
 #include <core/sdk/IDebug.h>
+#include <core/sdk/SampleOps.h>
 #include <cassert>
 
 static const int BUFFER_SAMPLE_COUNT = 2048;
@@ -43,7 +44,6 @@ static const int CHANNELS = 2;
 static const int SAMPLE_RATE = 48000;
 static const int SAMPLES_PER_MS = (SAMPLE_RATE * CHANNELS) / 1000;
 static const double LENGTH_FOREVER = INT_MIN;
-static const float F_SHRT_MAX = (float) SHRT_MAX;
 
 extern IPreferences* prefs;
 extern IDebug* debug;
@@ -168,10 +168,11 @@ bool GmeDecoder::GetBuffer(IBuffer *target) {
             target->SetSampleRate(SAMPLE_RATE);
             target->SetSamples(bufferSamples);
 
-            float* dst = target->BufferPointer();
-            for (size_t i = 0; i < BUFFER_SAMPLE_COUNT; i++) {
-                dst[i] = (float) this->buffer[i] / F_SHRT_MAX;
-            }
+            sampleops::S16ToF32(
+                (const int16_t*) this->buffer,
+                target->BufferPointer(),
+                bufferSamples);
+
             samplesPlayed += bufferSamples;
             return true;
         }
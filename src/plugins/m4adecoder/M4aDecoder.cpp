@@ -35,6 +35,7 @@
 #include "stdafx.h"
 #include "M4aDecoder.h"
 #include <cstring>
+#include <algorithm>
 #include <string>
 #include <stdlib.h>
 
@@ -84,6 +85,11 @@ M4aDecoder::M4aDecoder() {
     memset(&decoderCallbacks, 0, sizeof(this->decoderCallbacks));
     this->duration = -1.0f;
     this->exhausted = false;
+    this->frame = nullptr;
+    this->frameSamples = 0;
+    this->frameOffset = 0;
+    this->frameSampleRate = 0;
+    this->frameChannels = 0;
 }
 
 M4aDecoder::~M4aDecoder() {
@@ -172,6 +178,8 @@ double M4aDecoder::SetPosition(double seconds) {
     decoderSampleId = mp4ff_find_sample_use_offsets(
         decoderFile, audioTrackId, duration, &skip_samples);
 
+    this->frameSamples = this->frameOffset = 0;
+
     return seconds;
 }
 
@@ -179,7 +187,9 @@ double M4aDecoder::GetDuration() {
     return this->duration;
 }
 
-bool M4aDecoder::GetBuffer(IBuffer* target) {
+bool M4aDecoder::DecodeNextFrame() {
+    this->frameSamples = this->frameOffset = 0;
+
     if (this->decoderSampleId >= 0) {
         void* sampleBuffer = NULL;
         unsigned char* encodedData = NULL;
@@ -203,7 +213,6 @@ bool M4aDecoder::GetBuffer(IBuffer* target) {
             decoderSampleId++;
 
             if (rc == 0 || encodedData == NULL) {
-                this->exhausted = true;
                 return false;
             }
 
@@ -217,20 +226,54 @@ bool M4aDecoder::GetBuffer(IBuffer* target) {
             free(encodedData);
 
             if (sampleBuffer && frameInfo.error <= 0 && decoderSampleId <= this->totalSamples) {
-                target->SetSampleRate(frameInfo.samplerate);
-                target->SetChannels(frameInfo.channels);
-                target->SetSamples(frameInfo.samples);
-
-                memcpy(
-                    static_cast<void*>(target->BufferPointer()),
-                    static_cast<void*>(sampleBuffer),
-                    sizeof(float) * frameInfo.samples);
-
+                this->frame = static_cast<float*>(sampleBuffer);
+                this->frameSamples = (long) frameInfo.samples;
+                this->frameSampleRate = frameInfo.samplerate;
+                this->frameChannels = frameInfo.channels;
                 return true;
             }
         }
     }
 
+    return false;
+}
+
+bool M4aDecoder::GetBuffer(IBuffer* target) {
+    /* hand out what's left of the current frame before decoding another */
+    if (this->frameOffset < this->frameSamples || this->DecodeNextFrame()) {
+        const long count = this->frameSamples - this->frameOffset;
+
+        target->SetSampleRate(this->frameSampleRate);
+        target->SetChannels(this->frameChannels);
+        target->SetSamples(count);
+
+        memcpy(
+            static_cast<void*>(target->BufferPointer()),
+            static_cast<void*>(this->frame + this->frameOffset),
+            sizeof(float) * count);
+
+        this->frameOffset = this->frameSamples;
+        return true;
+    }
+
     this->exhausted = true;
     return false;
 }
+
+long M4aDecoder::Decode(float* target, long samples) {
+    long written = 0;
+
+    while (written < samples) {
+        if (this->frameOffset >= this->frameSamples && !this->DecodeNextFrame()) {
+            this->exhausted = true;
+            break;
+        }
+
+        const long count = std::min(samples - written, this->frameSamples - this->frameOffset);
+        memcpy(target + written, this->frame + this->frameOffset, sizeof(float) * count);
+        this->frameOffset += count;
+        written += count;
+    }
+
+    return written;
+}
@@ -35,10 +35,14 @@
 #pragma once
 
 #include <core/sdk/IDecoder.h>
+#include <core/sdk/IDirectDecoder.h>
 #include <neaacdec.h>
 #include <mp4ff.h>
 
-class M4aDecoder : public musik::core::sdk::IDecoder {
+class M4aDecoder :
+    public musik::core::sdk::IDecoder,
+    public musik::core::sdk::IDirectDecoder
+{
     public:
         M4aDecoder();
         ~M4aDecoder();
@@ -49,8 +53,11 @@ class M4aDecoder : public musik::core::sdk::IDecoder {
         virtual double GetDuration() override;
         virtual bool Open(musik::core::sdk::IDataStream *stream) override;
         virtual bool Exhausted() override { return this->exhausted; }
+        virtual long Decode(float* target, long samples) override;
 
     private:
+        bool DecodeNextFrame();
+
         NeAACDecHandle decoder;
         mp4ff_t* decoderFile;
         mp4ff_callback_t decoderCallbacks;
@@ -61,4 +68,12 @@ class M4aDecoder : public musik::core::sdk::IDecoder {
         long decoderSampleId;
         double duration;
         bool exhausted;
+
+        /* the most recently decoded frame, owned by faad. it stays valid
+        until the next call to NeAACDecDecode() */
+        float* frame;
+        long frameSamples;
+        long frameOffset;
+        unsigned long frameSampleRate;
+        unsigned char frameChannels;
 };
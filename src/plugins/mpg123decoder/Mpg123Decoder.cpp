@@ -50,6 +50,7 @@ Mpg123Decoder::Mpg123Decoder()
 , sampleRate(44100)
 , channels(2)
 , fileStream(NULL)
+, streamView(NULL)
 , lastMpg123Status(MPG123_NEED_MORE) {
     this->decoder = mpg123_new(NULL, NULL);
     this->sampleSizeBytes = sizeof(float);
@@ -170,6 +171,15 @@ bool Mpg123Decoder::GetBuffer(IBuffer *buffer) {
 }
 
 bool Mpg123Decoder::Feed() {
+    if (this->streamView) {
+        /* the stream's already in memory; feed it straight from there */
+        const void* data = NULL;
+        long bytesRead = this->streamView->View(&data, STREAM_FEED_SIZE);
+
+        return bytesRead > 0 && mpg123_feed(
+            this->decoder, (const unsigned char*) data, bytesRead) == MPG123_OK;
+    }
+
     if (this->fileStream) {
         unsigned char buffer[STREAM_FEED_SIZE];
 
@@ -188,6 +198,7 @@ bool Mpg123Decoder::Feed() {
 bool Mpg123Decoder::Open(IDataStream *fileStream){
     if (this->decoder && fileStream) {
         this->fileStream = fileStream;
+        this->streamView = dynamic_cast<musik::core::sdk::IDataStreamView*>(fileStream);
 
         if (mpg123_open_feed(this->decoder) == MPG123_OK) {
             int result = mpg123_param(
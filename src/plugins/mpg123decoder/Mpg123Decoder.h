@@ -36,6 +36,7 @@
 
 #include <core/sdk/IDecoder.h>
 #include <core/sdk/IDataStream.h>
+#include <core/sdk/IDataStreamView.h>
 
 #include <mpg123.h>
 
@@ -55,6 +56,7 @@ class Mpg123Decoder : public musik::core::sdk::IDecoder {
 
     private:
         musik::core::sdk::IDataStream *fileStream;
+        musik::core::sdk::IDataStreamView *streamView;
         mpg123_handle *decoder;
 
         unsigned long cachedLength;
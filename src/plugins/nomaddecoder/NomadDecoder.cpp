@@ -105,6 +105,33 @@ double NomadDecoder::GetDuration() {
     return this->duration;
 }
 
+int NomadDecoder::GetSeekIndex(double* times, int64_t* offsets, int count) {
+    if (!this->nomadContext) {
+        return 0;
+    }
+
+    /* nomad's offsets are off_t, which may be narrower than ours */
+    std::vector<off_t> nomadOffsets(count > 0 ? count : 0);
+    int total = nomad_get_seek_index(
+        this->nomadContext, times, nomadOffsets.data(), count);
+
+    for (int i = 0; i < count && i < total; i++) {
+        offsets[i] = (int64_t) nomadOffsets[i];
+    }
+
+    return total;
+}
+
+bool NomadDecoder::SetSeekIndex(const double* times, const int64_t* offsets, int count) {
+    if (!this->nomadContext || count <= 0) {
+        return false;
+    }
+
+    std::vector<off_t> nomadOffsets(offsets, offsets + count);
+    return nomad_set_seek_index(
+        this->nomadContext, times, nomadOffsets.data(), count) == 0;
+}
+
 bool NomadDecoder::GetBuffer(IBuffer *buffer) {
     buffer->SetSamples(DEFAULT_READ_SAMPLE_SIZE);
 
@@ -127,6 +154,29 @@ bool NomadDecoder::GetBuffer(IBuffer *buffer) {
     return false;
 }
 
+long NomadDecoder::Decode(float* target, long samples) {
+    /* nomad_read() measures its output in 16-bit pcm bytes, regardless of
+    the sample format, and stops at the end of each mpeg frame. */
+    long written = 0;
+
+    while (written < samples) {
+        int read = nomad_read(
+            this->nomadContext,
+            (char *)(target + written),
+            (int)((samples - written) * sizeof(int16_t)),
+            SAMPLE_FORMAT_32_BIT_FLOAT);
+
+        if (read <= 0) {
+            this->exhausted = true;
+            break;
+        }
+
+        written += read;
+    }
+
+    return written;
+}
+
 bool NomadDecoder::Open(IDataStream *stream) {
     int tagLengthBytes = 0;
 
@@ -34,14 +34,18 @@
 
 #pragma once
 
-#include <core/sdk/IDecoder.h>
+#include <core/sdk/IIndexedDecoder.h>
+#include <core/sdk/IDirectDecoder.h>
 #include <core/sdk/IDataStream.h>
 
 extern "C" {
     #include <nomad.h>
 }
 
-class NomadDecoder : public musik::core::sdk::IDecoder {
+class NomadDecoder :
+    public musik::core::sdk::IIndexedDecoder,
+    public musik::core::sdk::IDirectDecoder
+{
     public:
         NomadDecoder();
         ~NomadDecoder();
@@ -52,6 +56,9 @@ class NomadDecoder : public musik::core::sdk::IDecoder {
         virtual double GetDuration() override;
         virtual void Release() override;
         virtual bool Exhausted() override { return this->exhausted; }
+        virtual int GetSeekIndex(double* times, int64_t* offsets, int count) override;
+        virtual bool SetSeekIndex(const double* times, const int64_t* offsets, int count) override;
+        virtual long Decode(float* target, long samples) override;
 
     private:
         size_t GetId3v2HeaderLength(musik::core::sdk::IDataStream *stream);
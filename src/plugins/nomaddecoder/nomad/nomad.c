@@ -69,6 +69,8 @@ static inline void * xmalloc(size_t size)
 struct seek_idx_entry {
 	off_t offset;
 	mad_timer_t timer;
+	/* value of cur_frame just before the frame at offset is decoded */
+	unsigned long cur_frame;
 };
 
 struct nomad {
@@ -397,7 +399,9 @@ static void build_seek_index(struct nomad *nomad)
 
 	mad_timer_add(&nomad->timer, nomad->frame.header.duration);
 
-	if (nomad->has_xing)
+	/* plain xing files seek using the TOC. LAME files need frame accurate
+	seeks, so index them too; otherwise every seek rescans from the start. */
+	if (nomad->has_xing && !nomad->has_lame)
 		return;
 
 	if (nomad->timer.seconds < (nomad->seek_idx.size + 1) * SEEK_IDX_INTERVAL)
@@ -415,6 +419,7 @@ static void build_seek_index(struct nomad *nomad)
 	nomad->seek_idx.table = xrenew(struct seek_idx_entry, nomad->seek_idx.table, idx + 1);
 	nomad->seek_idx.table[idx].offset = offset;
 	nomad->seek_idx.table[idx].timer = timer_now;
+	nomad->seek_idx.table[idx].cur_frame = nomad->cur_frame - 1;
 
 	nomad->seek_idx.size++;
 }
@@ -758,14 +763,28 @@ next_frame:
 
 static int nomad_time_seek_accurate(struct nomad *nomad, double pos)
 {
-	int rc;
+	int rc, idx;
+	off_t offset = 0;
+
+	/* start from the closest indexed frame before pos, if we have one */
+	idx = nomad->seek_idx.size - 1;
+	while (idx >= 0 && timer_to_seconds(nomad->seek_idx.table[idx].timer) > pos)
+		idx--;
 
-	/* seek to beginning of file and search frame-by-frame */
-	if (nomad->cbs.lseek(nomad->datasource, 0, SEEK_SET) == -1)
+	if (idx >= 0) {
+		offset = nomad->seek_idx.table[idx].offset;
+		nomad->timer = nomad->seek_idx.table[idx].timer;
+		nomad->cur_frame = nomad->seek_idx.table[idx].cur_frame;
+	} else {
+		/* XING header should NOT be counted - if we're here, we know it's present */
+		nomad->cur_frame = -1;
+	}
+
+	/* then search frame-by-frame */
+	if (nomad->cbs.lseek(nomad->datasource, offset, SEEK_SET) == -1)
 		return -1;
 
-	/* XING header should NOT be counted - if we're here, we know it's present */
-	nomad->cur_frame = -1;
+	nomad->input_offset = offset;
 
 	while (timer_to_seconds(nomad->timer) < pos) {
 		rc = fill_buffer(nomad);
@@ -786,7 +805,7 @@ static int nomad_time_seek_accurate(struct nomad *nomad, double pos)
 			continue;
 		}
 		nomad->cur_frame++;
-		mad_timer_add(&nomad->timer, nomad->frame.header.duration);
+		build_seek_index(nomad);
 	}
 #if defined(DEBUG_LAME)
 		d_print("seeked to %g = %g\n", pos, timer_to_seconds(nomad->timer));
@@ -872,6 +891,61 @@ int nomad_time_seek(struct nomad *nomad, double pos)
 	return 0;
 }
 
+int nomad_get_seek_index(struct nomad *nomad, double *times, off_t *offsets, int count)
+{
+	int i;
+
+	for (i = 0; i < count && i < nomad->seek_idx.size; i++) {
+		mad_timer_t timer = nomad->seek_idx.table[i].timer;
+		times[i] = (double)timer.seconds + (double)timer.fraction / MAD_TIMER_RESOLUTION;
+		offsets[i] = nomad->seek_idx.table[i].offset;
+	}
+	return nomad->seek_idx.size;
+}
+
+int nomad_set_seek_index(struct nomad *nomad, const double *times, const off_t *offsets, int count)
+{
+	double frame_duration = 0.0;
+	int i;
+
+	if (count <= nomad->seek_idx.size || nomad->info.filesize == -1)
+		return -1;
+	if (nomad->has_xing && !nomad->has_lame)
+		return -1;
+
+	/* entries must be in order, and every interval must be covered, because
+	lookups in nomad_time_seek() index the table by time. */
+	for (i = 0; i < count; i++) {
+		if (offsets[i] <= 0 || offsets[i] >= nomad->info.filesize)
+			return -1;
+		if (times[i] <= i * SEEK_IDX_INTERVAL || times[i] >= (i + 2) * SEEK_IDX_INTERVAL)
+			return -1;
+		if (i > 0 && (offsets[i] <= offsets[i - 1] || times[i] <= times[i - 1]))
+			return -1;
+	}
+
+	/* frame accurate seeks also need to know the frame number at each entry.
+	every frame has the same duration, and the timer counts the XING frame. */
+	if (nomad->has_lame) {
+		if (nomad->info.nr_frames <= 0 || nomad->info.duration <= 0.0)
+			return -1;
+		frame_duration = nomad->info.duration / nomad->info.nr_frames;
+	}
+
+	nomad->seek_idx.table = xrenew(struct seek_idx_entry, nomad->seek_idx.table, count);
+	for (i = 0; i < count; i++) {
+		struct seek_idx_entry *entry = &nomad->seek_idx.table[i];
+		entry->offset = offsets[i];
+		entry->timer.seconds = (signed long)times[i];
+		entry->timer.fraction = (unsigned long)
+			((times[i] - (double)entry->timer.seconds) * MAD_TIMER_RESOLUTION);
+		entry->cur_frame = nomad->has_lame
+			? (unsigned long)(times[i] / frame_duration + 0.5) - 1 : 0;
+	}
+	nomad->seek_idx.size = count;
+	return 0;
+}
+
 const struct nomad_xing *nomad_xing(struct nomad *nomad)
 {
 	return nomad->has_xing ? &nomad->xing : NULL;
@@ -105,6 +105,17 @@ int nomad_read(struct nomad *nomad, char *buffer, int count, nomad_sample_format
 /* -NOMAD_ERROR_ERRNO */
 int nomad_time_seek(struct nomad *nomad, double pos);
 
+/*
+ * the seek index maps times (seconds) to byte offsets of frame boundaries, and
+ * is built up as the file is decoded. nomad_get_seek_index() copies up to
+ * count entries and returns the total number available. an index previously
+ * read from the same file may be handed back with nomad_set_seek_index(); it
+ * is ignored (and -1 is returned) if it's smaller than the current one or
+ * doesn't look like one nomad would have built.
+ */
+int nomad_get_seek_index(struct nomad *nomad, double *times, off_t *offsets, int count);
+int nomad_set_seek_index(struct nomad *nomad, const double *times, const off_t *offsets, int count);
+
 const struct nomad_xing *nomad_xing(struct nomad *nomad);
 const struct nomad_lame *nomad_lame(struct nomad *nomad);
 const struct nomad_info *nomad_info(struct nomad *nomad);
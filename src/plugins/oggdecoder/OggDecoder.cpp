@@ -34,6 +34,7 @@
 
 #include "stdafx.h"
 #include "OggDecoder.h"
+#include <core/sdk/SampleOps.h>
 
 #define OGG_MAX_SAMPLES 1024
 
@@ -170,74 +171,29 @@ bool OggDecoder::GetBuffer(IBuffer *buffer) {
         ... so let's re-order when writing to our output buffer ...
     */
 
-    float *pDataBuffer = buffer->BufferPointer();
-
-    if (info->channels == 2) {
-        for (unsigned long x = 0; x < samplesRead; ++x) {
-            pDataBuffer[0] = pcm[0][x];
-            pDataBuffer[1] = pcm[1][x];
-            pDataBuffer += 2;
-        }
-    }
-    else if (info->channels == 3) {
-        for (unsigned long x=0; x < samplesRead; ++x) {
-            *pDataBuffer = pcm[0][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[2][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[1][x];
-            ++pDataBuffer;
-        }
-    }
-    else if (info->channels == 4) {
-        for (unsigned long x = 0; x < samplesRead; ++x) {
-            *pDataBuffer = pcm[0][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[1][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[2][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[3][x];
-            ++pDataBuffer;
-        }
-    }
-    else if (info->channels == 5) {
-        for (unsigned long x = 0; x < samplesRead; ++x) {
-            *pDataBuffer = pcm[0][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[2][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[1][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[3][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[4][x];
-            ++pDataBuffer;
-        }
-    }
-    else if (info->channels == 6) {
-        for (unsigned long x = 0; x < samplesRead; ++x) {
-            *pDataBuffer = pcm[0][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[2][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[1][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[5][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[3][x];
-            ++pDataBuffer;
-            *pDataBuffer = pcm[4][x];
-            ++pDataBuffer;
+    /* indexed by channel count; maps our channel order to ogg's */
+    static const int channelMap[7][6] = {
+        { 0 },
+        { 0 },
+        { 0, 1 },
+        { 0, 2, 1 },
+        { 0, 1, 2, 3 },
+        { 0, 2, 1, 3, 4 },
+        { 0, 2, 1, 5, 3, 4 }
+    };
+
+    if (info->channels <= 6) {
+        const float* planes[6];
+        for (int i = 0; i < info->channels; i++) {
+            planes[i] = pcm[channelMap[info->channels][i]];
         }
+
+        sampleops::Interleave(
+            planes, info->channels, (long) samplesRead, buffer->BufferPointer());
     }
     else {
-        for (unsigned long x = 0; x < samplesRead; ++x) {
-            for (int channel(0); channel < info->channels; ++channel) {
-                *pDataBuffer = pcm[channel][x];
-                ++pDataBuffer;
-            }
-        }
+        sampleops::Interleave(
+            pcm, info->channels, (long) samplesRead, buffer->BufferPointer());
     }
 
     return true;
@@ -0,0 +1,253 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#include "BatchTranscoder.h"
+#include "Transcoder.h"
+#include "Constants.h"
+#include "Util.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace musik::core::sdk;
+using namespace boost::filesystem;
+
+namespace {
+    struct Worker {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+
+    using WorkerList = std::vector<std::unique_ptr<Worker>>;
+
+    /* a worker takes from the front of its own queue, and steals from the
+    back of everyone else's. nothing is added once we start, so when every
+    queue is empty, we're done. */
+    bool nextJob(WorkerList& workers, size_t self, size_t& job) {
+        for (size_t i = 0; i < workers.size(); i++) {
+            Worker& worker = *workers[(self + i) % workers.size()];
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            if (!worker.jobs.empty()) {
+                if (i == 0) {
+                    job = worker.jobs.front();
+                    worker.jobs.pop_front();
+                }
+                else {
+                    job = worker.jobs.back();
+                    worker.jobs.pop_back();
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t fileSize(const std::string& filename) {
+        boost::system::error_code ec;
+        uintmax_t size = file_size(filename, ec);
+        return ec ? 0 : (uint64_t) size;
+    }
+}
+
+BatchTranscoder::BatchTranscoder(
+    Context& context,
+    const std::string& format,
+    size_t bitrate,
+    const std::string& directory,
+    size_t threads)
+: context(context)
+, format(format)
+, directory(directory)
+, bitrate(bitrate)
+, threads(threads)
+, interrupted(false) {
+    if (this->directory.size() &&
+        this->directory.back() != '/' &&
+        this->directory.back() != '\\')
+    {
+        this->directory += "/";
+    }
+
+    if (this->threads == 0) {
+        this->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+BatchTranscoder::Stats BatchTranscoder::Transcode(const std::vector<std::string>& uris) {
+    Stats stats;
+    stats.total = uris.size();
+
+    boost::system::error_code ec;
+    create_directories(this->directory, ec);
+
+    if (uris.empty() || this->bitrate == 0 || !is_directory(this->directory, ec)) {
+        stats.failed = uris.size();
+        return stats;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    const size_t count = std::min(this->threads, uris.size());
+
+    WorkerList workers;
+    for (size_t i = 0; i < count; i++) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+
+    for (size_t i = 0; i < uris.size(); i++) {
+        workers[i % count]->jobs.push_back(i);
+    }
+
+    std::atomic<size_t> transcoded(0), skipped(0), failed(0);
+    std::atomic<uint64_t> bytesRead(0), bytesWritten(0);
+
+    auto threadProc = [&](size_t self) {
+        size_t job;
+        while (!this->interrupted && nextJob(workers, self, job)) {
+            const std::string& uri = uris[job];
+
+            const std::string filename = Transcoder::GetFilename(
+                this->directory, uri, this->bitrate, this->format);
+
+            if (exists(filename)) {
+                ++skipped;
+            }
+            else if (Transcoder::TranscodeToFile(
+                this->context, uri, this->bitrate, this->format, filename, &this->interrupted))
+            {
+                ++transcoded;
+                bytesRead += fileSize(uri);
+                bytesWritten += fileSize(filename);
+            }
+            else if (!this->interrupted) {
+                ++failed;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < count; i++) {
+        pool.push_back(std::thread(threadProc, i));
+    }
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    stats.transcoded = transcoded;
+    stats.skipped = skipped;
+    stats.failed = failed;
+    stats.bytesRead = bytesRead;
+    stats.bytesWritten = bytesWritten;
+    stats.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    return stats;
+}
+
+void BatchTranscoder::Interrupt() {
+    this->interrupted = true;
+}
+
+std::string BatchTranscoder::Summarize(const Stats& stats) {
+    const double seconds = std::max(0.001, stats.seconds);
+    const double megabyte = 1024.0 * 1024.0;
+
+    char buffer[512];
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "%zu of %zu tracks transcoded (%zu skipped, %zu failed) in %.1fs: "
+        "%.2f tracks/s, %.2f MB/s read, %.2f MB/s written",
+        stats.transcoded,
+        stats.total,
+        stats.skipped,
+        stats.failed,
+        stats.seconds,
+        (double) stats.transcoded / seconds,
+        (double) stats.bytesRead / megabyte / seconds,
+        (double) stats.bytesWritten / megabyte / seconds);
+
+    return std::string(buffer);
+}
+
+bool BatchTranscoder::ResolveExportPath(
+    Context& context,
+    const std::string& relative,
+    std::string& result)
+{
+    path subdirectory(relative);
+
+    if (subdirectory.has_root_path()) {
+        return false;
+    }
+
+    for (auto& part : subdirectory) {
+        if (part == "..") {
+            return false;
+        }
+    }
+
+    std::string root = GetPreferenceString(
+        context.prefs, prefs::transcoder_export_path, defaults::transcoder_export_path);
+
+    if (root.empty()) {
+        char buf[4096];
+        context.environment->GetPath(PathType::PathData, buf, sizeof(buf));
+        root = std::string(buf) + "/export";
+    }
+
+    result = (path(root) / subdirectory).string();
+    return true;
+}
+
+std::vector<std::string> BatchTranscoder::Filenames(ITrackList* tracks) {
+    std::vector<std::string> result;
+    if (tracks) {
+        for (size_t i = 0; i < tracks->Count(); i++) {
+            ITrack* track = tracks->GetTrack(i);
+            if (track) {
+                result.push_back(GetMetadataString(track, key::filename, ""));
+                track->Release();
+            }
+        }
+    }
+    return result;
+}
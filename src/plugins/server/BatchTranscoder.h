@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "Context.h"
+#include <core/sdk/ITrackList.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* transcodes a list of tracks into a directory, using the same file naming
+as the transcode cache, so exports can be used for mobile sync. each track
+is one job. jobs are dealt round-robin to a pool of workers, one per core
+by default. a worker that runs out steals from the back of another
+worker's queue, so a few long tracks don't leave the rest of the pool idle.
+tracks already in the directory are skipped. */
+class BatchTranscoder {
+    public:
+        struct Stats {
+            size_t total { 0 };
+            size_t transcoded { 0 };
+            size_t skipped { 0 };
+            size_t failed { 0 };
+            uint64_t bytesRead { 0 };
+            uint64_t bytesWritten { 0 };
+            double seconds { 0.0 };
+        };
+
+        BatchTranscoder(
+            Context& context,
+            const std::string& format,
+            size_t bitrate,
+            const std::string& directory,
+            size_t threads = 0);
+
+        /* blocks until every uri has been transcoded, skipped or failed, or
+        until Interrupt() is called. */
+        Stats Transcode(const std::vector<std::string>& uris);
+
+        /* stops workers from starting new jobs; the ones in progress are
+        allowed to finish. */
+        void Interrupt();
+
+        static std::string Summarize(const Stats& stats);
+
+        /* resolves a client-supplied directory against the export root set
+        in the server's preferences (by default, "export" in the data
+        directory). returns false for absolute paths, or anything that
+        would escape the root. */
+        static bool ResolveExportPath(
+            Context& context,
+            const std::string& relative,
+            std::string& result);
+
+        /* the filenames of every track in the list. the list isn't released. */
+        static std::vector<std::string> Filenames(musik::core::sdk::ITrackList* tracks);
+
+    private:
+        Context& context;
+        std::string format;
+        std::string directory;
+        size_t bitrate;
+        size_t threads;
+        std::atomic<bool> interrupted;
+};
@@ -78,7 +78,7 @@ void BlockingTranscoder::Cleanup() {
     }
 }
 
-bool BlockingTranscoder::Transcode() {
+bool BlockingTranscoder::Transcode(const std::atomic<bool>* interrupted) {
     if (!this->input || !this->output || !this->encoder) {
         return false;
     }
@@ -102,7 +102,11 @@ bool BlockingTranscoder::Transcode() {
 
         if (initialized) {
             this->encoder->Encode(pcmBuffer);
-            while (!interrupted && decoder->GetBuffer(pcmBuffer)) {
+            auto stop = [this, interrupted]() -> bool {
+                return this->interrupted || (interrupted && *interrupted);
+            };
+
+            while (!stop() && decoder->GetBuffer(pcmBuffer)) {
                 this->encoder->Encode(pcmBuffer);
                 std::this_thread::yield();
             }
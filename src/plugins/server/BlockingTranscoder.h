@@ -36,6 +36,7 @@
 #include <core/sdk/IBlockingEncoder.h>
 #include <core/sdk/DataBuffer.h>
 #include "Context.h"
+#include <atomic>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
@@ -56,7 +57,8 @@ class BlockingTranscoder {
 
         virtual ~BlockingTranscoder();
 
-        bool Transcode();
+        /* interrupted, if specified, is polled along with Interrupt() */
+        bool Transcode(const std::atomic<bool>* interrupted = nullptr);
         void Interrupt();
 
     private:
@@ -47,6 +47,7 @@ namespace defaults {
     static const bool use_ipv6 = false;
     static const bool transcoder_synchronous = false;
     static const bool transcoder_synchronous_fallback = false;
+    static const std::string transcoder_export_path = "";
 }
 
 namespace prefs {
@@ -58,6 +59,7 @@ namespace prefs {
     static const std::string transcoder_cache_count = "transcoder_cache_count";
     static const std::string transcoder_synchronous = "transcoder_synchronous";
     static const std::string transcoder_synchronous_fallback = "transcoder_synchronous_fallback";
+    static const std::string transcoder_export_path = "transcoder_export_path";
 }
 
 namespace message {
@@ -139,6 +141,32 @@ namespace key {
     static const std::string enabled = "enabled";
     static const std::string bands = "bands";
     static const std::string time = "time";
+    static const std::string totals = "totals";
+    static const std::string streams = "streams";
+    static const std::string sum = "sum";
+    static const std::string max = "max";
+    static const std::string buckets = "buckets";
+    static const std::string buffers_decoded = "buffers_decoded";
+    static const std::string buffers_played = "buffers_played";
+    static const std::string starved = "starved";
+    static const std::string output_underruns = "output_underruns";
+    static const std::string transitions = "transitions";
+    static const std::string decode_micros = "decode_micros";
+    static const std::string dsp_micros = "dsp_micros";
+    static const std::string output_micros = "output_micros";
+    static const std::string decode_queue_depth = "decode_queue_depth";
+    static const std::string output_queue_depth = "output_queue_depth";
+    static const std::string transition_gap_micros = "transition_gap_micros";
+    static const std::string format = "format";
+    static const std::string bitrate = "bitrate";
+    static const std::string path = "path";
+    static const std::string total = "total";
+    static const std::string transcoded = "transcoded";
+    static const std::string skipped = "skipped";
+    static const std::string failed = "failed";
+    static const std::string bytes_read = "bytes_read";
+    static const std::string bytes_written = "bytes_written";
+    static const std::string seconds = "seconds";
 }
 
 namespace value {
@@ -203,6 +231,8 @@ namespace request {
     static const std::string set_transport_type = "set_transport_type";
     static const std::string snapshot_play_queue = "snapshot_play_queue";
     static const std::string invalidate_play_queue_snapshot = "invalidate_play_queue_snapshot";
+    static const std::string get_playback_metrics = "get_playback_metrics";
+    static const std::string transcode_tracks = "transcode_tracks";
 }
 
 namespace fragment {
@@ -215,6 +245,7 @@ namespace fragment {
 namespace broadcast {
     static const std::string playback_overview_changed = "playback_overview_changed";
     static const std::string play_queue_changed = "play_queue_changed";
+    static const std::string transcode_finished = "transcode_finished";
 }
 
 static auto PLAYBACK_STATE_TO_STRING = makeBimap<musik::core::sdk::PlaybackState, std::string>({
@@ -239,6 +270,7 @@ static auto REPLAYGAIN_MODE_TO_STRING = makeBimap<musik::core::sdk::ReplayGainMo
 static auto TRANSPORT_TYPE_TO_STRING = makeBimap<musik::core::sdk::TransportType, std::string>({
     { musik::core::sdk::TransportType::Gapless, "gapless" },
     { musik::core::sdk::TransportType::Crossfade, "crossfade" },
+    { musik::core::sdk::TransportType::Mixing, "mixing" },
 });
 
-static const int ApiVersion = 15;
+static const int ApiVersion = 16;
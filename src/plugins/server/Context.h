@@ -67,11 +67,13 @@ struct Context {
         this->metadataProxy = nullptr;
         this->prefs = nullptr;
         this->playback = nullptr;
+        this->remoteDisabled = false;
     }
 
     musik::core::sdk::IMetadataProxy* metadataProxy;
     musik::core::sdk::IPreferences* prefs;
     musik::core::sdk::IPlaybackService* playback;
     musik::core::sdk::IEnvironment* environment;
+    bool remoteDisabled; /* loaded for an offline export; don't listen */
     ReadWriteLock lock;
 };
\ No newline at end of file
@@ -126,6 +126,14 @@ void Transcoder::PruneTranscodeCache(Context& context) {
     }
 }
 
+static std::string getTempFilename(const std::string& finalFn) {
+    std::string tempFn;
+    do {
+        tempFn = finalFn + "." + std::to_string(rand()) + ".tmp";
+    } while (exists(tempFn));
+    return tempFn;
+}
+
 static void getTempAndFinalFilename(
     Context& context,
     const std::string& uri,
@@ -134,15 +142,21 @@ static void getTempAndFinalFilename(
     std::string& tempFn,
     std::string& finalFn)
 {
-    finalFn = std::string(
-        cachePath(context) +
+    finalFn = Transcoder::GetFilename(cachePath(context), uri, bitrate, format);
+    tempFn = getTempFilename(finalFn);
+}
+
+std::string Transcoder::GetFilename(
+    const std::string& directory,
+    const std::string& uri,
+    size_t bitrate,
+    const std::string& format)
+{
+    return std::string(
+        directory +
         std::to_string(std::hash<std::string>()(uri)) +
         "-" + std::to_string(bitrate) +
         "." + format);
-
-    do {
-        tempFn = finalFn + "." + std::to_string(rand()) + ".tmp";
-    } while (exists(tempFn));
 }
 
 IDataStream* Transcoder::Transcode(
@@ -318,4 +332,62 @@ IDataStream* Transcoder::TranscodeAndWait(
         PruneTranscodeCache(context);
         return context.environment->GetDataStream(expectedFilename.c_str(), OpenFlags::Read);
     }
-}
\ No newline at end of file
+}
+
+bool Transcoder::TranscodeToFile(
+    Context& context,
+    const std::string& uri,
+    size_t bitrate,
+    const std::string& format,
+    const std::string& filename,
+    const std::atomic<bool>* interrupted)
+{
+    IEncoder* encoder = getEncoder(context, format);
+    if (!encoder) {
+        return false;
+    }
+
+    const std::string tempFilename = getTempFilename(filename);
+
+    IStreamingEncoder* audioStreamEncoder = dynamic_cast<IStreamingEncoder*>(encoder);
+    if (audioStreamEncoder) {
+        TranscodingAudioDataStream* transcoderStream = new TranscodingAudioDataStream(
+            context, audioStreamEncoder, uri, tempFilename, filename, bitrate, format);
+
+        /* as above, an indeterminate length may never finish */
+        if (transcoderStream->Length() < 0) {
+            transcoderStream->Release();
+            return false;
+        }
+
+        /* the stream writes the file as it's read, and renames it once it
+        hits the end. we don't need the data ourselves. */
+        char buffer[8192];
+        while (!transcoderStream->Eof()) {
+            if (interrupted && *interrupted) {
+                /* releasing it before the end removes the temp file */
+                transcoderStream->Release();
+                return false;
+            }
+            transcoderStream->Read(buffer, sizeof(buffer));
+        }
+
+        transcoderStream->Release();
+    }
+    else {
+        IBlockingEncoder* blockingEncoder = dynamic_cast<IBlockingEncoder*>(encoder);
+        if (!blockingEncoder) {
+            encoder->Release();
+            return false;
+        }
+
+        BlockingTranscoder blockingTranscoder(
+            context, blockingEncoder, uri, tempFilename, filename, bitrate);
+
+        if (!blockingTranscoder.Transcode(interrupted)) {
+            return false;
+        }
+    }
+
+    return exists(filename);
+}
@@ -39,6 +39,7 @@
 #include <core/sdk/IDataStream.h>
 #include <core/sdk/IDecoder.h>
 #include <core/sdk/IStreamingEncoder.h>
+#include <atomic>
 #include <string>
 
 class Transcoder {
@@ -64,6 +65,26 @@ class Transcoder {
             size_t bitrate,
             const std::string& format);
 
+        /* the name a transcoded copy of uri is given in the transcode cache.
+        batch exports use the same naming in their own directory. */
+        static std::string GetFilename(
+            const std::string& directory,
+            const std::string& uri,
+            size_t bitrate,
+            const std::string& format);
+
+        /* transcodes uri to filename on the calling thread, via a temp file
+        in the same directory. returns false if nothing was written. if
+        interrupted is specified, it's polled while transcoding; setting it
+        abandons the file. */
+        static bool TranscodeToFile(
+            Context& context,
+            const std::string& uri,
+            size_t bitrate,
+            const std::string& format,
+            const std::string& filename,
+            const std::atomic<bool>* interrupted = nullptr);
+
     private:
         static IDataStream* TranscodeOnDemand(
             Context& context,
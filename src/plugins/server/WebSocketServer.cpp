@@ -124,6 +124,33 @@ static std::shared_ptr<IValue*> jsonToPredicateList(json& arr) {
     });
 }
 
+static json histogramToJson(const PlaybackHistogram& histogram) {
+    return {
+        { key::count, histogram.count },
+        { key::sum, histogram.sum },
+        { key::max, histogram.max },
+        { key::buckets, std::vector<uint64_t>(
+            histogram.buckets, histogram.buckets + PlaybackHistogram::BucketCount) }
+    };
+}
+
+static json metricsToJson(const PlaybackMetrics& metrics) {
+    return {
+        { key::id, metrics.id },
+        { key::buffers_decoded, metrics.buffersDecoded },
+        { key::buffers_played, metrics.buffersPlayed },
+        { key::starved, metrics.starved },
+        { key::output_underruns, metrics.outputUnderruns },
+        { key::transitions, metrics.transitions },
+        { key::decode_micros, histogramToJson(metrics.decodeMicros) },
+        { key::dsp_micros, histogramToJson(metrics.dspMicros) },
+        { key::output_micros, histogramToJson(metrics.outputMicros) },
+        { key::decode_queue_depth, histogramToJson(metrics.decodeQueueDepth) },
+        { key::output_queue_depth, histogramToJson(metrics.outputQueueDepth) },
+        { key::transition_gap_micros, histogramToJson(metrics.transitionGapMicros) }
+    };
+}
+
 static json getEnvironment(Context& context) {
     return {
         { prefs::http_server_enabled, context.prefs->GetBool(prefs::http_server_enabled.c_str()) },
@@ -211,6 +238,18 @@ void WebSocketServer::ThreadProc() {
 }
 
 bool WebSocketServer::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(this->batchMutex);
+        if (this->batchTranscoder) {
+            this->batchTranscoder->Interrupt();
+        }
+    }
+
+    if (this->batchThread) {
+        this->batchThread->join();
+        this->batchThread.reset();
+    }
+
     if (this->thread) {
         if (this->wss) {
             wss->stop();
@@ -506,6 +545,14 @@ void WebSocketServer::HandleRequest(connection_hdl connection, json& request) {
             this->RespondWithSuccess(connection, request);
             return;
         }
+        else if (name == request::get_playback_metrics) {
+            this->RespondWithGetPlaybackMetrics(connection, request);
+            return;
+        }
+        else if (name == request::transcode_tracks) {
+            this->RespondWithTranscodeTracks(connection, request);
+            return;
+        }
     }
 
     this->RespondWithInvalidRequest(connection, name, id);
@@ -1639,3 +1686,95 @@ void WebSocketServer::OnMessage(server* s, connection_hdl hdl, message_ptr msg)
         this->RespondWithInvalidRequest(hdl, value::invalid, value::invalid);
     }
 }
+
+void WebSocketServer::RespondWithGetPlaybackMetrics(connection_hdl connection, json& request) {
+    /* streams can come and go between the two calls; ask for a few extra */
+    std::vector<PlaybackMetrics> metrics(context.playback->GetPlaybackMetrics(nullptr, 0) + 4);
+    size_t count = std::min(metrics.size(),
+        context.playback->GetPlaybackMetrics(metrics.data(), metrics.size()));
+
+    json streams = json::array();
+    for (size_t i = 1; i < count; i++) {
+        streams.push_back(metricsToJson(metrics[i]));
+    }
+
+    this->RespondWithOptions(connection, request, {
+        { key::totals, metricsToJson(metrics[0]) },
+        { key::streams, streams }
+    });
+}
+
+void WebSocketServer::RespondWithTranscodeTracks(connection_hdl connection, json& request) {
+    auto& options = request[message::options];
+    auto externalIdsIt = options.find(key::external_ids);
+    std::string format = options.value(key::format, "mp3");
+    size_t bitrate = options.value<size_t>(key::bitrate, 0);
+
+    /* clients only get to pick a directory under the export root */
+    std::string relative = options.value(key::path, "");
+    std::string path;
+    bool valid = BatchTranscoder::ResolveExportPath(context, relative, path);
+
+    if (!valid || format.empty() || bitrate == 0) {
+        this->RespondWithInvalidRequest(connection, request[message::name], value::invalid);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(this->batchMutex);
+
+    if (this->batchTranscoder) {
+        /* one at a time, it already uses every core */
+        this->RespondWithFailure(connection, request);
+        return;
+    }
+
+    /* the previous batch has finished, but its thread hasn't been joined */
+    if (this->batchThread) {
+        this->batchThread->join();
+        this->batchThread.reset();
+    }
+
+    /* everything in the library, unless the caller asked for specific tracks */
+    ITrackList* trackList = nullptr;
+    if (externalIdsIt != options.end() && (*externalIdsIt).is_array()) {
+        auto externalIds = jsonToStringArray(*externalIdsIt);
+        trackList = context.metadataProxy->QueryTracksByExternalId(
+            (const char**) externalIds.get(), (*externalIdsIt).size());
+    }
+    else {
+        trackList = context.metadataProxy->QueryTracks();
+    }
+
+    std::vector<std::string> filenames = BatchTranscoder::Filenames(trackList);
+
+    if (trackList) {
+        trackList->Release();
+    }
+
+    auto batch = std::make_shared<BatchTranscoder>(context, format, bitrate, path);
+    this->batchTranscoder = batch;
+
+    this->batchThread.reset(new std::thread([this, batch, filenames, relative]() {
+        auto stats = batch->Transcode(filenames);
+
+        json options = {
+            { key::path, relative },
+            { key::total, stats.total },
+            { key::transcoded, stats.transcoded },
+            { key::skipped, stats.skipped },
+            { key::failed, stats.failed },
+            { key::bytes_read, stats.bytesRead },
+            { key::bytes_written, stats.bytesWritten },
+            { key::seconds, stats.seconds }
+        };
+
+        this->Broadcast(broadcast::transcode_finished, options);
+
+        std::unique_lock<std::mutex> lock(this->batchMutex);
+        this->batchTranscoder.reset();
+    }));
+
+    this->RespondWithOptions(connection, request, {
+        { key::count, filenames.size() }
+    });
+}
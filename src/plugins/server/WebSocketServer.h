@@ -32,6 +32,7 @@
 //
 //////////////////////////////////////////////////////////////////////////////
 
+#include "BatchTranscoder.h"
 #include "Context.h"
 #include "Snapshots.h"
 
@@ -123,6 +124,11 @@ class WebSocketServer {
         Snapshots snapshots;
         volatile bool running;
 
+        /* at most one batch export runs at a time, on its own thread */
+        std::shared_ptr<BatchTranscoder> batchTranscoder;
+        std::shared_ptr<std::thread> batchThread;
+        std::mutex batchMutex;
+
         /* gross extra state */
         std::string lastPlaybackOverview;
 
@@ -170,6 +176,8 @@ class WebSocketServer {
         void RespondWithSetTransportType(connection_hdl connection, json& request);
         void RespondWithSnapshotPlayQueue(connection_hdl connection, json& request);
         void RespondWithInvalidatePlayQueueSnapshot(connection_hdl connection, json& request);
+        void RespondWithGetPlaybackMetrics(connection_hdl connection, json& request);
+        void RespondWithTranscodeTracks(connection_hdl connection, json& request);
 
         void BroadcastPlaybackOverview();
         void BroadcastPlayQueueChanged();
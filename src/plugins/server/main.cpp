@@ -32,6 +32,7 @@
 //
 //////////////////////////////////////////////////////////////////////////////
 
+#include "BatchTranscoder.h"
 #include "Constants.h"
 #include "Context.h"
 
@@ -44,6 +45,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/detail/utf8_codecvt_facet.hpp>
 
+#include <cstring>
 #include <thread>
 
 #ifdef WIN32
@@ -84,11 +86,14 @@ static class PlaybackRemote : public IPlaybackRemote {
         }
 
         void CheckRunningStatus() {
-            if (!thread && context.environment && context.playback && context.prefs && context.metadataProxy) {
+            const bool ready = !context.remoteDisabled &&
+                context.environment && context.playback && context.prefs && context.metadataProxy;
+
+            if (!thread && ready) {
                 this->Start();
                 thread.reset(new std::thread(std::bind(&PlaybackRemote::ThreadProc, this)));
             }
-            else if (thread && (!context.environment || !context.playback || !context.prefs || !context.metadataProxy)) {
+            else if (thread && !ready) {
                 this->Stop();
             }
         }
@@ -197,6 +202,7 @@ extern "C" DLL_EXPORT void SetPreferences(musik::core::sdk::IPreferences* prefs)
         prefs->GetInt(prefs::transcoder_cache_count.c_str(), defaults::transcoder_cache_count);
         prefs->GetBool(prefs::transcoder_synchronous.c_str(), defaults::transcoder_synchronous);
         prefs->GetBool(prefs::transcoder_synchronous_fallback.c_str(), defaults::transcoder_synchronous_fallback);
+        prefs->GetString(prefs::transcoder_export_path.c_str(), nullptr, 0, defaults::transcoder_export_path.c_str());
         prefs->Save();
     }
 
@@ -208,3 +214,43 @@ extern "C" DLL_EXPORT void SetMetadataProxy(musik::core::sdk::IMetadataProxy* me
     context.metadataProxy = metadataProxy;
     remote.CheckRunningStatus();
 }
+
+/* called by `musikcubed --transcode` before the plugin is initialized, so
+an offline export never starts the servers or binds their ports. */
+extern "C" DLL_EXPORT void DisableRemote() {
+    auto wl = context.lock.Write();
+    context.remoteDisabled = true;
+    remote.CheckRunningStatus();
+}
+
+/* used by `musikcubed --transcode` to export the whole library. blocks until
+finished, writes a summary to `summary`, and returns the number of tracks that
+failed, or -1 if the plugin isn't ready. */
+extern "C" DLL_EXPORT int TranscodeLibrary(
+    const char* format,
+    int bitrate,
+    const char* directory,
+    char* summary,
+    int summarySize)
+{
+    if (!context.environment || !context.metadataProxy || bitrate <= 0) {
+        return -1;
+    }
+
+    ITrackList* trackList = context.metadataProxy->QueryTracks();
+    std::vector<std::string> filenames = BatchTranscoder::Filenames(trackList);
+    if (trackList) {
+        trackList->Release();
+    }
+
+    BatchTranscoder batch(context, format, (size_t) bitrate, directory);
+    auto stats = batch.Transcode(filenames);
+
+    if (summary && summarySize > 0) {
+        std::string result = BatchTranscoder::Summarize(stats);
+        strncpy(summary, result.c_str(), summarySize);
+        summary[summarySize - 1] = '\0';
+    }
+
+    return (int) stats.failed;
+}
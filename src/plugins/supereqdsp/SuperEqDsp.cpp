@@ -55,7 +55,7 @@ void SuperEqDsp::NotifyChanged() {
 }
 
 SuperEqDsp::SuperEqDsp() {
-    this->enabled = ::prefs && ::prefs->GetBool("enabled", false);
+    this->LoadSettings();
 }
 
 SuperEqDsp::~SuperEqDsp() {
@@ -69,39 +69,83 @@ void SuperEqDsp::Release() {
     delete this;
 }
 
+/* re-reads our preferences if they've changed since we last looked. returns
+true if they have, and the table needs to be rebuilt. */
+bool SuperEqDsp::LoadSettings() {
+    int current = ::currentState.load();
+
+    if (this->lastUpdated == current) {
+        return false;
+    }
+
+    this->lastUpdated = current;
+    this->enabled = ::prefs && ::prefs->GetBool("enabled", false);
+    this->flat = true;
+
+    for (size_t i = 0; i < BANDS.size(); i++) {
+        double dB = ::prefs ? ::prefs->GetDouble(BANDS[i].c_str(), 0.0) : 0.0;
+        this->bands[i] = (float) pow(10, dB / 20.f);
+        this->flat = this->flat && dB == 0.0;
+    }
+
+    return true;
+}
+
+bool SuperEqDsp::Neutral() {
+    if (this->LoadSettings()) {
+        this->stale = true;
+    }
+
+    /* a flat curve is a no-op, apart from the latency */
+    bool neutral = !this->enabled || this->flat;
+    this->bypassed = this->bypassed || neutral;
+    return neutral;
+}
+
 bool SuperEqDsp::Process(IBuffer* buffer) {
     int channels = buffer->Channels();
-    int current = ::currentState.load();
+    long sampleRate = buffer->SampleRate();
+
+    if (this->LoadSettings()) {
+        this->stale = true;
+    }
 
-    if (!this->supereq || this->lastUpdated != current) {
-        this->enabled = ::prefs && ::prefs->GetBool("enabled", false);
-        this->lastUpdated = current;
+    if (!this->enabled) {
+        return false;
+    }
 
-        if (!this->supereq) {
-            this->supereq = new SuperEqState();
-            equ_init(this->supereq, 10, channels);
+    if (!this->supereq || channels != this->channels) {
+        if (this->supereq) {
+            equ_quit(this->supereq);
+            delete this->supereq;
         }
 
-        void *params = paramlist_alloc();
-        float bands[18];
+        this->supereq = new SuperEqState();
+        equ_init(this->supereq, 10, channels);
+        this->channels = channels;
+        this->stale = true;
+    }
 
-        for (size_t i = 0; i < BANDS.size(); i++) {
-            double dB =  prefs->GetDouble(BANDS[i].c_str(), 0.0);
-            double amp = pow(10, dB / 20.f);
-            bands[i] = (float) amp;
-        }
+    /* the table depends on the sample rate as well as the bands */
+    if (this->stale || sampleRate != this->sampleRate) {
+        void *params = paramlist_alloc();
 
         equ_makeTable(
             this->supereq,
-            bands,
+            this->bands,
             params,
-            (float) buffer->SampleRate());
+            (float) sampleRate);
 
         paramlist_free(params);
+
+        this->sampleRate = sampleRate;
+        this->stale = false;
     }
 
-    if (!this->enabled) {
-        return false;
+    /* don't play out the tail of whatever we had before being skipped */
+    if (this->bypassed) {
+        equ_clearbuf(this->supereq);
+        this->bypassed = false;
     }
 
     return equ_modifySamples_float(
@@ -109,4 +153,4 @@ bool SuperEqDsp::Process(IBuffer* buffer) {
         (char*) buffer->BufferPointer(),
         buffer->Samples() / channels,
         channels) != 0;
-}
\ No newline at end of file
+}
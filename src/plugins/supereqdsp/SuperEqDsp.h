@@ -29,22 +29,32 @@
 #pragma once
 
 #include <core/sdk/IDSP.h>
+#include <core/sdk/IBypassableDSP.h>
 #include "supereq/Equ.h"
 
 using namespace musik::core::sdk;
 
-class SuperEqDsp : public IDSP {
+class SuperEqDsp : public IDSP, public IBypassableDSP {
     public:
         SuperEqDsp();
         ~SuperEqDsp();
 
         virtual void Release() override;
         virtual bool Process(IBuffer *buffer) override;
+        virtual bool Neutral() override;
 
         static void NotifyChanged();
 
     private:
+        bool LoadSettings();
+
         SuperEqState* supereq {nullptr};
-        int lastUpdated {0};
-        bool enabled;
+        int lastUpdated {-1};
+        bool enabled {false};
+        bool flat {true};
+        bool stale {true};
+        bool bypassed {false};
+        float bands[18];
+        long sampleRate {0};
+        int channels {0};
 };
@@ -0,0 +1,190 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2019 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+/* a standalone check and benchmark for the resampler: converts test tones
+between common rates and verifies the frame count, the noise floor, and
+that the result doesn't depend on how the input is chunked, then times
+each quality setting. exits non-zero if any check fails. */
+
+#include <core/audio/Resampler.h>
+#include <core/sdk/SampleOps.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace musik::core::audio;
+
+#define PI 3.14159265358979323846
+#define CHANNELS 2
+#define CHUNK_FRAMES 2048
+#define BENCH_SECONDS 60
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+/* a tone on the left, inverted on the right, so swapped channels show up */
+static std::vector<float> tone(long rate, double hz, long frames) {
+    std::vector<float> result((size_t) frames * CHANNELS);
+    for (long i = 0; i < frames; i++) {
+        const float value = (float) (0.5 * std::sin(2.0 * PI * hz * i / rate));
+        result[i * CHANNELS] = value;
+        result[i * CHANNELS + 1] = -value;
+    }
+    return result;
+}
+
+static long convert(Resampler& resampler, const std::vector<float>& input, long chunk, std::vector<float>& output) {
+    const long frames = (long) input.size() / CHANNELS;
+    long produced = 0;
+    for (long i = 0; i < frames; i += chunk) {
+        const long count = std::min(chunk, frames - i);
+        produced += resampler.Process(&input[i * CHANNELS], count, output);
+    }
+    return produced + resampler.Drain(output);
+}
+
+static void accuracy(long in, long out, double hz, Resampler::Quality quality, double minSnr) {
+    const long frames = in * 2;
+    std::vector<float> input = tone(in, hz, frames), output;
+
+    Resampler resampler(in, out, CHANNELS, quality);
+    const long produced = convert(resampler, input, CHUNK_FRAMES, output);
+    const long expected = (long) ((frames * (int64_t) out + in - 1) / in);
+
+    /* compare against the ideal tone, away from the edges */
+    double signal = 0.0, noise = 0.0;
+    for (long n = out / 10; n < produced - out / 10; n++) {
+        const double ideal = 0.5 * std::sin(2.0 * PI * hz * n / out);
+        const double left = output[n * CHANNELS] - ideal;
+        const double right = output[n * CHANNELS + 1] + ideal;
+        noise += left * left + right * right;
+        signal += 2.0 * ideal * ideal;
+    }
+
+    const double snr = 10.0 * std::log10(signal / std::max(noise, 1e-30));
+
+    printf("%6ld -> %6ld  q=%d  phases=%4d  taps=%3d  %5.0f Hz  snr=%6.1f dB\n",
+        in, out, (int) quality, resampler.Phases(), resampler.TapsPerPhase(), hz, snr);
+
+    check(produced == expected, "output frame count");
+    check((long) output.size() == produced * CHANNELS, "output sample count");
+    check(snr >= minSnr, "signal to noise ratio");
+}
+
+static void chunking(long in, long out) {
+    const long frames = in * 2;
+    std::vector<float> input((size_t) frames * CHANNELS), whole, pieces;
+    for (auto& sample : input) {
+        sample = (float) ((rand() % 2000) - 1000) / 1000.0f;
+    }
+
+    Resampler a(in, out, CHANNELS), b(in, out, CHANNELS);
+    convert(a, input, frames, whole);
+
+    for (long i = 0; i < frames; ) {
+        const long count = std::min((long) (1 + rand() % 700), frames - i);
+        b.Process(&input[i * CHANNELS], count, pieces);
+        i += count;
+    }
+    b.Drain(pieces);
+
+    printf("%6ld -> %6ld  chunked in random sizes\n", in, out);
+    check(whole == pieces, "chunking changed the output");
+}
+
+static void benchmark(long in, long out, Resampler::Quality quality) {
+    const long frames = in * BENCH_SECONDS;
+    std::vector<float> input = tone(in, 1000.0, frames), output;
+    output.reserve((size_t) (out + 1) * BENCH_SECONDS * CHANNELS);
+
+    Resampler resampler(in, out, CHANNELS, quality);
+
+    /* the way the player uses it: one decoder-sized buffer at a time,
+    into a vector that's emptied in between. */
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < frames; i += CHUNK_FRAMES) {
+        output.clear();
+        resampler.Process(&input[i * CHANNELS], std::min((long) CHUNK_FRAMES, frames - i), output);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    printf("%6ld -> %6ld  q=%d  %ds of stereo in %7.1f ms (%5.0fx realtime)\n",
+        in, out, (int) quality, BENCH_SECONDS, ms, BENCH_SECONDS * 1000.0 / ms);
+}
+
+int main(int argc, char** argv) {
+    using Quality = Resampler::Quality;
+
+    printf("sample ops: %s\n\n", musik::core::sdk::sampleops::Implementation());
+
+    static const long RATES[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 44100, 96000 }, { 96000, 44100 },
+        { 44100, 44100 }, { 22050, 48000 }, { 192000, 44100 }, { 11025, 192000 }
+    };
+
+    for (auto& rates : RATES) {
+        accuracy(rates[0], rates[1], 1000.0, Quality::High, 100.0);
+    }
+
+    accuracy(44100, 48000, 18000.0, Quality::High, 100.0);
+    accuracy(44100, 48000, 1000.0, Quality::Normal, 90.0);
+    accuracy(44100, 48000, 1000.0, Quality::Fast, 60.0);
+    accuracy(44100, 47999, 1000.0, Quality::High, 60.0); /* approximated ratio */
+
+    printf("\n");
+    chunking(44100, 48000);
+    chunking(96000, 44100);
+
+    printf("\n");
+    for (int quality = 0; quality <= 2; quality++) {
+        benchmark(44100, 48000, (Quality) quality);
+    }
+    benchmark(96000, 44100, Quality::High);
+    benchmark(192000, 48000, Quality::High);
+
+    printf("\n%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}